@@ -0,0 +1,127 @@
+#include "bloom_filter.h"
+#include "hyperloglog.h"
+#include "hash_mix.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* ****************** Bloom filter and HyperLogLog accuracy ***************** */
+/*
+   Build with:
+     cc -std=c11 -O2 bench_bloom_hll.c bloom_filter.c hyperloglog.c -lm -o bench_bloom_hll
+
+   Measures what the two sketches promise, rather than timing them.
+
+   Bloom filter: for each target rate and number of items, a filter is
+   created for that many items, they're all added, and BENCH_QUERIES
+   items that were never added are looked up. The fraction found is the
+   measured false positive rate, printed next to the target and to
+   Bloom_false_positive_rate()'s estimate. Every added item is looked
+   up too, and must be found.
+
+   HyperLogLog: for each precision, BENCH_TRIALS streams of distinct
+   items are counted, and at every power of 10 along the way the
+   estimate is compared with the true count. The mean relative error
+   (its bias) and the root mean square relative error are printed next
+   to HLL_standard_error(), which the latter should be close to.
+
+   Items are 64-bit ids, hashed with Hash_mix(), as HSet_hash_u64() does.
+*/
+
+#define BENCH_QUERIES 10000000
+#define BENCH_TRIALS 10
+#define BENCH_MAX_COUNT 10000000
+#define BENCH_ABSENT (1ULL << 62)       // ids from here on are never added
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static void bench_bloom(uint64_t items, double target){
+    /* Measure the false positive rate of a filter sized for items items at target */
+    Bloom filter;
+    Bloom_init(&filter, items, target);
+    for (uint64_t id = 0; id < items; id++){
+        Bloom_add(filter, Hash_mix(id));
+    }
+    for (uint64_t id = 0; id < items; id++){
+        if (!Bloom_might_contain(filter, Hash_mix(id))){
+            fprintf(stderr, "Bloom filter: an added item wasn't found\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    uint64_t positives = 0;
+    for (uint64_t id = BENCH_ABSENT; id < BENCH_ABSENT + BENCH_QUERIES; id++){
+        positives += Bloom_might_contain(filter, Hash_mix(id));
+    }
+    printf("%10llu %9.4f%% %9.4f%% %9.4f%% %10.2f\n", (unsigned long long)items, target * 100,
+           (double)positives / BENCH_QUERIES * 100, Bloom_false_positive_rate(filter) * 100,
+           (double)Bloom_size_in_bytes(filter) * 8 / items);
+    Bloom_destroy(&filter);
+}
+
+
+static void bench_hll(uint8_t precision){
+    /* Measure the error of sketches of the given precision (see the notes at the top) */
+    uint32_t checkpoints = 0;
+    for (uint64_t count = 1000; count <= BENCH_MAX_COUNT; count *= 10){
+        checkpoints++;
+    }
+    double error_sum[checkpoints], square_sum[checkpoints];
+    for (uint32_t i = 0; i < checkpoints; i++){
+        error_sum[i] = square_sum[i] = 0.0;
+    }
+
+    double standard_error = 0.0;
+    for (uint64_t trial = 0; trial < BENCH_TRIALS; trial++){
+        HLL sketch;
+        HLL_init(&sketch, precision);
+        standard_error = HLL_standard_error(sketch);
+        uint64_t first = trial << 40;   // every trial counts different ids
+        uint64_t next_checkpoint = 1000;
+        uint32_t checkpoint = 0;
+        for (uint64_t count = 1; count <= BENCH_MAX_COUNT; count++){
+            HLL_add(sketch, Hash_mix(first + count));
+            if (count == next_checkpoint){
+                double error = ((double)HLL_count(sketch) - count) / count;
+                error_sum[checkpoint] += error;
+                square_sum[checkpoint] += error * error;
+                checkpoint++;
+                next_checkpoint *= 10;
+            }
+        }
+        HLL_destroy(&sketch);
+    }
+
+    uint64_t count = 1000;
+    for (uint32_t i = 0; i < checkpoints; i++, count *= 10){
+        printf("%9u %12llu %9.3f%% %9.3f%% %9.3f%%\n", precision, (unsigned long long)count,
+               error_sum[i] / BENCH_TRIALS * 100, sqrt(square_sum[i] / BENCH_TRIALS) * 100, standard_error * 100);
+    }
+}
+
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+int main(void){
+    static const double targets[] = {0.01, 0.001, 0.0001};
+    static const uint64_t sizes[] = {10000, 100000, 1000000, 10000000};
+
+    printf("Bloom filter, %u lookups of items never added\n", BENCH_QUERIES);
+    printf("%10s %10s %10s %10s %10s\n", "items", "target", "measured", "estimated", "bits/item");
+    for (uint32_t t = 0; t < sizeof(targets) / sizeof(targets[0]); t++){
+        for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++){
+            bench_bloom(sizes[s], targets[t]);
+        }
+    }
+
+    printf("\nHyperLogLog, %u streams per precision\n", BENCH_TRIALS);
+    printf("%9s %12s %10s %10s %10s\n", "precision", "distinct", "bias", "rms error", "std error");
+    for (uint8_t precision = 10; precision <= 16; precision += 2){
+        bench_hll(precision);
+    }
+    return 0;
+}
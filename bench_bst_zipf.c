@@ -0,0 +1,151 @@
+#define _POSIX_C_SOURCE 200809L
+#include "binary_search_tree.h"
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* *********************** Zipfian lookup benchmark ************************ */
+/*
+   Build it twice, once per mode of the tree, and compare the two:
+     cc -std=c11 -O2 bench_bst_zipf.c binary_search_tree.c -lm -o bench_bst_plain
+     cc -std=c11 -O2 -DBST_SELF_ADJUSTING bench_bst_zipf.c binary_search_tree.c -lm -o bench_bst_splay
+
+   Times BST_contains() on BENCH_LOOKUPS lookups of keys drawn from a
+   Zipf distribution over all 256 char values: the key of rank r (in a
+   random order of the keys) comes up with probability proportional to
+   1/r^s. The larger s, the more the lookups go to a few hot keys; at
+   s = 1.2, the 10 hottest keys get about 63% of them, at s = 1.5, 80%.
+
+   Two trees of all 256 keys are looked up in:
+    - a plain tree, built by inserting the keys in random order;
+    - a balanced tree, built by BST_from_sorted_array().
+   In self-adjusting mode, both are splayed by the lookups, so the way
+   they were built only matters at the start.
+*/
+
+#define BENCH_KEYS (CHAR_MAX - CHAR_MIN + 1)
+#define BENCH_LOOKUPS 20000000
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static uint64_t bench_random(uint64_t *state){
+    /* xorshift64 */
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+
+static double bench_seconds(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+static void bench_shuffle(char keys[], uint64_t *state){
+    /* Put all the char values in keys, in random order */
+    for (uint32_t i = 0; i < BENCH_KEYS; i++){
+        keys[i] = (char)(CHAR_MIN + (int)i);
+    }
+    for (uint32_t i = BENCH_KEYS - 1; i > 0; i--){
+        uint32_t j = (uint32_t)(bench_random(state) % (i + 1));
+        char temp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = temp;
+    }
+}
+
+
+static void bench_zipf_keys(char lookups[], double s, uint64_t *state){
+    /* Fill lookups with BENCH_LOOKUPS keys drawn from a Zipf distribution
+       of exponent s, the ranks going to the keys in random order
+    */
+    char keys[BENCH_KEYS];
+    double cumulative[BENCH_KEYS];
+    bench_shuffle(keys, state);
+    double total = 0.0;
+    for (uint32_t rank = 0; rank < BENCH_KEYS; rank++){
+        total += 1.0 / pow(rank + 1, s);
+        cumulative[rank] = total;
+    }
+
+    for (uint32_t i = 0; i < BENCH_LOOKUPS; i++){
+        double point = (double)(bench_random(state) >> 11) / (double)(1ULL << 53) * total;
+        uint32_t low = 0, high = BENCH_KEYS - 1;    // the first rank whose cumulative weight exceeds point
+        while (low < high){
+            uint32_t middle = (low + high) / 2;
+            if (cumulative[middle] <= point){
+                low = middle + 1;
+            }
+            else{
+                high = middle;
+            }
+        }
+        lookups[i] = keys[low];
+    }
+}
+
+
+static double bench_lookups(BinaryTree tree, const char lookups[]){
+    /* Return the nanoseconds per BST_contains() call over all the lookups */
+    uint64_t found = 0;
+    double start = bench_seconds();
+    for (uint32_t i = 0; i < BENCH_LOOKUPS; i++){
+        found += BST_contains(tree, lookups[i]);
+    }
+    double elapsed = bench_seconds() - start;
+    if (found != BENCH_LOOKUPS){
+        fprintf(stderr, "a lookup missed a key that's in the tree\n");
+        exit(EXIT_FAILURE);
+    }
+    return elapsed * 1e9 / BENCH_LOOKUPS;
+}
+
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+int main(void){
+    static const double exponents[] = {0.0, 0.8, 1.0, 1.2, 1.5};
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    char *lookups = malloc(BENCH_LOOKUPS);
+    if (!lookups){
+        return EXIT_FAILURE;
+    }
+
+#ifdef BST_SELF_ADJUSTING
+    printf("self-adjusting (splay) mode, ns per lookup\n");
+#else
+    printf("plain mode, ns per lookup\n");
+#endif
+    printf("%8s %12s %12s\n", "zipf s", "plain tree", "balanced");
+    for (uint32_t e = 0; e < sizeof(exponents) / sizeof(exponents[0]); e++){
+        bench_zipf_keys(lookups, exponents[e], &state);
+
+        char keys[BENCH_KEYS];
+        bench_shuffle(keys, &state);
+        BinaryTree plain = NULL;
+        for (uint32_t i = 0; i < BENCH_KEYS; i++){
+            plain = BST_insert(plain, keys[i]);
+        }
+        for (uint32_t i = 0; i < BENCH_KEYS; i++){
+            keys[i] = (char)(CHAR_MIN + (int)i);
+        }
+        BinaryTree balanced = BST_from_sorted_array(keys, BENCH_KEYS);
+
+        double plain_time = bench_lookups(plain, lookups);
+        double balanced_time = bench_lookups(balanced, lookups);
+        printf("%8.1f %12.1f %12.1f\n", exponents[e], plain_time, balanced_time);
+        BST_destroy(&plain);
+        BST_destroy(&balanced);
+    }
+    free(lookups);
+    return 0;
+}
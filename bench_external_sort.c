@@ -0,0 +1,136 @@
+#define _POSIX_C_SOURCE 200809L
+#include "external_sort.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* ********************** External sort benchmark ************************** */
+/*
+   Build with:
+     cc -std=c11 -O2 -pthread bench_external_sort.c external_sort.c -o bench_external_sort
+   and run it with the size of the input in MB as an argument (256 by
+   default).
+
+   Writes that many MB of random uint64_t records to a temporary file,
+   then sorts it with ExtSort_file() under a few memory budgets, from one
+   that holds the whole input (a single run, sorted in memory) down to
+   small ones that need many runs, and, for the smaller ones, more than one
+   merge pass. ExtSort_print_stats() prints the runs, passes and MB/s of
+   each sort, and the output is checked to be in order and to hold every
+   record (by their sum).
+
+   The temporary files are tmpfile()s, so they're in the system's
+   temporary directory; set TMPDIR to time the sort on another disk, if
+   the C library honors it.
+*/
+
+#define BENCH_DEFAULT_MB 256
+#define BENCH_BUFFER_RECORDS 65536
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static uint64_t bench_random(uint64_t *state){
+    /* xorshift64 */
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+
+static int bench_compare(const void *record1, const void *record2){
+    uint64_t value1 = *(const uint64_t *)record1;
+    uint64_t value2 = *(const uint64_t *)record2;
+    return (value1 > value2) - (value1 < value2);
+}
+
+
+static uint64_t bench_write_input(FILE *file, uint64_t records){
+    /* Write records random values to file, and return their sum */
+    static uint64_t buffer[BENCH_BUFFER_RECORDS];
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    uint64_t sum = 0;
+    for (uint64_t done = 0; done < records; ){
+        size_t count = (records - done < BENCH_BUFFER_RECORDS) ? (size_t)(records - done) : BENCH_BUFFER_RECORDS;
+        for (size_t i = 0; i < count; i++){
+            buffer[i] = bench_random(&state);
+            sum += buffer[i];
+        }
+        if (fwrite(buffer, sizeof(uint64_t), count, file) != count){
+            fprintf(stderr, "couldn't write the input\n");
+            exit(EXIT_FAILURE);
+        }
+        done += count;
+    }
+    return sum;
+}
+
+
+static void bench_check_output(FILE *file, uint64_t records, uint64_t sum){
+    /* Check that file holds records values, in order, that add up to sum */
+    static uint64_t buffer[BENCH_BUFFER_RECORDS];
+    uint64_t last = 0, total = 0, read = 0;
+    rewind(file);
+    size_t count;
+    while ((count = fread(buffer, sizeof(uint64_t), BENCH_BUFFER_RECORDS, file)) > 0){
+        for (size_t i = 0; i < count; i++){
+            if (buffer[i] < last){
+                fprintf(stderr, "the output is out of order at record %llu\n", (unsigned long long)(read + i));
+                exit(EXIT_FAILURE);
+            }
+            last = buffer[i];
+            total += buffer[i];
+        }
+        read += count;
+    }
+    if (read != records || total != sum){
+        fprintf(stderr, "the output lost records: %llu of %llu\n", (unsigned long long)read, (unsigned long long)records);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+int main(int argc, char *argv[]){
+    uint64_t megabytes = (argc > 1) ? strtoull(argv[1], NULL, 10) : BENCH_DEFAULT_MB;
+    if (!megabytes){
+        fprintf(stderr, "usage: %s [input size in MB]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    uint64_t records = megabytes * 1000000 / sizeof(uint64_t);
+
+    FILE *in = tmpfile();
+    if (!in){
+        fprintf(stderr, "couldn't create the input file\n");
+        return EXIT_FAILURE;
+    }
+    uint64_t sum = bench_write_input(in, records);
+
+    // runs of the whole input (the budget holds two run buffers), then of 1/8, 1/64 and 1/1024 of it
+    size_t input_bytes = (size_t)(records * sizeof(uint64_t));
+    size_t budgets[] = {2 * input_bytes + 1024, input_bytes / 4, input_bytes / 32, input_bytes / 512};
+    for (uint32_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++){
+        FILE *out = tmpfile();
+        if (!out){
+            fprintf(stderr, "couldn't create the output file\n");
+            return EXIT_FAILURE;
+        }
+        rewind(in);
+        ExtSortStats stats;
+        if (!ExtSort_file(in, out, sizeof(uint64_t), bench_compare, budgets[b], &stats)){
+            fprintf(stderr, "the sort failed\n");
+            return EXIT_FAILURE;
+        }
+        bench_check_output(out, records, sum);
+        fclose(out);
+
+        printf("budget %8.2f MB: ", (double)budgets[b] / 1e6);
+        ExtSort_print_stats(&stats);
+    }
+    fclose(in);
+    return 0;
+}
@@ -0,0 +1,179 @@
+#define _POSIX_C_SOURCE 200809L
+#include "hash_set.h"
+#include "mutable_set.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* ************************* Hash set benchmark **************************** */
+/*
+   Build with:
+     cc -std=c11 -O2 bench_hash_set.c hash_set.c bloom_filter.c mutable_set.c binary_search_tree.c -lm -o bench_hash_set
+   Run as:
+     ./bench_hash_set [largest size]     (default 100000000)
+
+   Times the HSet on uint64_t keys for 1K to 100M elements (10x apart,
+   up to the largest size asked for): inserting n distinct random keys,
+   looking each of them up again (hits), looking up n keys that aren't
+   there (misses), then deleting them all.
+
+   The BST-backed DSet can't take part at those sizes: its items are
+   chars, so it never holds more than 256 of them. It's compared with
+   the HSet at that size instead, both holding every char value
+   (inserted in random order), on BENCH_SMALL_OPS lookups of random chars.
+*/
+
+#define BENCH_MAX_SIZE 100000000
+#define BENCH_SMALL_OPS 10000000
+
+
+struct bench_times{
+    double insert, hit, miss, del;      // nanoseconds per operation
+};
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static uint64_t bench_random(uint64_t *state){
+    /* xorshift64: no value repeats until all 2^64-1 have come up */
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+
+static double bench_seconds(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+static struct bench_times bench_hset(uint64_t n, uint64_t *found){
+    /* Time the four HSet operations on n keys.
+       *found is the number of lookups that found their key (n if all's well).
+    */
+    struct bench_times times;
+    const uint64_t seed = 0x9e3779b97f4a7c15ULL, other_seed = 0x2545f4914f6cdd1dULL;
+    HSet set;
+    HSet_init(&set, sizeof(uint64_t), HSet_hash_u64, HSet_equal_u64);
+
+    uint64_t state = seed;
+    double start = bench_seconds();
+    for (uint64_t i = 0; i < n; i++){
+        uint64_t key = bench_random(&state);
+        HSet_insert(set, &key);
+    }
+    times.insert = (bench_seconds() - start) * 1e9 / n;
+
+    *found = 0;
+    state = seed;
+    start = bench_seconds();
+    for (uint64_t i = 0; i < n; i++){
+        uint64_t key = bench_random(&state);
+        *found += HSet_contains(set, &key);
+    }
+    times.hit = (bench_seconds() - start) * 1e9 / n;
+
+    state = other_seed;
+    start = bench_seconds();
+    for (uint64_t i = 0; i < n; i++){
+        uint64_t key = bench_random(&state);
+        *found += HSet_contains(set, &key);
+    }
+    times.miss = (bench_seconds() - start) * 1e9 / n;
+
+    state = seed;
+    start = bench_seconds();
+    for (uint64_t i = 0; i < n; i++){
+        uint64_t key = bench_random(&state);
+        HSet_del(set, &key);
+    }
+    times.del = (bench_seconds() - start) * 1e9 / n;
+
+    if (!HSet_is_empty(set)){
+        fprintf(stderr, "HSet: keys left after deleting them all\n");
+        exit(EXIT_FAILURE);
+    }
+    HSet_destroy(&set);
+    return times;
+}
+
+
+static void bench_small(void){
+    /* DSet against HSet, both holding every char value */
+    DSet dset;
+    HSet hset;
+    Set_init(&dset);
+    HSet_init(&hset, sizeof(uint64_t), HSet_hash_u64, HSet_equal_u64);
+    // inserted in random order: in order, the DSet's tree would be a 256-deep list
+    char values[CHAR_MAX - CHAR_MIN + 1];
+    uint32_t how_many = sizeof(values);
+    uint64_t state = 0x2545f4914f6cdd1dULL, found = 0;
+    for (uint32_t i = 0; i < how_many; i++){
+        values[i] = (char)(CHAR_MIN + (int)i);
+    }
+    for (uint32_t i = how_many - 1; i > 0; i--){
+        uint32_t j = (uint32_t)(bench_random(&state) % (i + 1));
+        char temp = values[i];
+        values[i] = values[j];
+        values[j] = temp;
+    }
+    for (uint32_t i = 0; i < how_many; i++){
+        uint64_t key = (uint64_t)values[i];
+        Set_insert(dset, values[i]);
+        HSet_insert(hset, &key);
+    }
+
+    state = 0x9e3779b97f4a7c15ULL;
+    double start = bench_seconds();
+    for (uint32_t i = 0; i < BENCH_SMALL_OPS; i++){
+        found += Set_contains(dset, (char)bench_random(&state));
+    }
+    double dset_time = (bench_seconds() - start) * 1e9 / BENCH_SMALL_OPS;
+
+    state = 0x9e3779b97f4a7c15ULL;
+    start = bench_seconds();
+    for (uint32_t i = 0; i < BENCH_SMALL_OPS; i++){
+        uint64_t key = (uint64_t)(char)bench_random(&state);
+        found += HSet_contains(hset, &key);
+    }
+    double hset_time = (bench_seconds() - start) * 1e9 / BENCH_SMALL_OPS;
+
+    printf("\nlookups in a set of all %u chars (the most a DSet holds), ns per lookup\n", Set_size(dset));
+    printf("%14s %14s\n", "DSet (BST)", "HSet");
+    printf("%14.1f %14.1f\n", dset_time, hset_time);
+    if (found != 2ULL * BENCH_SMALL_OPS){
+        fprintf(stderr, "a lookup missed a key that's there\n");
+        exit(EXIT_FAILURE);
+    }
+    Set_destroy(&dset);
+    HSet_destroy(&hset);
+}
+
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+int main(int argc, char *argv[]){
+    uint64_t largest = (argc > 1) ? strtoull(argv[1], NULL, 10) : BENCH_MAX_SIZE;
+
+    printf("HSet of uint64_t keys, ns per operation\n");
+    printf("%12s %10s %10s %10s %10s\n", "n", "insert", "hit", "miss", "delete");
+    for (uint64_t n = 1000; n <= largest; n *= 10){
+        uint64_t found;
+        struct bench_times times = bench_hset(n, &found);
+        if (found != n){
+            fprintf(stderr, "HSet: %llu of %llu lookups found their key\n", (unsigned long long)found, (unsigned long long)n);
+            return EXIT_FAILURE;
+        }
+        printf("%12llu %10.1f %10.1f %10.1f %10.1f\n", (unsigned long long)n, times.insert, times.hit, times.miss, times.del);
+    }
+
+    bench_small();
+    return 0;
+}
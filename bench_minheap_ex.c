@@ -0,0 +1,157 @@
+#define _POSIX_C_SOURCE 200809L
+#ifdef BENCH_IMPLICIT
+#include "minheap_im.h"
+#else
+#include "minheap_ex.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* *********************** Explicit heap benchmark ************************* */
+/*
+   Build with:
+     cc -std=c11 -O2 bench_minheap_ex.c minheap_ex.c -o bench_minheap_ex
+   and, to time the implicit heap of minheap_im.h on the same workloads
+   (the two headers can't be used in the same program, as they declare
+   the same names):
+     cc -std=c11 -O2 -DBENCH_IMPLICIT bench_minheap_ex.c minheap_im.c -o bench_minheap_ex_im
+
+   Times the heap in millions of operations per second, for heaps of
+   1K to 1M items:
+    - fill/drain: n random items are inserted, then all popped (an
+      insert or a pop is one operation);
+    - hold: with n items in the heap, BENCH_HOLD_OPS times the root is
+      popped and a random item inserted (an operation is one pop and
+      one insert), so the heap stays the same size.
+
+   Only Heap_init(), Heap_insert(), Heap_pop_root(), Heap_count() and
+   Heap_destroy() are used, which every version of minheap_ex.c has had,
+   so an older version can be timed against the current one by building
+   this against it instead (versions from before the path array also
+   need stack.c and queue.c), e.g.
+     git show <commit>:minheap_ex.c > minheap_ex_old.c
+     cc -std=c11 -O2 bench_minheap_ex.c minheap_ex_old.c stack.c queue.c -o bench_minheap_ex_old
+*/
+
+#define BENCH_HOLD_OPS 2000000
+#define BENCH_MAX_SIZE 1000000
+
+#ifdef BENCH_IMPLICIT
+#define BENCH_NAME "implicit heap (minheap_im)"
+#else
+#define BENCH_NAME "explicit heap (minheap_ex)"
+#endif
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static uint64_t bench_random(uint64_t *state){
+    /* xorshift64 */
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+
+static double bench_seconds(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+/* The few heap calls used, on whichever heap this is built with */
+static void bench_init(Heap *heap_ref){
+#ifdef BENCH_IMPLICIT
+    Heap_init(heap_ref, 0, NULL);
+#else
+    Heap_init(heap_ref);
+#endif
+}
+
+
+static void bench_insert(Heap heap, char value){
+#ifdef BENCH_IMPLICIT
+    Heap_insert(heap, value, NULL);
+#else
+    Heap_insert(heap, value);
+#endif
+}
+
+
+static char bench_pop(Heap heap){
+#ifdef BENCH_IMPLICIT
+    return (char)Heap_pop(heap).priority;
+#else
+    return Heap_pop_root(heap);
+#endif
+}
+
+
+static double bench_fill_drain(uint32_t n){
+    /* Return the millions of operations per second of the fill/drain workload */
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    Heap heap;
+    bench_init(&heap);
+
+    double start = bench_seconds();
+    for (uint32_t i = 0; i < n; i++){
+        bench_insert(heap, (char)bench_random(&state));
+    }
+    char last = -128;
+    for (uint32_t i = 0; i < n; i++){
+        char value = bench_pop(heap);
+        if (value < last){
+            fprintf(stderr, "items popped out of order\n");
+            exit(EXIT_FAILURE);
+        }
+        last = value;
+    }
+    double elapsed = bench_seconds() - start;
+
+    Heap_destroy(&heap);
+    return 2.0 * n / elapsed / 1e6;
+}
+
+
+static double bench_hold(uint32_t n){
+    /* Return the millions of pop/insert pairs per second of the hold workload */
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    Heap heap;
+    bench_init(&heap);
+    for (uint32_t i = 0; i < n; i++){
+        bench_insert(heap, (char)bench_random(&state));
+    }
+
+    uint64_t checksum = 0;
+    double start = bench_seconds();
+    for (uint32_t i = 0; i < BENCH_HOLD_OPS; i++){
+        checksum += (unsigned char)bench_pop(heap);
+        bench_insert(heap, (char)bench_random(&state));
+    }
+    double elapsed = bench_seconds() - start;
+
+    if ((uint32_t)Heap_count(heap) != n || !checksum){
+        fprintf(stderr, "the heap lost items\n");
+        exit(EXIT_FAILURE);
+    }
+    Heap_destroy(&heap);
+    return BENCH_HOLD_OPS / elapsed / 1e6;
+}
+
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+int main(void){
+    printf("%s, million operations per second\n", BENCH_NAME);
+    printf("%10s %12s %12s\n", "n", "fill/drain", "hold");
+    for (uint32_t n = 1000; n <= BENCH_MAX_SIZE; n *= 10){
+        printf("%10u %12.2f %12.2f\n", n, bench_fill_drain(n), bench_hold(n));
+    }
+    return 0;
+}
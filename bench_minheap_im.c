@@ -0,0 +1,152 @@
+#define _POSIX_C_SOURCE 200809L
+#include "minheap_im.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* ************************ Heap arity benchmark *************************** */
+/*
+   Build with:
+     cc -std=c11 -O2 bench_minheap_im.c minheap_im.c -o bench_minheap_im
+   and run it with the largest heap size as an argument (1e8 by default,
+   which needs about 1.6 GB for the array).
+
+   Times the heap of minheap_im.h, in millions of operations per second,
+   with an arity of 2, 4 and 8, for heaps of 1K entries up to the largest
+   size, 10 times larger each time:
+    - push: n random priorities are inserted into an empty heap (made
+      with room for n, so that the time doesn't include the array growing);
+    - pop: the n entries are then all popped;
+    - hold: with n entries in the heap, BENCH_HOLD_OPS times the root is
+      replaced by a later priority (the popped one plus a random delay),
+      with Heap_replace(), as an event simulation does.
+   Small heaps are filled and drained as many times as it takes to do
+   BENCH_MIN_OPS pushes, for the times to be measurable. The priorities
+   popped are summed, and the sums checked to be the same for every
+   arity, so that no arity can be fast by being wrong.
+*/
+
+#define BENCH_MAX_SIZE 100000000
+#define BENCH_MIN_OPS 10000000
+#define BENCH_HOLD_OPS 10000000
+#define BENCH_DELAY 1000000         // delays are drawn from [0, BENCH_DELAY)
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static uint64_t bench_random(uint64_t *state){
+    /* xorshift64 */
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+
+static double bench_seconds(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+static void bench_push_pop(uint8_t arity, uint32_t n, double *push, double *pop, uint64_t *checksum){
+    /* Run the push and pop workloads on a heap of the given arity, setting
+       *push and *pop to their millions of operations per second
+    */
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    uint32_t rounds = (n < BENCH_MIN_OPS) ? BENCH_MIN_OPS / n : 1;
+    Heap heap;
+    Heap_init_arity(&heap, (int32_t)n, arity, NULL);
+
+    uint64_t sum = 0;
+    double push_time = 0.0, pop_time = 0.0;
+    for (uint32_t round = 0; round < rounds; round++){
+        double start = bench_seconds();
+        for (uint32_t i = 0; i < n; i++){
+            Heap_insert(heap, (int64_t)(bench_random(&state) % BENCH_DELAY), NULL);
+        }
+        double middle = bench_seconds();
+        int64_t last = 0;
+        for (uint32_t i = 0; i < n; i++){
+            int64_t priority = Heap_pop(heap).priority;
+            if (priority < last){
+                fprintf(stderr, "arity %u: entries popped out of order\n", arity);
+                exit(EXIT_FAILURE);
+            }
+            last = priority;
+            sum += (uint64_t)priority;
+        }
+        pop_time += bench_seconds() - middle;
+        push_time += middle - start;
+    }
+
+    Heap_destroy(&heap);
+    *push = (double)n * rounds / push_time / 1e6;
+    *pop = (double)n * rounds / pop_time / 1e6;
+    *checksum = sum;
+}
+
+
+static double bench_hold(uint8_t arity, uint32_t n, uint64_t *checksum){
+    /* Run the hold workload on a heap of the given arity with n entries.
+       Return millions of replaces per second.
+    */
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    Heap heap;
+    Heap_init_arity(&heap, (int32_t)n, arity, NULL);
+    for (uint32_t i = 0; i < n; i++){
+        Heap_insert(heap, (int64_t)(bench_random(&state) % BENCH_DELAY), NULL);
+    }
+
+    uint64_t sum = 0;
+    double start = bench_seconds();
+    for (uint32_t i = 0; i < BENCH_HOLD_OPS; i++){
+        int64_t now = Heap_peek(heap).priority;
+        Heap_replace(heap, now + (int64_t)(bench_random(&state) % BENCH_DELAY), NULL);
+        sum += (uint64_t)now;
+    }
+    double elapsed = bench_seconds() - start;
+
+    Heap_destroy(&heap);
+    *checksum = sum;
+    return BENCH_HOLD_OPS / elapsed / 1e6;
+}
+
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+int main(int argc, char *argv[]){
+    static const uint8_t arities[] = {2, 4, 8};
+    uint32_t how_many = sizeof(arities) / sizeof(arities[0]);
+    uint32_t max_size = (argc > 1) ? (uint32_t)strtod(argv[1], NULL) : BENCH_MAX_SIZE;
+    if (max_size < 1000 || max_size > INT32_MAX){
+        fprintf(stderr, "the largest size must be from 1000 to %d\n", INT32_MAX);
+        return EXIT_FAILURE;
+    }
+
+    printf("million operations per second (higher is better)\n");
+    printf("%10s %6s %10s %10s %10s\n", "n", "arity", "push", "pop", "hold");
+    for (uint64_t n = 1000; n <= max_size; n *= 10){
+        uint64_t first_sum = 0, first_hold_sum = 0;
+        for (uint32_t a = 0; a < how_many; a++){
+            double push, pop;
+            uint64_t sum, hold_sum;
+            bench_push_pop(arities[a], (uint32_t)n, &push, &pop, &sum);
+            double hold = bench_hold(arities[a], (uint32_t)n, &hold_sum);
+            if (a == 0){
+                first_sum = sum;
+                first_hold_sum = hold_sum;
+            }
+            else if (sum != first_sum || hold_sum != first_hold_sum){
+                fprintf(stderr, "arity %u popped different entries than arity %u\n", arities[a], arities[0]);
+                return EXIT_FAILURE;
+            }
+            printf("%10llu %6u %10.2f %10.2f %10.2f\n", (unsigned long long)n, arities[a], push, pop, hold);
+        }
+    }
+    return 0;
+}
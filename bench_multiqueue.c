@@ -0,0 +1,214 @@
+#define _POSIX_C_SOURCE 200809L
+#include "multiqueue.h"
+#include "minheap_im.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* ************************* MultiQueue benchmark ************************** */
+/*
+   Build with:
+     cc -std=c11 -O2 -pthread bench_multiqueue.c multiqueue.c minheap_im.c -o bench_multiqueue
+
+   Two measurements:
+    - throughput: every thread does BENCH_OPS insert/pop pairs on a queue
+      that starts with BENCH_PREFILL entries, for 1, 2, 4 ... BENCH_MAX_THREADS
+      threads, on a MultiQueue and on a single implicit heap behind one
+      mutex, which is what the MultiQueue replaces;
+    - rank error: BENCH_RANK_ITEMS distinct priorities are inserted in random
+      order, then all popped; the rank of each popped priority among those
+      still in the queue (0 for the smallest, which a strict priority queue
+      would always return) is looked up in a Fenwick tree over the
+      priorities. The mean and the largest rank are reported for a
+      MultiQueue set up for each number of threads, since its rank error
+      depends on its number of heaps, c*threads.
+*/
+
+#define BENCH_MAX_THREADS 8
+#define BENCH_C 2                   // heaps per thread
+#define BENCH_OPS 1000000           // insert/pop pairs per thread
+#define BENCH_PREFILL 100000
+#define BENCH_RANK_ITEMS 1000000
+
+
+struct locked_heap{
+    pthread_mutex_t lock;
+    Heap heap;
+};
+
+struct bench_thread{
+    MultiQueue mq;              // the queue under test: mq, or heap if mq is NULL
+    struct locked_heap *heap;
+    uint64_t seed;
+};
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static uint64_t bench_random(uint64_t *state){
+    /* xorshift64: good enough to spread priorities */
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+
+static double bench_seconds(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+static void *bench_worker(void *arg){
+    /* Do BENCH_OPS insert/pop pairs on the queue under test */
+    struct bench_thread *thread = arg;
+    uint64_t state = thread->seed;
+
+    for (uint32_t i = 0; i < BENCH_OPS; i++){
+        int64_t priority = (int64_t)(bench_random(&state) >> 40);
+        if (thread->mq){
+            MQ_insert(thread->mq, priority, NULL);
+            MQ_pop(thread->mq, NULL, NULL);
+        }
+        else{
+            pthread_mutex_lock(&thread->heap->lock);
+            Heap_insert(thread->heap->heap, priority, NULL);
+            Heap_pop(thread->heap->heap);
+            pthread_mutex_unlock(&thread->heap->lock);
+        }
+    }
+    return NULL;
+}
+
+
+static double bench_throughput(MultiQueue mq, struct locked_heap *heap, uint32_t threads){
+    /* Run threads workers on the queue under test, after filling it with
+       BENCH_PREFILL entries. Return millions of insert/pop pairs per second.
+    */
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    for (uint32_t i = 0; i < BENCH_PREFILL; i++){
+        int64_t priority = (int64_t)(bench_random(&state) >> 40);
+        if (mq){
+            MQ_insert(mq, priority, NULL);
+        }
+        else{
+            Heap_insert(heap->heap, priority, NULL);
+        }
+    }
+
+    pthread_t ids[BENCH_MAX_THREADS];
+    struct bench_thread args[BENCH_MAX_THREADS];
+    double start = bench_seconds();
+    for (uint32_t i = 0; i < threads; i++){
+        args[i] = (struct bench_thread){mq, heap, 0x2545f4914f6cdd1dULL * (i + 1)};
+        pthread_create(&ids[i], NULL, bench_worker, &args[i]);
+    }
+    for (uint32_t i = 0; i < threads; i++){
+        pthread_join(ids[i], NULL);
+    }
+    double elapsed = bench_seconds() - start;
+    return (double)threads * BENCH_OPS / elapsed / 1e6;
+}
+
+
+static void fenwick_add(int32_t tree[], uint32_t size, uint32_t index, int32_t delta){
+    for (index++; index <= size; index += index & -index){
+        tree[index] += delta;
+    }
+}
+
+
+static uint32_t fenwick_prefix(const int32_t tree[], uint32_t index){
+    /* Return the sum of the entries below index */
+    int32_t sum = 0;
+    for (; index > 0; index -= index & -index){
+        sum += tree[index];
+    }
+    return (uint32_t)sum;
+}
+
+
+static void bench_rank_error(uint32_t threads, double *mean, uint32_t *max){
+    /* Measure the rank error of a MultiQueue set up for threads threads,
+       as described in the notes at the top.
+    */
+    uint32_t *order = malloc(sizeof(uint32_t) * BENCH_RANK_ITEMS);
+    int32_t *tree = calloc(BENCH_RANK_ITEMS + 1, sizeof(int32_t));
+    if (!order || !tree){
+        exit(EXIT_FAILURE);
+    }
+    // the priorities 0 .. BENCH_RANK_ITEMS-1, shuffled
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    for (uint32_t i = 0; i < BENCH_RANK_ITEMS; i++){
+        order[i] = i;
+    }
+    for (uint32_t i = BENCH_RANK_ITEMS - 1; i > 0; i--){
+        uint32_t j = (uint32_t)(bench_random(&state) % (i + 1));
+        uint32_t temp = order[i];
+        order[i] = order[j];
+        order[j] = temp;
+    }
+
+    MultiQueue mq;
+    MQ_init(&mq, threads, BENCH_C);
+    for (uint32_t i = 0; i < BENCH_RANK_ITEMS; i++){
+        MQ_insert(mq, order[i], NULL);
+        fenwick_add(tree, BENCH_RANK_ITEMS, order[i], 1);
+    }
+
+    uint64_t total = 0;
+    *max = 0;
+    int64_t priority;
+    while (MQ_pop(mq, &priority, NULL)){
+        uint32_t rank = fenwick_prefix(tree, (uint32_t)priority);     // smaller priorities still queued
+        fenwick_add(tree, BENCH_RANK_ITEMS, (uint32_t)priority, -1);
+        total += rank;
+        if (rank > *max){
+            *max = rank;
+        }
+    }
+    *mean = (double)total / BENCH_RANK_ITEMS;
+
+    MQ_destroy(&mq);
+    free(tree);
+    free(order);
+}
+
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+int main(void){
+    printf("throughput (million insert/pop pairs per second)\n");
+    printf("%8s %14s %14s\n", "threads", "locked heap", "multiqueue");
+    for (uint32_t threads = 1; threads <= BENCH_MAX_THREADS; threads *= 2){
+        struct locked_heap heap;
+        pthread_mutex_init(&heap.lock, NULL);
+        Heap_init(&heap.heap, BENCH_PREFILL, NULL);
+        double locked = bench_throughput(NULL, &heap, threads);
+        Heap_destroy(&heap.heap);
+        pthread_mutex_destroy(&heap.lock);
+
+        MultiQueue mq;
+        MQ_init(&mq, threads, BENCH_C);
+        double relaxed = bench_throughput(mq, NULL, threads);
+        MQ_destroy(&mq);
+
+        printf("%8u %14.2f %14.2f\n", threads, locked, relaxed);
+    }
+
+    printf("\nrank error over %u pops (c = %u)\n", BENCH_RANK_ITEMS, BENCH_C);
+    printf("%8s %8s %10s %10s\n", "threads", "heaps", "mean", "max");
+    for (uint32_t threads = 1; threads <= BENCH_MAX_THREADS; threads *= 2){
+        double mean;
+        uint32_t max;
+        bench_rank_error(threads, &mean, &max);
+        printf("%8u %8u %10.2f %10u\n", threads, threads * BENCH_C, mean, max);
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+#define _POSIX_C_SOURCE 200809L
+#include "mutable_set.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* *************************** DSet benchmark ****************************** */
+/*
+   Build it once per backend:
+     cc -std=c11 -O2 bench_mutable_set.c mutable_set.c binary_search_tree.c -o bench_dset_bst
+     cc -std=c11 -O2 -DDSET_BITMAP bench_mutable_set.c mutable_set_bitmap.c -o bench_dset_bitmap
+
+   Times the whole-set operations of a DSet, in ns per call, on sets of
+   16 to 255 items. A DSet never holds more than 256, since its items
+   are chars, and one value is kept out of the sets for the 'differ'
+   case below. The items are inserted in random order. The operations are:
+    - Set_size();
+    - Set_is_same() on two equal sets, which compares every item;
+    - Set_is_same() on two sets of the same size whose smallest items
+      differ (the other one has CHAR_MIN, which no other set holds,
+      instead), which should stop at the first item;
+    - Set_is_subset() (which tests for a proper subset) of the first set
+      less one item in the first set, which is true, so every item is
+      compared; and of the other set less one item in the first set,
+      which should stop at the first item.
+    - Set_items(), including the free() of the array it returns.
+*/
+
+#define BENCH_CALLS 1000000
+#define BENCH_KEYS (CHAR_MAX - CHAR_MIN + 1)
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static uint64_t bench_random(uint64_t *state){
+    /* xorshift64 */
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+
+static double bench_seconds(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+static DSet bench_make_set(const char keys[], uint32_t size, int skip){
+    /* A set of the first size keys, in the order given, but for the key
+       skip (if any), which is replaced by the last key
+    */
+    DSet set;
+    Set_init(&set);
+    for (uint32_t i = 0; i < size; i++){
+        Set_insert(set, (keys[i] == skip) ? keys[BENCH_KEYS - 1] : keys[i]);
+    }
+    return set;
+}
+
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+int main(void){
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    char keys[BENCH_KEYS];
+    for (uint32_t i = 0; i < BENCH_KEYS; i++){
+        keys[i] = (char)(CHAR_MIN + (int)i);
+    }
+    for (uint32_t i = BENCH_KEYS - 1; i > 0; i--){
+        uint32_t j = (uint32_t)(bench_random(&state) % (i + 1));
+        char temp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = temp;
+    }
+    // the key left out of the sets is CHAR_MIN, so that a set it's put in differs from the others from its first item on
+    for (uint32_t i = 0; i < BENCH_KEYS; i++){
+        if (keys[i] == CHAR_MIN){
+            keys[i] = keys[BENCH_KEYS - 1];
+            keys[BENCH_KEYS - 1] = CHAR_MIN;
+        }
+    }
+
+#ifdef DSET_BITMAP
+    printf("DSet, bitmap backend, ns per call\n");
+#else
+    printf("DSet, BST backend, ns per call\n");
+#endif
+    printf("%6s %10s %10s %10s %10s %10s %10s\n", "items", "size", "same", "differ", "not subset", "subset", "items");
+    static const uint32_t sizes[] = {16, 32, 64, 128, BENCH_KEYS - 1};
+    for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++){
+        uint32_t size = sizes[s];
+        // in 'other', the smallest of the keys is replaced by the one left out, so that it has an item smaller than all of set's
+        int smallest = CHAR_MAX;
+        for (uint32_t i = 0; i < size; i++){
+            smallest = (keys[i] < smallest) ? keys[i] : smallest;
+        }
+        DSet set = bench_make_set(keys, size, CHAR_MAX + 1);
+        DSet copy = bench_make_set(keys, size, CHAR_MAX + 1);
+        DSet other = bench_make_set(keys, size, smallest);
+        DSet smaller = bench_make_set(keys, size - 1, CHAR_MAX + 1);
+        DSet other_smaller = bench_make_set(keys, size - 1, smallest);
+        uint64_t checks = 0;
+
+        double start = bench_seconds();
+        for (uint32_t i = 0; i < BENCH_CALLS; i++){
+            checks += Set_size(set);
+        }
+        double size_time = (bench_seconds() - start) * 1e9 / BENCH_CALLS;
+
+        start = bench_seconds();
+        for (uint32_t i = 0; i < BENCH_CALLS; i++){
+            checks += Set_is_same(set, copy);
+        }
+        double same_time = (bench_seconds() - start) * 1e9 / BENCH_CALLS;
+
+        start = bench_seconds();
+        for (uint32_t i = 0; i < BENCH_CALLS; i++){
+            checks += Set_is_same(set, other);
+        }
+        double differ_time = (bench_seconds() - start) * 1e9 / BENCH_CALLS;
+
+        start = bench_seconds();
+        for (uint32_t i = 0; i < BENCH_CALLS; i++){
+            checks += Set_is_subset(other_smaller, set);
+        }
+        double not_subset_time = (bench_seconds() - start) * 1e9 / BENCH_CALLS;
+
+        start = bench_seconds();
+        for (uint32_t i = 0; i < BENCH_CALLS; i++){
+            checks += Set_is_subset(smaller, set);
+        }
+        double subset_time = (bench_seconds() - start) * 1e9 / BENCH_CALLS;
+
+        start = bench_seconds();
+        for (uint32_t i = 0; i < BENCH_CALLS; i++){
+            char *items = Set_items(set);
+            checks += (unsigned char)items[0];
+            free(items);
+        }
+        double items_time = (bench_seconds() - start) * 1e9 / BENCH_CALLS;
+
+        printf("%6u %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", size, size_time, same_time, differ_time,
+               not_subset_time, subset_time, items_time);
+        if (!checks){
+            return EXIT_FAILURE;    // never happens: it's there so that the calls can't be optimized away
+        }
+        Set_destroy(&set);
+        Set_destroy(&copy);
+        Set_destroy(&other);
+        Set_destroy(&smaller);
+        Set_destroy(&other_smaller);
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+#define _POSIX_C_SOURCE 200809L
+#include "radix_heap.h"
+#include "minheap_im.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* *********************** Radix heap benchmark **************************** */
+/*
+   Build with:
+     cc -std=c11 -O2 bench_radix_heap.c radix_heap.c minheap_im.c -o bench_radix_heap
+
+   Compares the radix heap with the binary heap of minheap_im.h on two
+   monotone workloads, for a few queue sizes:
+    - hold: the queue is filled with n timestamps, then BENCH_HOLD_OPS
+      times the smallest is popped and a later one (the popped one plus a
+      random delay) is inserted, as an event simulation does;
+    - fill/drain: n random keys are inserted, then all popped, as a
+      Dijkstra run with many equal-distance ties does.
+   The keys popped by both heaps are summed, and the sums checked to be
+   equal, so that neither heap can be fast by being wrong.
+*/
+
+#define BENCH_HOLD_OPS 10000000
+#define BENCH_DELAY 1000000         // delays are drawn from [0, BENCH_DELAY)
+
+
+enum bench_kind {BENCH_RADIX, BENCH_BINARY};
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static uint64_t bench_random(uint64_t *state){
+    /* xorshift64 */
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+
+static double bench_seconds(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+static double bench_hold(enum bench_kind kind, uint32_t n, uint64_t *checksum){
+    /* Run the hold workload on a queue of n entries.
+       Return nanoseconds per pop/insert pair.
+    */
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    RHeap radix = NULL;
+    Heap binary = NULL;
+    if (kind == BENCH_RADIX){
+        RHeap_init(&radix);
+    }
+    else{
+        Heap_init(&binary, (int32_t)n, NULL);
+    }
+    for (uint32_t i = 0; i < n; i++){
+        uint64_t key = bench_random(&state) % BENCH_DELAY;
+        if (kind == BENCH_RADIX){
+            RHeap_insert(radix, key, NULL);
+        }
+        else{
+            Heap_insert(binary, (int64_t)key, NULL);
+        }
+    }
+
+    uint64_t sum = 0;
+    double start = bench_seconds();
+    for (uint32_t i = 0; i < BENCH_HOLD_OPS; i++){
+        uint64_t delay = bench_random(&state) % BENCH_DELAY;
+        uint64_t now;
+        if (kind == BENCH_RADIX){
+            now = RHeap_pop(radix, NULL);
+            RHeap_insert(radix, now + delay, NULL);
+        }
+        else{
+            // a pop then an insert, done as one sift like the radix heap gets to
+            now = (uint64_t)Heap_peek(binary).priority;
+            Heap_replace(binary, (int64_t)(now + delay), NULL);
+        }
+        sum += now;
+    }
+    double elapsed = bench_seconds() - start;
+
+    RHeap_destroy(&radix);
+    Heap_destroy(&binary);
+    *checksum = sum;
+    return elapsed * 1e9 / BENCH_HOLD_OPS;
+}
+
+
+static double bench_fill_drain(enum bench_kind kind, uint32_t n, uint64_t *checksum){
+    /* Run the fill/drain workload with n keys.
+       Return nanoseconds per key (one insert and one pop).
+    */
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    RHeap radix = NULL;
+    Heap binary = NULL;
+    if (kind == BENCH_RADIX){
+        RHeap_init(&radix);
+    }
+    else{
+        Heap_init(&binary, 0, NULL);
+    }
+
+    uint64_t sum = 0;
+    double start = bench_seconds();
+    for (uint32_t i = 0; i < n; i++){
+        uint64_t key = bench_random(&state) % BENCH_DELAY;
+        if (kind == BENCH_RADIX){
+            RHeap_insert(radix, key, NULL);
+        }
+        else{
+            Heap_insert(binary, (int64_t)key, NULL);
+        }
+    }
+    uint64_t last = 0;
+    for (uint32_t i = 0; i < n; i++){
+        uint64_t key = (kind == BENCH_RADIX) ? RHeap_pop(radix, NULL) : (uint64_t)Heap_pop(binary).priority;
+        if (key < last){
+            fprintf(stderr, "keys popped out of order\n");
+            exit(EXIT_FAILURE);
+        }
+        last = key;
+        sum += key;
+    }
+    double elapsed = bench_seconds() - start;
+
+    RHeap_destroy(&radix);
+    Heap_destroy(&binary);
+    *checksum = sum;
+    return elapsed * 1e9 / n;
+}
+
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+int main(void){
+    static const uint32_t sizes[] = {1000, 100000, 1000000, 10000000};
+    uint32_t how_many = sizeof(sizes) / sizeof(sizes[0]);
+
+    printf("nanoseconds per operation (lower is better)\n");
+    printf("%-12s %10s %12s %12s\n", "workload", "n", "binary heap", "radix heap");
+    for (uint32_t i = 0; i < how_many; i++){
+        uint64_t radix_sum, binary_sum;
+        double radix = bench_hold(BENCH_RADIX, sizes[i], &radix_sum);
+        double binary = bench_hold(BENCH_BINARY, sizes[i], &binary_sum);
+        if (radix_sum != binary_sum){
+            fprintf(stderr, "hold: the heaps popped different keys\n");
+            return EXIT_FAILURE;
+        }
+        printf("%-12s %10u %12.1f %12.1f\n", "hold", sizes[i], binary, radix);
+    }
+    for (uint32_t i = 0; i < how_many; i++){
+        uint64_t radix_sum, binary_sum;
+        double radix = bench_fill_drain(BENCH_RADIX, sizes[i], &radix_sum);
+        double binary = bench_fill_drain(BENCH_BINARY, sizes[i], &binary_sum);
+        if (radix_sum != binary_sum){
+            fprintf(stderr, "fill/drain: the heaps popped different keys\n");
+            return EXIT_FAILURE;
+        }
+        printf("%-12s %10u %12.1f %12.1f\n", "fill/drain", sizes[i], binary, radix);
+    }
+    return 0;
+}
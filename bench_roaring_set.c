@@ -0,0 +1,137 @@
+#define _POSIX_C_SOURCE 200809L
+#include "roaring_set.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ******************** Parallel set algebra benchmark ********************* */
+/*
+   Build with:
+     cc -std=c11 -O2 -pthread bench_roaring_set.c roaring_set.c -o bench_roaring_set
+
+   Times RSet_union(), RSet_intersection() and RSet_difference() against
+   their _parallel versions with 1, 2, 4 ... BENCH_MAX_THREADS threads,
+   on two pairs of sets of BENCH_MEMBERS members each:
+    - sparse: random values over the whole uint32_t range, so that every
+      chunk is an array container;
+    - dense: random values below BENCH_DENSE_RANGE, so that the chunks
+      are bitmap containers.
+   Each operation is run BENCH_REPEATS times and the fastest time kept;
+   the parallel results are checked to be the same size as the serial
+   ones. How much the threads gain depends on the cores available, which
+   the program prints first.
+*/
+
+#define BENCH_MEMBERS 20000000
+#define BENCH_DENSE_RANGE (1u << 28)
+#define BENCH_MAX_THREADS 8
+#define BENCH_REPEATS 3
+
+
+typedef RSet (*bench_serial)(RSet set1, RSet set2);
+typedef RSet (*bench_parallel)(RSet set1, RSet set2, uint32_t threads);
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static uint64_t bench_random(uint64_t *state){
+    /* xorshift64 */
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+
+static double bench_seconds(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+static RSet bench_make_set(uint64_t seed, uint32_t range){
+    /* A set of BENCH_MEMBERS random values below range (0 for all of uint32_t) */
+    RSet set;
+    RSet_init(&set);
+    for (uint32_t i = 0; i < BENCH_MEMBERS; i++){
+        uint32_t value = (uint32_t)(bench_random(&seed) >> 32);
+        RSet_insert(set, range ? value % range : value);
+    }
+    return set;
+}
+
+
+static double bench_time(RSet set1, RSet set2, bench_serial serial, bench_parallel parallel, uint32_t threads,
+                         uint64_t *size){
+    /* Return the fastest of BENCH_REPEATS runs of the operation, in
+       milliseconds: serial if threads is 0, else parallel with threads
+       threads. *size is set to the size of the result.
+    */
+    double best = 0;
+    for (uint32_t i = 0; i < BENCH_REPEATS; i++){
+        double start = bench_seconds();
+        RSet result = threads ? parallel(set1, set2, threads) : serial(set1, set2);
+        double elapsed = (bench_seconds() - start) * 1e3;
+        best = (i == 0 || elapsed < best) ? elapsed : best;
+        *size = RSet_size(result);
+        RSet_destroy(&result);
+    }
+    return best;
+}
+
+
+static void bench_workload(const char *name, RSet set1, RSet set2){
+    /* Print the serial and parallel times of the three operations */
+    static const char *operations[] = {"union", "intersection", "difference"};
+    static const bench_serial serials[] = {RSet_union, RSet_intersection, RSet_difference};
+    static const bench_parallel parallels[] = {RSet_union_parallel, RSet_intersection_parallel, RSet_difference_parallel};
+
+    printf("\n%s: %llu and %llu members, ms (speedup over serial)\n", name,
+           (unsigned long long)RSet_size(set1), (unsigned long long)RSet_size(set2));
+    printf("%-14s %10s", "operation", "serial");
+    for (uint32_t threads = 1; threads <= BENCH_MAX_THREADS; threads *= 2){
+        printf(" %10u thr", threads);
+    }
+    printf("\n");
+
+    for (uint32_t op = 0; op < 3; op++){
+        uint64_t serial_size, parallel_size;
+        double serial = bench_time(set1, set2, serials[op], parallels[op], 0, &serial_size);
+        printf("%-14s %10.1f", operations[op], serial);
+        for (uint32_t threads = 1; threads <= BENCH_MAX_THREADS; threads *= 2){
+            double parallel = bench_time(set1, set2, serials[op], parallels[op], threads, &parallel_size);
+            if (parallel_size != serial_size){
+                fprintf(stderr, "%s with %u threads: %llu members instead of %llu\n", operations[op], threads,
+                        (unsigned long long)parallel_size, (unsigned long long)serial_size);
+                exit(EXIT_FAILURE);
+            }
+            printf(" %6.1f (%4.2fx)", parallel, serial / parallel);
+        }
+        printf("\n");
+    }
+}
+
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+int main(void){
+    printf("%ld core(s) online\n", sysconf(_SC_NPROCESSORS_ONLN));
+
+    RSet set1 = bench_make_set(0x9e3779b97f4a7c15ULL, 0);
+    RSet set2 = bench_make_set(0x2545f4914f6cdd1dULL, 0);
+    bench_workload("sparse (array containers)", set1, set2);
+    RSet_destroy(&set1);
+    RSet_destroy(&set2);
+
+    set1 = bench_make_set(0x9e3779b97f4a7c15ULL, BENCH_DENSE_RANGE);
+    set2 = bench_make_set(0x2545f4914f6cdd1dULL, BENCH_DENSE_RANGE);
+    bench_workload("dense (bitmap containers)", set1, set2);
+    RSet_destroy(&set1);
+    RSet_destroy(&set2);
+    return 0;
+}
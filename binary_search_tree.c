@@ -1,6 +1,47 @@
 #include "binary_search_tree.h"
+#include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+
+#define BST_FILE_MAGIC "BST1"
+#define BST_FILE_HEADER_SIZE 8     // 4 magic bytes + uint32_t key count
+#define BST_FILE_RECORD_SIZE 5     // key + uint32_t occurrence count
+#define BST_IO_BUFFER_SIZE 4096
+
+#define BST_BATCH_WIDTH 16     // number of lookups BST_contains_batch() keeps in flight
+
+#if defined(__GNUC__)
+#define BST_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define BST_PREFETCH(address)
+#endif
+
+
+// buffered reader/writer used by BST_save() and BST_load()
+struct bst_stream{
+    int fd;
+    bool failed;        // set on the first I/O error; everything after that is a no-op
+    uint32_t position;  // next byte to read from/write to buffer
+    uint32_t length;    // number of valid bytes in buffer (reading only)
+    bool has_previous;  // a record has been read already (reading only)
+    char previous;      // the key of the last record read (reading only)
+    char buffer[BST_IO_BUFFER_SIZE];
+};
+
+// read-only view of a saved tree, mapped into memory by BST_map()
+struct binary_tree_view{
+    const unsigned char *records;   // the sorted (key, count) records, right after the file header
+    uint32_t count;                 // number of records
+    void *map;          // start of the mapping, for munmap()
+    size_t map_length;
+};
 
 
 
@@ -9,12 +50,13 @@
 /* ***************************** Private ****************************** */
 /* -------------------------------------------------------------------- */
 
-static char BST_get_in_order_successor_P(BinaryTree tree_ptr){
-    /* Return the value of the in-order successor of tree_ptr.
-       Called by the node removal routine.
+static BinaryTree BST_get_in_order_successor_P(BinaryTree tree_ptr){
+    /* Return the in-order successor of tree_ptr.
+       Called by the node removal routine, which needs both its
+       value and its count.
     */
     if(!tree_ptr->left_child){  // can't go any farther left, so this is the in-order successor
-        return tree_ptr->data;        //  to the right, there are only larger values
+        return tree_ptr;        //  to the right, there are only larger values
     }
     return BST_get_in_order_successor_P(tree_ptr->left_child);  // tail recursion
 };
@@ -77,6 +119,350 @@ static void BST_cut_down_P(BinaryTree tree_ptr){
 };
 
 
+#ifdef BST_SELF_ADJUSTING
+
+static void BST_rotate_right_P(BinaryTree tree_ptr){
+    /* Rotate tree_ptr right, in place.
+       tree_ptr must have a left child.
+
+       A normal rotation would make the left child the new root of
+       the subtree, which means whoever points to tree_ptr has to be
+       updated. Instead, the values of the two nodes are swapped and
+       the children are rearranged around them, so tree_ptr stays
+       where it is and ends up holding the value (and count) of its
+       former left child:
+
+                T                L
+               / \              / \
+              L   C    -->     A   T
+             / \                  / \
+            A   B                B   C
+    */
+    BinaryTree left = tree_ptr->left_child;
+
+    char temp = tree_ptr->data;
+    tree_ptr->data = left->data;
+    left->data = temp;
+
+    uint32_t temp_count = tree_ptr->count;
+    tree_ptr->count = left->count;
+    left->count = temp_count;
+
+    tree_ptr->left_child = left->left_child;
+    left->left_child = left->right_child;
+    left->right_child = tree_ptr->right_child;
+    tree_ptr->right_child = left;
+};
+
+
+
+static void BST_rotate_left_P(BinaryTree tree_ptr){
+    /* Mirror image of BST_rotate_right_P().
+       tree_ptr must have a right child.
+    */
+    BinaryTree right = tree_ptr->right_child;
+
+    char temp = tree_ptr->data;
+    tree_ptr->data = right->data;
+    right->data = temp;
+
+    uint32_t temp_count = tree_ptr->count;
+    tree_ptr->count = right->count;
+    right->count = temp_count;
+
+    tree_ptr->right_child = right->right_child;
+    right->right_child = right->left_child;
+    right->left_child = tree_ptr->left_child;
+    tree_ptr->left_child = right;
+};
+
+
+
+static void BST_splay_P(BinaryTree tree, char the_value){
+    /* Bring the node holding the_value up to tree (the root of the
+       subtree), using the zig-zig and zig-zag steps of a splay tree.
+       If the_value isn't in the tree, the last node visited on the
+       search path is brought up instead.
+
+       Since the rotations are done in place (see BST_rotate_right_P()),
+       no pointer needs to be returned: tree stays the root.
+    */
+    if (!tree || tree->data == the_value){
+        return;
+    }
+
+    if (the_value < tree->data){
+        BinaryTree left = tree->left_child;
+        if (!left){
+            return;
+        }
+        if (the_value < left->data){      // zig-zig
+            BST_splay_P(left->left_child, the_value);
+            BST_rotate_right_P(tree);
+        }else if (the_value > left->data){    // zig-zag
+            BST_splay_P(left->right_child, the_value);
+            if (left->right_child){
+                BST_rotate_left_P(left);
+            }
+        }
+        if (tree->left_child){
+            BST_rotate_right_P(tree);
+        }
+    }else{
+        BinaryTree right = tree->right_child;
+        if (!right){
+            return;
+        }
+        if (the_value > right->data){     // zig-zig
+            BST_splay_P(right->right_child, the_value);
+            BST_rotate_left_P(tree);
+        }else if (the_value < right->data){   // zig-zag
+            BST_splay_P(right->left_child, the_value);
+            if (right->left_child){
+                BST_rotate_right_P(right);
+            }
+        }
+        if (tree->right_child){
+            BST_rotate_left_P(tree);
+        }
+    }
+};
+
+#endif
+
+
+
+static uint32_t BST_count_P(BinaryTree tree){
+    /* Count the nodes, i.e. the distinct keys, in the tree 
+       (unlike BST_count_nodes(), which counts every occurrence).
+       Used for the key count in the file header.
+    */
+    if (!tree){
+        return 0;
+    }
+    return 1 + BST_count_P(tree->left_child) + BST_count_P(tree->right_child);
+};
+
+
+
+static bool BST_write_all_P(int fd, const char *bytes, size_t length){
+    /* Write length bytes to fd, retrying on partial writes and on
+       writes interrupted by a signal (EINTR).
+       Return false if write() fails otherwise.
+    */
+    while (length){
+        ssize_t written = write(fd, bytes, length);
+        if (written < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        length -= written;
+    }
+    return true;
+};
+
+
+
+static ssize_t BST_read_P(int fd, void *buffer, size_t length){
+    /* read() up to length bytes from fd, retrying if a signal interrupts
+       it before anything is read (EINTR)
+    */
+    ssize_t got;
+    do{
+        got = read(fd, buffer, length);
+    } while (got < 0 && errno == EINTR);
+    return got;
+};
+
+
+
+static void BST_stream_flush_P(struct bst_stream *stream){
+    /* Write out whatever is in the stream buffer */
+    if (!stream->failed && stream->position){
+        stream->failed = !BST_write_all_P(stream->fd, stream->buffer, stream->position);
+    }
+    stream->position = 0;
+};
+
+
+
+static void BST_save_P(BinaryTree tree, struct bst_stream *stream){
+    /* Traverse the tree in-order and append a (key, count) record
+       for each node to the stream buffer, flushing the buffer 
+       whenever it fills up.
+    */
+    if (!tree || stream->failed){
+        return;
+    }
+    BST_save_P(tree->left_child, stream);
+
+    if (stream->position + BST_FILE_RECORD_SIZE > BST_IO_BUFFER_SIZE){
+        BST_stream_flush_P(stream);
+    }
+    char *record = stream->buffer + stream->position;
+    record[0] = tree->data;
+    record[1] = tree->count & 0xFF;
+    record[2] = (tree->count >> 8) & 0xFF;
+    record[3] = (tree->count >> 16) & 0xFF;
+    record[4] = (tree->count >> 24) & 0xFF;
+    stream->position += BST_FILE_RECORD_SIZE;
+
+    BST_save_P(tree->right_child, stream);
+};
+
+
+
+static bool BST_stream_next_P(struct bst_stream *stream, char *the_value){
+    /* Read the next byte from the stream into *the_value, refilling
+       the buffer from the file when it runs out. 
+       Return false on a read error or a premature end of file.
+    */
+    if (stream->position == stream->length){
+        ssize_t got = BST_read_P(stream->fd, stream->buffer, BST_IO_BUFFER_SIZE);
+        if (got <= 0){
+            stream->failed = true;
+            return false;
+        }
+        stream->length = got;
+        stream->position = 0;
+    }
+    *the_value = stream->buffer[stream->position++];
+    return true;
+};
+
+
+
+static uint32_t BST_decode_count_P(const unsigned char bytes[]){
+    /* Decode a little-endian uint32_t */
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 
+         | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+};
+
+
+
+static bool BST_check_record_P(const unsigned char record[], bool has_previous, char previous){
+    /* Return true if a (key, count) record read from a file can follow
+       a record with key previous (if has_previous): its key has to be
+       larger, since keys are saved sorted and only once each, and its
+       count can't be 0, since a node holds at least one occurrence.
+    */
+    if (has_previous && (char)record[0] <= previous){
+        return false;
+    }
+    return BST_decode_count_P(record + 1) >= 1;
+};
+
+
+
+static BinaryTree BST_load_P(struct bst_stream *stream, uint32_t how_many){
+    /* Build a balanced tree out of the next how_many records in the stream.
+
+       The records come in sorted order, so the first half of them make up
+       the left subtree, the one in the middle is the root, and the rest
+       make up the right subtree. Building the left subtree first means
+       the records are consumed in exactly the order they're read in, so
+       each one is only read once and nothing needs to be buffered beyond
+       the stream buffer itself.
+
+       Each record is checked as it's read (see BST_check_record_P()), 
+       so that a corrupt file can't make for an invalid tree.
+       Returns NULL (and frees any nodes already built) if anything fails.
+    */
+    if (!how_many || stream->failed){
+        return NULL;
+    }
+
+    uint32_t left_count = how_many / 2;
+    BinaryTree left = BST_load_P(stream, left_count);
+
+    char record[BST_FILE_RECORD_SIZE];
+    for (uint8_t i = 0; i < BST_FILE_RECORD_SIZE && !stream->failed; i++){
+        BST_stream_next_P(stream, &record[i]);
+    }
+
+    if (!stream->failed && !BST_check_record_P((unsigned char *)record, stream->has_previous, stream->previous)){
+        stream->failed = true;
+    }
+    stream->has_previous = true;
+    stream->previous = record[0];
+
+    BinaryTree newnode = NULL;
+    if (stream->failed || !(newnode = malloc(sizeof(struct binary_tree)))){
+        stream->failed = true;
+        BST_cut_down_P(left);
+        return NULL;
+    }
+    newnode->data = record[0];
+    newnode->count = BST_decode_count_P((unsigned char *)record + 1);
+    newnode->left_child = left;
+    newnode->right_child = BST_load_P(stream, how_many - left_count - 1);
+
+    if (stream->failed){
+        BST_cut_down_P(newnode);
+        return NULL;
+    }
+    return newnode;
+};
+
+
+
+static bool BST_read_header_P(const unsigned char header[], uint32_t *count){
+    /* Check the magic bytes and decode the little-endian key count,
+       which can't be more than the number of distinct chars.
+    */
+    if (memcmp(header, BST_FILE_MAGIC, 4)){
+        return false;
+    }
+    *count = BST_decode_count_P(header + 4);
+    return *count <= 1u << CHAR_BIT;
+};
+
+
+static BinaryTree BST_from_sorted_P(const char the_array[], uint32_t low, uint32_t high){
+    /* Build a balanced tree out of the sorted values in the_array,
+       from index low (inclusive) to index high (exclusive).
+
+       The value in the middle becomes the root. If it has duplicates,
+       they're all next to it, since the array is sorted: the whole run
+       goes into the root's count, and the values to the left and to the
+       right of the run make up the left and right subtrees.
+       Each value is looked at once, so this is O(n).
+
+       Returns NULL (and frees any nodes already built) if malloc fails.
+    */
+    if (low >= high){
+        return NULL;
+    }
+
+    uint32_t run_start = low + (high - low) / 2;
+    uint32_t run_end = run_start + 1;
+    while (run_start > low && the_array[run_start - 1] == the_array[run_start]){
+        run_start--;
+    }
+    while (run_end < high && the_array[run_end] == the_array[run_start]){
+        run_end++;
+    }
+
+    BinaryTree newnode = malloc(sizeof(struct binary_tree));
+    if (!newnode){
+        return NULL;
+    }
+    newnode->data = the_array[run_start];
+    newnode->count = run_end - run_start;
+    newnode->left_child = BST_from_sorted_P(the_array, low, run_start);
+    newnode->right_child = BST_from_sorted_P(the_array, run_end, high);
+
+    if ((low < run_start && !newnode->left_child) || (run_end < high && !newnode->right_child)){
+        BST_cut_down_P(newnode);
+        return NULL;
+    }
+    return newnode;
+};
+
+
 /* ---------------------------------------------------------------- */
 /* ***************************** End Private ********************** */
 
@@ -96,6 +482,11 @@ BinaryTree BST_insert(BinaryTree tree, char the_value){
     
        The insertion operation is such that the sorted order of
        the tree is maintained. 
+
+       Duplicates are allowed. A duplicate doesn't get a node of
+       its own: the count of the node already holding the_value is
+       incremented instead, so nothing is allocated and the tree
+       doesn't get any deeper.
     */
     if (!tree){
         BinaryTree newnode;
@@ -109,16 +500,19 @@ BinaryTree BST_insert(BinaryTree tree, char the_value){
         newnode->left_child = NULL;
         newnode->right_child = NULL; 
         newnode->data = the_value;
+        newnode->count = 1;
 
         tree = newnode; 
         return tree;
         }
 
     else{
-        if (the_value <= tree->data){
+        if (the_value < tree->data){
             tree->left_child = BST_insert(tree->left_child, the_value);
-        }else{
+        }else if (the_value > tree->data){
             tree->right_child= BST_insert(tree->right_child, the_value);
+        }else{
+            tree->count++;
         };
     };
     
@@ -148,6 +542,7 @@ BinaryTree BST_insert_nd(BinaryTree tree, char the_value){
         newnode->left_child = NULL;
         newnode->right_child = NULL; 
         newnode->data = the_value;
+        newnode->count = 1;
 
         tree = newnode; 
         return tree;
@@ -170,8 +565,15 @@ BinaryTree BST_insert_nd(BinaryTree tree, char the_value){
 
 
 bool BST_contains(BinaryTree tree, char the_value){
-    /* Return true if the tree contains the_value, false otherwise */
+    /* Return true if the tree contains the_value, false otherwise.
 
+       In self-adjusting mode (BST_SELF_ADJUSTING), the node is splayed
+       up to the root first, and only the root then needs checking.
+    */
+#ifdef BST_SELF_ADJUSTING
+    BST_splay_P(tree, the_value);
+    return (tree && tree->data == the_value);
+#else
     if (!tree){
         return false;
     };
@@ -183,22 +585,121 @@ bool BST_contains(BinaryTree tree, char the_value){
     }else{
         return BST_contains(tree->right_child, the_value);
     };
+#endif
 };
 
 
 
 
-uint16_t BST_count_nodes(BinaryTree tree){
-    /* Count the number of nodes in the tree recursively */
+uint64_t BST_count_nodes(BinaryTree tree){
+    /* Count the number of values in the tree recursively.
+
+       Duplicates are counted as many times as they were inserted,
+       just as if each of them had a node of its own. This is the
+       length of the array BST_to_array() needs. Each node can hold
+       up to UINT32_MAX occurrences, hence the 64-bit total.
+    */
     if (!tree){     // if tree is null
         return 0;
     }else{
-        return 1 + BST_count_nodes(tree->left_child) + BST_count_nodes(tree->right_child);
+        return tree->count + BST_count_nodes(tree->left_child) + BST_count_nodes(tree->right_child);
     };
 };
 
 
 
+void BST_contains_batch(BinaryTree tree, const char keys[], uint32_t how_many, bool results[]){
+    /* For each of the how_many values in keys, set the corresponding
+       entry in results to true if the tree contains it, false otherwise.
+
+       A single lookup is a chain of dependent loads: the next node can't
+       be fetched before the current one has arrived from memory. On a tree
+       that doesn't fit in cache that means one cache miss per level,
+       during which the CPU does nothing.
+
+       So instead of doing the lookups one after the other, BST_BATCH_WIDTH
+       of them are walked down the tree in lockstep: each one is advanced by
+       a single level, and the child it moves to is prefetched. By the time
+       the loop comes back around to that lookup, the other ones have been
+       advanced and the prefetched node has (hopefully) arrived. 
+       Whenever a lookup finishes, its slot is given the next key, so all
+       the slots are kept busy until the keys run out.
+
+       Note the limit of this with char keys: a tree never has more than
+       256 nodes (duplicates share a node), a few KB, so it never gets
+       larger than cache, and there are no cache misses to hide once the
+       tree has been walked. Only the first batch on a cold tree gains
+       from the prefetching. The batch still beats the same lookups done
+       one by one on a cached tree, by a smaller margin: with independent
+       lookups interleaved, the CPU overlaps their loads and their
+       mispredicted branches instead of waiting out each one in turn.
+
+       The tree isn't modified, not even in self-adjusting mode.
+    */
+    uint32_t slot_key[BST_BATCH_WIDTH];     // index into keys of the lookup in each slot
+    BinaryTree slot_node[BST_BATCH_WIDTH];  // the node that lookup is at
+    uint32_t next_key = 0;
+    uint8_t busy = 0;
+
+    for (uint8_t i = 0; i < BST_BATCH_WIDTH; i++){
+        if (next_key < how_many){
+            slot_key[i] = next_key++;
+            slot_node[i] = tree;
+            busy++;
+        }else{
+            slot_key[i] = UINT32_MAX;   // empty slot
+        }
+    }
+    BST_PREFETCH(tree);
+
+    while (busy){
+        for (uint8_t i = 0; i < BST_BATCH_WIDTH; i++){
+            if (slot_key[i] == UINT32_MAX){
+                continue;
+            }
+
+            BinaryTree node = slot_node[i];
+            char the_value = keys[slot_key[i]];
+
+            if (!node || node->data == the_value){    // this lookup is done
+                results[slot_key[i]] = (node != NULL);
+                if (next_key < how_many){
+                    slot_key[i] = next_key++;
+                    slot_node[i] = tree;
+                }else{
+                    slot_key[i] = UINT32_MAX;
+                    busy--;
+                }
+                continue;
+            }
+
+            node = (the_value < node->data) ? node->left_child : node->right_child;
+            BST_PREFETCH(node);
+            slot_node[i] = node;
+        }
+    }
+};
+
+
+
+uint32_t BST_count_of(BinaryTree tree, char the_value){
+    /* Return the number of times the_value occurs in the tree,
+       0 if it isn't there at all.
+    */
+    while (tree){
+        if (the_value < tree->data){
+            tree = tree->left_child;
+        }else if (the_value > tree->data){
+            tree = tree->right_child;
+        }else{
+            return tree->count;
+        }
+    }
+    return 0;
+};
+
+
+
 char BST_find_min(BinaryTree tree){
     /* Find and return the minimum value in tree.
        This function assumes the tree contains at least one node,
@@ -306,8 +807,10 @@ void BST_print(BinaryTree tree){
     if (!tree){
         return;
     }else{
-        BST_print(tree->left_child);     // smallest value or equal to the following
-        printf("%c", tree->data);   // greater than or equal to left child
+        BST_print(tree->left_child);     // smallest value
+        for (uint32_t i = 0; i < tree->count; i++){
+            printf("%c", tree->data);   // greater than the left child, printed once per occurrence
+        }
         BST_print(tree->right_child);    // > than the parent and thus the left sibling
     };
 };
@@ -324,6 +827,7 @@ bool BST_is_same(BinaryTree tree1, BinaryTree tree2){
     }
     else if (tree1 && tree2){   // neither tree is NULL
         return(tree1->data == tree2->data \
+              && tree1->count == tree2->count \
               && BST_is_same(tree1->left_child, tree2->left_child) \
               && BST_is_same(tree1->right_child, tree2->right_child));
     }
@@ -338,20 +842,47 @@ bool BST_is_same(BinaryTree tree1, BinaryTree tree2){
 
 
 BinaryTree BST_remove_node(BinaryTree tree, char the_value){
-    /* Remove the_value from the tree, and return a pointer to 
-       the tree. 
+    /* Remove one occurrence of the_value from the tree, and return
+       a pointer to the tree. 
        
        --------- NOTES -----------
 
-       - only the first occurence of the_value is removed. If there
+       - only one occurence of the_value is removed. If there
        are duplicates (like this tree implementation allows), the
-       remaining ones are left intact. 
+       count of the node is decremented and the remaining ones are 
+       left intact. The node itself is only removed along with the
+       last occurrence. To remove all of them in one go, use
+       BST_remove_all().
 
        - if the_value isn't found, nothing happens. Therefore, if
        you call this function twice with a certain value (provided
        there are no duplicates), the second call will effect no
        changes. In other words, the function is idempotent (again,
        in the absence of duplicates, that is).
+    */
+    if (!tree){
+        return tree;
+    }
+
+    if (the_value < tree->data){
+        tree->left_child = BST_remove_node(tree->left_child, the_value);
+    }else if (the_value > tree->data){
+        tree->right_child = BST_remove_node(tree->right_child, the_value);
+    }else if (tree->count > 1){
+        tree->count--;
+    }else{
+        tree = BST_remove_all(tree, the_value);
+    }
+    return tree;
+};
+
+
+
+BinaryTree BST_remove_all(BinaryTree tree, char the_value){
+    /* Remove the_value from the tree, along with all its duplicates,
+       and return a pointer to the tree. 
+
+       If the_value isn't found, nothing happens.
 
        Internally, it calls BST_get_in_order_successor_P() when
        a node with two children has to be removed, and then
@@ -366,10 +897,10 @@ BinaryTree BST_remove_node(BinaryTree tree, char the_value){
     // case B. tree is not NULL : determine which path to take -- left or right, and
     // recurse
     if (the_value < tree->data){
-        tree->left_child = BST_remove_node(tree->left_child, the_value);
+        tree->left_child = BST_remove_all(tree->left_child, the_value);
         return tree;
     }else if (the_value > tree->data){
-        tree->right_child = BST_remove_node(tree->right_child, the_value);
+        tree->right_child = BST_remove_all(tree->right_child, the_value);
         return tree;
     }   
 
@@ -382,10 +913,13 @@ BinaryTree BST_remove_node(BinaryTree tree, char the_value){
             return NULL;
         }
 
-        // case C2. two children -> find the in-order successor
+        // case C2. two children -> find the in-order successor, take over its
+        // value and count, then remove it (with all its occurrences) from the right subtree
         else if (tree->left_child && tree->right_child){
-            tree->data = BST_get_in_order_successor_P(tree->right_child);
-            tree->right_child = BST_remove_node(tree->right_child, tree->data);
+            BinaryTree successor = BST_get_in_order_successor_P(tree->right_child);
+            tree->data = successor->data;
+            tree->count = successor->count;
+            tree->right_child = BST_remove_all(tree->right_child, tree->data);
         }
         
         // case C3. one child --> replace the node with its only child
@@ -454,14 +988,33 @@ BinaryTree BST_from_array(char the_array[], unsigned int array_length){
 
 
 
+BinaryTree BST_from_sorted_array(const char the_array[], uint32_t array_length){
+/* Build a balanced BinaryTree out of the elements stored in the_array,
+   which must be sorted in ascending order.
+
+   Unlike BST_from_array(), which inserts the values one by one (and
+   ends up with a tree as deep as the array is long when the values
+   come in sorted), this takes O(n) and the tree it returns has 
+   logarithmic depth.
+
+   Returns NULL if the_array is empty or if an allocation fails.
+*/
+    return BST_from_sorted_P(the_array, 0, array_length);
+}
+
+
+
 uint32_t BST_to_array(BinaryTree the_tree, char the_array[], uint32_t index){
 /* Traverses the_tree 'in-order' and stores the value of each node
-   in the_array.
+   in the_array. A value with duplicates is stored as many times as
+   it occurs in the tree.
 
    The_array has to be long enough to accomodate all the values in the tree.
    Specifically, the length of the array has to be >= the value returned
    by BST_count_nodes().
 
+   Returns the index following the last value written.
+
                             * * *
    Parameters
     - the_tree : the tree to traverse
@@ -470,27 +1023,199 @@ uint32_t BST_to_array(BinaryTree the_tree, char the_array[], uint32_t index){
       writing. This is normally always 0.
 */
     if (!the_tree){
-                return 0;
-            }
-            
-            uint32_t temp = 0;
-            
-            temp = BST_to_array(the_tree->left_child, the_array, index);
-            if (temp){
-                index = temp;
-            }
+        return index;
+    }
 
-            the_array[index] = the_tree->data;
-            index++; 
+    index = BST_to_array(the_tree->left_child, the_array, index);
 
-            temp = index;
-            index = BST_to_array(the_tree->right_child, the_array, index);
-            if (temp){
-                index = temp;
-            }
-            
-            return index;
+    for (uint32_t i = 0; i < the_tree->count; i++){
+        the_array[index] = the_tree->data;
+        index++; 
+    }
 
+    return BST_to_array(the_tree->right_child, the_array, index);
+}
+
+
+
+bool BST_save(BinaryTree tree, int fd){
+    /* Write tree to fd in the format described in binary_search_tree.h.
+
+       The records are collected into a fixed-size buffer and written out
+       in blocks, so there's one write() call per BST_IO_BUFFER_SIZE bytes
+       rather than one per node.
+    */
+    uint32_t count = BST_count_P(tree);
+    unsigned char header[BST_FILE_HEADER_SIZE] = {'B', 'S', 'T', '1',
+        count & 0xFF, (count >> 8) & 0xFF, (count >> 16) & 0xFF, (count >> 24) & 0xFF};
+
+    if (!BST_write_all_P(fd, (const char *)header, BST_FILE_HEADER_SIZE)){
+        return false;
+    }
+
+    struct bst_stream *stream = malloc(sizeof(struct bst_stream));
+    if (!stream){
+        return false;
+    }
+    stream->fd = fd;
+    stream->failed = false;
+    stream->position = 0;
+
+    BST_save_P(tree, stream);
+    BST_stream_flush_P(stream);
+
+    bool success = !stream->failed;
+    free(stream);
+    return success;
+}
+
+
+
+bool BST_load(BinaryTree *tree_ref, int fd){
+    /* Read a tree saved with BST_save() from fd and store it in *tree_ref.
+
+       The tree is rebuilt balanced, in O(n), regardless of the shape
+       of the tree that was saved.
+       On failure, *tree_ref is set to NULL and false is returned.
+    */
+    *tree_ref = NULL;
+
+    unsigned char header[BST_FILE_HEADER_SIZE];
+    uint32_t count;
+    ssize_t got = 0;
+    while (got < BST_FILE_HEADER_SIZE){
+        ssize_t n = BST_read_P(fd, header + got, BST_FILE_HEADER_SIZE - got);
+        if (n <= 0){
+            return false;
+        }
+        got += n;
+    }
+    if (!BST_read_header_P(header, &count)){
+        return false;
+    }
+
+    struct bst_stream *stream = malloc(sizeof(struct bst_stream));
+    if (!stream){
+        return false;
+    }
+    stream->fd = fd;
+    stream->failed = false;
+    stream->position = stream->length = 0;
+    stream->has_previous = false;
+
+    *tree_ref = BST_load_P(stream, count);
+
+    // the file has to end right after the last record
+    char extra;
+    bool success = !stream->failed && stream->position == stream->length 
+                   && BST_read_P(fd, &extra, 1) == 0;
+    if (!success){
+        BST_cut_down_P(*tree_ref);
+        *tree_ref = NULL;
+    }
+    free(stream);
+    return success;
+}
+
+
+
+bool BST_map(BinaryTreeView *view_ref, int fd){
+    /* Map a file written by BST_save() read-only into memory, without
+       deserializing it. 
+
+       The view can only be queried (see BST_view_contains()), and must
+       be released with BST_unmap(). The records are checked the same
+       way BST_load() checks them, once, when the file is mapped.
+       On failure, *view_ref is set to NULL and false is returned.
+    */
+    *view_ref = NULL;
+
+    struct stat info;
+    if (fstat(fd, &info) || info.st_size < BST_FILE_HEADER_SIZE){
+        return false;
+    }
+
+    size_t map_length = info.st_size;
+    void *map = mmap(NULL, map_length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED){
+        return false;
+    }
+
+    // the records have to fill the rest of the file exactly, and be valid (see BST_check_record_P())
+    uint32_t count;
+    bool valid = BST_read_header_P(map, &count) 
+                 && map_length - BST_FILE_HEADER_SIZE == (size_t)count * BST_FILE_RECORD_SIZE;
+    const unsigned char *records = (const unsigned char *)map + BST_FILE_HEADER_SIZE;
+    for (uint32_t i = 0; valid && i < count; i++){
+        const unsigned char *record = records + (size_t)i * BST_FILE_RECORD_SIZE;
+        valid = BST_check_record_P(record, i > 0, i ? (char)record[-BST_FILE_RECORD_SIZE] : 0);
+    }
+
+    BinaryTreeView newview = NULL;
+    if (!valid || !(newview = malloc(sizeof(struct binary_tree_view)))){
+        munmap(map, map_length);
+        return false;
+    }
+
+    newview->records = (const unsigned char *)map + BST_FILE_HEADER_SIZE;
+    newview->count = count;
+    newview->map = map;
+    newview->map_length = map_length;
+
+    *view_ref = newview;
+    return true;
+}
+
+
+
+uint32_t BST_view_count_of(BinaryTreeView view, char the_value){
+    /* Return the number of times the_value occurs in the mapped tree,
+       0 if it isn't there at all.
+       The records are sorted by key, so this is a binary search.
+    */
+    uint32_t low = 0;
+    uint32_t high = view->count;   // exclusive
+
+    while (low < high){
+        uint32_t middle = low + (high - low) / 2;
+        const unsigned char *record = view->records + (size_t)middle * BST_FILE_RECORD_SIZE;
+        char key = (char)record[0];
+
+        if (key == the_value){
+            return BST_decode_count_P(record + 1);
+        }else if (key < the_value){
+            low = middle + 1;
+        }else{
+            high = middle;
+        }
+    }
+    return 0;
+}
+
+
+
+bool BST_view_contains(BinaryTreeView view, char the_value){
+    /* Return true if the_value is in the mapped tree, false otherwise */
+    return BST_view_count_of(view, the_value) > 0;
+}
+
+
+
+uint32_t BST_view_count(BinaryTreeView view){
+    /* Return the number of distinct keys in the mapped tree */
+    return view->count;
+}
+
+
+
+void BST_unmap(BinaryTreeView *view_ref){
+    /* Unmap the file mapped by BST_map() and set *view_ref to NULL */
+    if (!(*view_ref)){
+        return;
+    }
+    munmap((*view_ref)->map, (*view_ref)->map_length);
+    free(*view_ref);
+    *view_ref = NULL;
 }
 
 
@@ -502,8 +1227,3 @@ BinaryTree *BST_copy_tree(BinaryTree *tree);
 char BST_find_nth_max(BinaryTree *tree);
 char BST_find_nth_min(BinaryTree *tree);
 */
-
-
-
-
-
@@ -5,11 +5,22 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+
+/* Self-adjusting mode.
+ *
+ * When BST_SELF_ADJUSTING is defined at compile time (e.g. -DBST_SELF_ADJUSTING),
+ * BST_contains() splays the node it finds up to the root of the tree, so that
+ * frequently looked-up keys stay near the top and are reached in a few steps.
+ * The rotations are done in place: the root node keeps its address, so the
+ * interface below is the same in both modes.
+ */
+
 typedef struct binary_tree *BinaryTree; 
 
 // structure of a binary tree node
 struct binary_tree{
     char data;
+    uint32_t count;     // number of occurrences of data (duplicates share a node)
     BinaryTree left_child;
     BinaryTree right_child;
 };
@@ -20,20 +31,56 @@ void BST_init(BinaryTree *tree_ref);
 BinaryTree BST_insert(BinaryTree tree, char the_value);
 BinaryTree BST_insert_nd(BinaryTree tree, char the_value);
 bool BST_contains(BinaryTree tree, char the_value);
+void BST_contains_batch(BinaryTree tree, const char keys[], uint32_t how_many, bool results[]);
 void BST_invert(BinaryTree tree); 
-uint16_t BST_count_nodes(BinaryTree tree);
+uint64_t BST_count_nodes(BinaryTree tree);   // every occurrence of every key
 uint16_t BST_max_depth(BinaryTree tree);
 char BST_find_min(BinaryTree tree);
 char BST_find_max(BinaryTree tree);
 void BST_print(BinaryTree tree);
 bool BST_is_same(BinaryTree tree1, BinaryTree tree2);
-BinaryTree BST_remove_node(BinaryTree tree, char the_value);
+uint32_t BST_count_of(BinaryTree tree, char the_value);
+BinaryTree BST_remove_node(BinaryTree tree, char the_value);  // remove one occurrence
+BinaryTree BST_remove_all(BinaryTree tree, char the_value);   // remove every occurrence
 unsigned int BST_to_array(BinaryTree the_tree, char the_array[], unsigned int index);
 BinaryTree BST_from_array(char the_array[], unsigned int array_length);
+BinaryTree BST_from_sorted_array(const char the_array[], uint32_t array_length);
 void BST_destroy(BinaryTree *tree_ref);
 
 
 
+/* Persistence.
+ *
+ * BST_save() writes the tree to the file descriptor fd in a compact format:
+ * an 8-byte header (the magic bytes "BST1" followed by the number of nodes as
+ * a little-endian uint32_t), then one 5-byte record per node, in ascending
+ * order of key: the key itself, then its occurrence count as a little-endian
+ * uint32_t.
+ *
+ * BST_load() reads that format back and builds a balanced tree from it in
+ * O(n), streaming the file through a fixed-size buffer, so the memory used
+ * on top of the tree itself doesn't depend on the size of the file.
+ *
+ * Since the records are stored sorted, a saved file can also be used directly,
+ * without building a tree at all: BST_map() maps it read-only into memory,
+ * and BST_view_contains()/BST_view_count_of() do a binary search over the
+ * mapped records.
+ *
+ * All of these return false if an I/O, mapping or allocation error occurs,
+ * or if the file isn't in the format above.
+ */
+typedef struct binary_tree_view *BinaryTreeView;
+
+bool BST_save(BinaryTree tree, int fd);
+bool BST_load(BinaryTree *tree_ref, int fd);
+bool BST_map(BinaryTreeView *view_ref, int fd);
+bool BST_view_contains(BinaryTreeView view, char the_value);
+uint32_t BST_view_count_of(BinaryTreeView view, char the_value);
+uint32_t BST_view_count(BinaryTreeView view);
+void BST_unmap(BinaryTreeView *view_ref);
+
+
+
 
 #endif
 
@@ -0,0 +1,261 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bloom_filter.h"
+#include "hash_mix.h"
+
+/* ********************************************************** */
+/*                  Implementation Notes
+
+    -------------------- Sizing --------------------------------
+    For n items and a false positive rate p, a (classic) Bloom
+    filter needs m = -n ln(p) / (ln 2)^2 bits and k = (m/n) ln 2
+    bits per item.
+
+    A blocked filter of that size misses p, though: the items
+    don't spread evenly over the blocks. The number of items in
+    a block is Poisson distributed, with mean n/blocks, and the
+    blocks that get more than their share have a much higher
+    rate than the others gain by getting less. So m is only the
+    starting point: the expected rate of the blocked filter is
+    worked out from that distribution (Bloom_blocked_rate_P()),
+    and blocks are added, a factor of BLOOM_GROWTH at a time, until the best
+    k (between 1 and BLOOM_MAX_BITS) for that many blocks brings
+    it down to p. That takes 5 to 20% more bits, more for lower p.
+
+    -------------------- Blocks --------------------------------
+    Each block is 512 bits, i.e. 8 uint64_t words, and the blocks
+    are allocated aligned to 64 bytes, so that a block is exactly
+    one cache line.
+
+    The hash of an item is first mixed twice, with two different
+    seeds, giving two independent 64-bit values: the top bits of
+    the first one pick the block (multiply-shift, so the number of
+    blocks needn't be a power of two), and the second one is cut
+    into 9-bit pieces, each of which is the number of a bit within
+    the block; when its 7 pieces are used up, it's mixed again for
+    7 more. Deriving the bits as h1 + i*h2 (mod 512) from two
+    halves of it ('double hashing') would take fewer mixes, but in
+    a block of only 512 bits, the bits of different items then
+    line up in arithmetic progressions often enough to raise the
+    false positive rate several times over what the sizing
+    above expects, the more so the lower the rate.
+
+    -------------------- Estimated rate ------------------------
+    A lookup for an item that was never added is a false positive
+    if all of its k bits happen to be set in its block. If a
+    fraction f of the bits of a block are set, that's f^k; the
+    estimated rate is the average of f^k over all the blocks.
+*/
+
+
+#define BLOOM_BLOCK_BITS 512
+#define BLOOM_BLOCK_WORDS 8     // 512 / 64
+#define BLOOM_BLOCK_BYTES 64    // one cache line
+#define BLOOM_MAX_BITS 16       // bits set per item
+#define BLOOM_BITS_PER_MIX 7    // 9-bit bit numbers in a 64-bit mixed hash
+#define BLOOM_LN2 0.69314718055994530942
+#define BLOOM_GROWTH 1.02       // factor by which the blocks are grown while sizing
+
+
+struct bloom_filter{
+    uint64_t *words;        // blocks * BLOOM_BLOCK_WORDS words, aligned to BLOOM_BLOCK_BYTES
+    uint64_t blocks;        // number of blocks
+    uint8_t bits_per_item;  // k
+};
+
+
+
+
+/* ***************************** Private ****************************** */
+/* -------------------------------------------------------------------- */
+
+static inline uint32_t Bloom_popcount_P(uint64_t word){
+    /* Return the number of bits set in word */
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    uint32_t count = 0;
+    while (word){
+        word &= word - 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+
+static uint64_t *Bloom_block_P(Bloom filter, uint64_t hash, uint64_t mask[]){
+    /* Return the block the item with this hash goes in, and fill
+       mask (BLOOM_BLOCK_WORDS words) with the bits it sets in it.
+    */
+    uint64_t first = Hash_mix(hash);
+    uint64_t second = Hash_mix(hash ^ 0x9e3779b97f4a7c15ULL);
+
+    uint64_t block = ((first >> 32) * filter->blocks) >> 32;     // in [0, blocks), for up to 2^32 blocks
+
+    memset(mask, 0, BLOOM_BLOCK_WORDS * sizeof(uint64_t));
+    for (uint8_t i = 0; i < filter->bits_per_item; i++){
+        if (i && i % BLOOM_BITS_PER_MIX == 0){
+            second = Hash_mix(second);
+        }
+        uint32_t bit = (uint32_t)(second >> (9 * (i % BLOOM_BITS_PER_MIX))) % BLOOM_BLOCK_BITS;
+        mask[bit >> 6] |= (uint64_t)1 << (bit & 63);
+    }
+    return &filter->words[block * BLOOM_BLOCK_WORDS];
+}
+
+
+static double Bloom_blocked_rate_P(double items_per_block, uint8_t k){
+    /* Return the expected false positive rate of a blocked filter
+       with k bits per item and items_per_block items per block on
+       average. A block with j items has about a fraction
+       1 - (1 - k/512)^j of its bits set (each item sets k bits,
+       which only rarely coincide), and a
+       false positive rate of that to the k; the result is the mean
+       of that rate over j, weighted by the Poisson probability of a
+       block holding j items. Terms more than 10 standard deviations
+       from the mean are too small to matter, and are left out.
+    */
+    double spread = 10 * sqrt(items_per_block) + 10;
+    double first = floor(items_per_block - spread);
+    double last = ceil(items_per_block + spread);
+    double rate = 0.0;
+    for (double j = (first > 0) ? first : 0; j <= last; j++){
+        double probability = exp(j * log(items_per_block) - items_per_block - lgamma(j + 1));
+        double fill = 1.0 - pow(1.0 - (double)k / BLOOM_BLOCK_BITS, j);
+        rate += probability * pow(fill, k);
+    }
+    return rate;
+}
+
+/* ---------------------------------------------------------------- */
+/* ***************************** End Private ********************** */
+
+
+
+void Bloom_init(Bloom *filter, uint64_t expected_items, double false_positive_rate){
+    /* Allocate and initialize an empty Bloom filter sized to hold
+       expected_items items with the given false positive rate
+       (e.g. 0.01 for 1%). Adding more items than that raises the rate.
+    */
+    if (!expected_items){
+        expected_items = 1;
+    }
+    if (!(false_positive_rate > 0.0 && false_positive_rate < 1.0)){
+        false_positive_rate = 0.01;
+    }
+
+    Bloom newfilter = malloc(sizeof(struct bloom_filter));
+    if (!newfilter){
+        exit(EXIT_FAILURE);
+    }
+
+    // start from the size of a classic filter, then grow it until the blocked one meets the rate
+    double bits = -(double)expected_items * log(false_positive_rate) / (BLOOM_LN2 * BLOOM_LN2);
+    double blocks = ceil(bits / BLOOM_BLOCK_BITS);
+    blocks = (blocks < 1) ? 1 : blocks;
+    uint8_t best_k;
+    while (1){
+        double best_rate = 2.0;
+        best_k = 1;
+        for (uint8_t k = 1; k <= BLOOM_MAX_BITS; k++){
+            double rate = Bloom_blocked_rate_P(expected_items / blocks, k);
+            if (rate < best_rate){
+                best_rate = rate;
+                best_k = k;
+            }
+        }
+        if (best_rate <= false_positive_rate){
+            break;
+        }
+        blocks = ceil(blocks * BLOOM_GROWTH);
+    }
+    newfilter->blocks = (uint64_t)blocks;
+    newfilter->bits_per_item = best_k;
+
+    newfilter->words = aligned_alloc(BLOOM_BLOCK_BYTES, newfilter->blocks * BLOOM_BLOCK_BYTES);
+    if (!newfilter->words){
+        exit(EXIT_FAILURE);
+    }
+    Bloom_clear(newfilter);
+
+    *filter = newfilter;
+}
+
+
+void Bloom_add(Bloom filter, uint64_t hash){
+    /* Add the item with this hash to the filter */
+    uint64_t mask[BLOOM_BLOCK_WORDS];
+    uint64_t *block = Bloom_block_P(filter, hash, mask);
+    for (uint8_t i = 0; i < BLOOM_BLOCK_WORDS; i++){
+        block[i] |= mask[i];
+    }
+}
+
+
+bool Bloom_might_contain(Bloom filter, uint64_t hash){
+    /* Return false if the item with this hash was definitely never
+       added, true if it probably was.
+    */
+    uint64_t mask[BLOOM_BLOCK_WORDS];
+    const uint64_t *block = Bloom_block_P(filter, hash, mask);
+    uint64_t missing = 0;
+    for (uint8_t i = 0; i < BLOOM_BLOCK_WORDS; i++){
+        missing |= mask[i] & ~block[i];
+    }
+    return !missing;
+}
+
+
+void Bloom_clear(Bloom filter){
+    /* Remove all the items from the filter */
+    memset(filter->words, 0, filter->blocks * BLOOM_BLOCK_BYTES);
+}
+
+
+uint64_t Bloom_size_in_bytes(Bloom filter){
+    /* Return the size of the bit array */
+    return filter->blocks * BLOOM_BLOCK_BYTES;
+}
+
+
+double Bloom_fill_ratio(Bloom filter){
+    /* Return the fraction of the bits in the filter that are set */
+    uint64_t set = 0;
+    for (uint64_t i = 0; i < filter->blocks * BLOOM_BLOCK_WORDS; i++){
+        set += Bloom_popcount_P(filter->words[i]);
+    }
+    return (double)set / (filter->blocks * BLOOM_BLOCK_BITS);
+}
+
+
+double Bloom_false_positive_rate(Bloom filter){
+    /* Return the estimated probability that Bloom_might_contain()
+       returns true for an item that was never added, given the bits
+       currently set in the filter (see the implementation notes).
+    */
+    double total = 0.0;
+    for (uint64_t b = 0; b < filter->blocks; b++){
+        uint32_t set = 0;
+        for (uint8_t i = 0; i < BLOOM_BLOCK_WORDS; i++){
+            set += Bloom_popcount_P(filter->words[b * BLOOM_BLOCK_WORDS + i]);
+        }
+        total += pow((double)set / BLOOM_BLOCK_BITS, filter->bits_per_item);
+    }
+    return total / filter->blocks;
+}
+
+
+void Bloom_destroy(Bloom *filter){
+    /* Deallocate all associated heap memory and set
+       *filter to NULL
+    */
+    if (!(*filter)){
+        return;
+    }
+    free((*filter)->words);
+    free(*filter);
+    *filter = NULL;
+}
@@ -0,0 +1,55 @@
+#ifndef BLOOMFILTER_H
+#define BLOOMFILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/* ***************************************************************** */
+/*                          * * *                                    */
+/*                     Blocked Bloom Filter
+ *
+ *  A Bloom filter is a probabilistic set: it can say for sure that
+ *  an item is NOT in a set, but only that it MIGHT be in it. In
+ *  exchange it takes up only a handful of bits per item, whatever
+ *  the size of the items, so it fits in cache where the set itself
+ *  wouldn't. Put in front of a large set, it answers most lookups
+ *  for missing items without touching the set at all.
+ *
+ *  Items are added and looked up by their 64-bit hash; any of the
+ *  hash callbacks in hash_set.h will do (e.g. HSet_hash_u64).
+ *  Items can't be removed: after a deletion from the set behind
+ *  it, the filter still says the item might be there, which is
+ *  harmless (the set is asked, and says no) but raises the false
+ *  positive rate until the filter is cleared and refilled.
+ *
+ *  The filter is 'blocked': it's split into 64-byte blocks, one
+ *  cache line each, and all the bits of an item are in the same
+ *  block. An add or a lookup thus touches a single cache line,
+ *  instead of one line per bit. The price is a larger filter for
+ *  the same false positive rate: items don't spread evenly over
+ *  the blocks, and Bloom_init() adds the bits that make up for it.
+ *
+ *  Bloom_false_positive_rate() estimates the actual rate from the
+ *  bits set in the filter, rather than from the expected number
+ *  of items it was created for.
+ *
+ *  Link with -lm.
+ *
+ * *************************************************************** */
+
+typedef struct bloom_filter *Bloom;
+
+
+void Bloom_init(Bloom *filter, uint64_t expected_items, double false_positive_rate);
+void Bloom_add(Bloom filter, uint64_t hash);
+bool Bloom_might_contain(Bloom filter, uint64_t hash);   // false: definitely not added; true: probably added
+void Bloom_clear(Bloom filter);     // remove everything
+uint64_t Bloom_size_in_bytes(Bloom filter);
+double Bloom_fill_ratio(Bloom filter);     // fraction of the bits that are set
+double Bloom_false_positive_rate(Bloom filter);
+void Bloom_destroy(Bloom *filter);   // destroy a Bloom filter and free all memory associated with it
+
+
+
+#endif
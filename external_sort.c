@@ -0,0 +1,566 @@
+#define _POSIX_C_SOURCE 200809L     // fseeko() and off_t
+#define _FILE_OFFSET_BITS 64        // a 64-bit off_t even where long is 32 bits, so files can exceed 2GB
+
+#include "external_sort.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+
+/* ************************* Implementation notes ************************** */
+/*
+   Run formation uses two buffers of half the budget each. While a
+   worker thread writes the sorted buffer out as a run, the main thread
+   reads and sorts the next one into the other buffer; it then waits
+   for the worker before handing it that buffer, so at most one write
+   is ever in flight.
+
+   All the runs of a pass are kept one after the other in a single
+   temporary file, with a table of their lengths, rather than a file
+   each: a small budget can make for a lot of runs, more than the files
+   a process may have open. Each run being merged seeks to its own
+   position in the file when it refills its buffer. Positions are off_t,
+   with fseeko(), rather than the long of fseek(), which is 32 bits on
+   some systems and would stop runs files at 2GB.
+
+   Merging splits the budget into equal buffers: two per run being
+   merged, and two for the output. The output buffers take turns the
+   same way as the run buffers above: one is written by a worker while
+   the other fills. So do the two buffers of each run: while the merge
+   takes records from one, a reader thread fills the other with the
+   run's next records, so that when the merge gets to the end of the
+   first, it usually finds the second already read and only has to swap
+   them. The reader fills buffers in the order the merge used them up,
+   from a queue of runs; a run is in the queue at most once at a time,
+   since its buffer isn't handed back until it's been read.
+   Each buffer should hold at least EXTSORT_MIN_BUFFER bytes, or reads
+   and writes get too small to be efficient, which bounds the number of
+   runs merged at once (the fan-in). When there are more runs than that,
+   groups of fan-in runs are merged into longer runs first, which are
+   merged in turn, until one pass can take them all.
+
+   The loser tree over k runs is an array of k entries. Entries 1 to
+   k-1 are the internal nodes of a binary tree whose leaves are the runs
+   (leaf i sits at position k+i, which isn't stored), and each holds the
+   index of the run that LOST the match played at that node, i.e. the
+   one whose current record is the larger of the two winners below.
+   Entry 0 holds the overall winner: the run with the smallest current
+   record. Once that record is output and the run moves on to its next
+   one, only the matches on the path from its leaf to the root need
+   replaying, each against the loser stored there: log2(k) comparisons,
+   half of what a binary heap needs for a sift-down. An exhausted run
+   loses every match.
+*/
+
+#define EXTSORT_MIN_BUFFER (64u << 10)      // 64KB
+#define EXTSORT_MAX_FANIN 1024
+#define EXTSORT_RUN_BUFFERS 2               // per run being merged: one merged from, one read ahead
+
+
+// a write done by a worker thread
+struct extsort_write{
+    pthread_t thread;
+    bool running;
+    FILE *file;
+    const char *data;
+    size_t length;
+    bool ok;
+};
+
+// a run being merged, read through two buffers
+struct extsort_run{
+    FILE *file;         // the file holding all the runs
+    off_t position;     // where in it the records not yet read start
+    uint64_t remaining; // how many of those there are
+    char *buffer;       // the records being merged
+    size_t capacity;    // of each buffer, in records
+    size_t count;       // records in buffer
+    size_t next;        // index in buffer of the current record
+    bool done;          // no records left
+    char *ahead;        // the records after those in buffer, once read
+    size_t ahead_count; // records in ahead
+    bool ahead_ready;   // ahead has been read (guarded by the reader's lock)
+};
+
+// the thread that reads runs ahead of the merge
+struct extsort_reader{
+    pthread_t thread;
+    bool running;       // false if the thread couldn't be created: runs are then read as needed
+    pthread_mutex_t lock;
+    pthread_cond_t wake;        // for the reader: a run was queued, or it should stop
+    pthread_cond_t filled;      // for the merge: an ahead buffer has been read
+    uint32_t *queue;    // runs whose ahead buffer is to be read, a ring of count entries
+    uint32_t head;
+    uint32_t pending;   // runs in the queue
+    bool stop;
+    bool ok;            // false once a read has failed
+};
+
+struct extsort_merge{
+    struct extsort_run *runs;
+    uint32_t *tree;
+    uint32_t count;
+    size_t record_size;
+    ExtSortCompare compare;
+    struct extsort_reader reader;
+};
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static double ExtSort_seconds(void){
+    /* Wall-clock time, in seconds */
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+
+static void *ExtSort_write_worker(void *arg){
+    struct extsort_write *write = arg;
+    write->ok = fwrite(write->data, 1, write->length, write->file) == write->length;
+    return NULL;
+}
+
+
+static bool ExtSort_write_finish(struct extsort_write *write){
+    /* Wait for the write in flight, if any; return false if it failed */
+    if (!write->running){
+        return true;
+    }
+    pthread_join(write->thread, NULL);
+    write->running = false;
+    return write->ok;
+}
+
+
+static bool ExtSort_write_start(struct extsort_write *write, FILE *file, const char *data, size_t length){
+    /* Wait for the write in flight, then start writing length bytes of
+       data to file in a worker thread. Writes too small to be worth a
+       thread, or for which one can't be created, are done right away.
+       Returns false if the previous write failed, or this one did.
+    */
+    if (!ExtSort_write_finish(write)){
+        return false;
+    }
+    write->file = file;
+    write->data = data;
+    write->length = length;
+    if (length >= EXTSORT_MIN_BUFFER && pthread_create(&write->thread, NULL, ExtSort_write_worker, write) == 0){
+        write->running = true;
+        return true;
+    }
+    ExtSort_write_worker(write);
+    return write->ok;
+}
+
+
+static size_t ExtSort_read_records(FILE *in, char *buffer, size_t capacity, size_t record_size, bool *ok){
+    /* Read up to capacity records into buffer, and return how many were
+       read. Sets *ok to false on a read error, or a partial record.
+    */
+    size_t bytes = fread(buffer, 1, capacity * record_size, in);
+    if (ferror(in) || bytes % record_size){
+        *ok = false;
+    }
+    return bytes / record_size;
+}
+
+
+static void ExtSort_run_read(struct extsort_run *run, size_t record_size, bool *ok){
+    /* Read a run's next records, from its part of the file, into its
+       ahead buffer (none once the run is all read)
+    */
+    size_t wanted = (run->remaining < run->capacity) ? (size_t)run->remaining : run->capacity;
+    run->ahead_count = 0;
+    if (wanted){
+        if (fseeko(run->file, run->position, SEEK_SET)){
+            *ok = false;
+        }
+        else{
+            run->ahead_count = ExtSort_read_records(run->file, run->ahead, wanted, record_size, ok);
+        }
+        if (run->ahead_count != wanted){
+            *ok = false;
+        }
+    }
+    run->position += (off_t)(run->ahead_count * record_size);
+    run->remaining -= run->ahead_count;
+}
+
+
+static void ExtSort_run_swap(struct extsort_run *run){
+    /* Move on to the records read ahead, marking the run done if there are none */
+    char *temp = run->buffer;
+    run->buffer = run->ahead;
+    run->ahead = temp;
+    run->count = run->ahead_count;
+    run->next = 0;
+    run->done = (run->count == 0);
+}
+
+
+static void *ExtSort_read_worker(void *arg){
+    /* Read ahead the runs queued, in order, until told to stop */
+    struct extsort_merge *merge = arg;
+    struct extsort_reader *reader = &merge->reader;
+
+    pthread_mutex_lock(&reader->lock);
+    while (1){
+        while (!reader->pending && !reader->stop){
+            pthread_cond_wait(&reader->wake, &reader->lock);
+        }
+        if (!reader->pending){
+            break;
+        }
+        struct extsort_run *run = &merge->runs[reader->queue[reader->head]];
+        reader->head = (reader->head + 1) % merge->count;
+        reader->pending--;
+
+        // nobody else touches a queued run, nor the file while the reader runs
+        pthread_mutex_unlock(&reader->lock);
+        bool ok = true;
+        ExtSort_run_read(run, merge->record_size, &ok);
+        pthread_mutex_lock(&reader->lock);
+
+        reader->ok = reader->ok && ok;
+        run->ahead_ready = true;
+        pthread_cond_broadcast(&reader->filled);
+    }
+    pthread_mutex_unlock(&reader->lock);
+    return NULL;
+}
+
+
+static void ExtSort_read_ahead(struct extsort_merge *merge, uint32_t index){
+    /* Queue the run at index for its ahead buffer to be read.
+       The caller holds the reader's lock.
+    */
+    struct extsort_reader *reader = &merge->reader;
+    reader->queue[(reader->head + reader->pending) % merge->count] = index;
+    reader->pending++;
+    pthread_cond_signal(&reader->wake);
+}
+
+
+static void ExtSort_run_next(struct extsort_merge *merge, uint32_t index, bool *ok){
+    /* The run at index has been merged to the end of its buffer: move on
+       to its next records, waiting for them to be read if need be, and
+       have the reader read the ones after them into the buffer just used.
+       Without a reader, the next records are read right away.
+    */
+    struct extsort_run *run = &merge->runs[index];
+    struct extsort_reader *reader = &merge->reader;
+    if (!reader->running){
+        ExtSort_run_read(run, merge->record_size, ok);
+        ExtSort_run_swap(run);
+        return;
+    }
+
+    pthread_mutex_lock(&reader->lock);
+    while (!run->ahead_ready){
+        pthread_cond_wait(&reader->filled, &reader->lock);
+    }
+    run->ahead_ready = false;
+    ExtSort_run_swap(run);
+    if (!run->done){
+        ExtSort_read_ahead(merge, index);
+    }
+    if (!reader->ok){
+        *ok = false;
+    }
+    pthread_mutex_unlock(&reader->lock);
+}
+
+
+static void ExtSort_reader_start(struct extsort_merge *merge){
+    /* Start the reader thread, and queue every run that has records
+       left to read. If the thread can't be created, the reader is left
+       not running, and runs are read as the merge needs them.
+    */
+    struct extsort_reader *reader = &merge->reader;
+    *reader = (struct extsort_reader){.running = false, .ok = true};
+    reader->queue = malloc(sizeof(uint32_t) * merge->count);
+    if (!reader->queue){
+        exit(EXIT_FAILURE);
+    }
+    if (pthread_mutex_init(&reader->lock, NULL) || pthread_cond_init(&reader->wake, NULL) ||
+        pthread_cond_init(&reader->filled, NULL)){
+        exit(EXIT_FAILURE);
+    }
+
+    pthread_mutex_lock(&reader->lock);
+    if (pthread_create(&reader->thread, NULL, ExtSort_read_worker, merge)){
+        pthread_mutex_unlock(&reader->lock);
+        return;
+    }
+    reader->running = true;
+    for (uint32_t i = 0; i < merge->count; i++){
+        if (!merge->runs[i].done){
+            ExtSort_read_ahead(merge, i);
+        }
+    }
+    pthread_mutex_unlock(&reader->lock);
+}
+
+
+static void ExtSort_reader_stop(struct extsort_merge *merge){
+    /* Stop the reader thread, once it has read what was queued, and
+       free its resources
+    */
+    struct extsort_reader *reader = &merge->reader;
+    if (reader->running){
+        pthread_mutex_lock(&reader->lock);
+        reader->stop = true;
+        pthread_cond_signal(&reader->wake);
+        pthread_mutex_unlock(&reader->lock);
+        pthread_join(reader->thread, NULL);
+        reader->running = false;
+    }
+    pthread_mutex_destroy(&reader->lock);
+    pthread_cond_destroy(&reader->wake);
+    pthread_cond_destroy(&reader->filled);
+    free(reader->queue);
+}
+
+
+static bool ExtSort_before(struct extsort_merge *merge, uint32_t run1, uint32_t run2){
+    /* True if the current record of run1 comes before that of run2.
+       Exhausted runs come after everything; ties go to the lower index.
+    */
+    struct extsort_run *a = &merge->runs[run1], *b = &merge->runs[run2];
+    if (a->done || b->done){
+        return !a->done;
+    }
+    int order = merge->compare(a->buffer + a->next * merge->record_size, b->buffer + b->next * merge->record_size);
+    return order < 0 || (order == 0 && run1 < run2);
+}
+
+
+static uint32_t ExtSort_build_tree(struct extsort_merge *merge, uint32_t node){
+    /* Play the matches in the subtree under node, storing the losers
+       in the tree, and return the winner (see the notes at the top).
+    */
+    if (node >= merge->count){
+        return node - merge->count;     // a leaf: run node - count
+    }
+    uint32_t left = ExtSort_build_tree(merge, 2 * node);
+    uint32_t right = ExtSort_build_tree(merge, 2 * node + 1);
+    if (ExtSort_before(merge, right, left)){
+        merge->tree[node] = left;
+        return right;
+    }
+    merge->tree[node] = right;
+    return left;
+}
+
+
+static void ExtSort_replay(struct extsort_merge *merge, uint32_t winner){
+    /* The run that won has moved on: replay its matches up to the root */
+    for (uint32_t node = (winner + merge->count) / 2; node >= 1; node /= 2){
+        if (ExtSort_before(merge, merge->tree[node], winner)){
+            uint32_t loser = winner;
+            winner = merge->tree[node];
+            merge->tree[node] = loser;
+        }
+    }
+    merge->tree[0] = winner;
+}
+
+
+static bool ExtSort_merge_runs(FILE *file, off_t start, const uint64_t lengths[], uint32_t count, FILE *out,
+                               size_t record_size, ExtSortCompare compare, size_t buffer_records){
+    /* Merge count sorted runs, stored one after the other in file from
+       byte start on, lengths[i] records each, into out. Each run gets
+       EXTSORT_RUN_BUFFERS buffers of buffer_records records, and the
+       output two. Returns false on an I/O error.
+    */
+    struct extsort_merge merge = {.count = count, .record_size = record_size, .compare = compare};
+    size_t buffer_bytes = buffer_records * record_size;
+    char *memory = malloc(buffer_bytes * ((size_t)count * EXTSORT_RUN_BUFFERS + 2));
+    merge.runs = malloc(sizeof(struct extsort_run) * count);
+    merge.tree = malloc(sizeof(uint32_t) * count);
+    if (!memory || !merge.runs || !merge.tree){
+        exit(EXIT_FAILURE);
+    }
+
+    bool ok = true;
+    for (uint32_t i = 0; i < count; i++){
+        char *buffers = memory + (size_t)i * EXTSORT_RUN_BUFFERS * buffer_bytes;
+        merge.runs[i] = (struct extsort_run){.file = file, .position = start, .remaining = lengths[i],
+                                             .buffer = buffers, .ahead = buffers + buffer_bytes,
+                                             .capacity = buffer_records};
+        start += (off_t)(lengths[i] * record_size);
+        ExtSort_run_read(&merge.runs[i], record_size, &ok);
+        ExtSort_run_swap(&merge.runs[i]);
+    }
+    merge.tree[0] = ExtSort_build_tree(&merge, 1);
+    ExtSort_reader_start(&merge);
+
+    char *outputs = memory + (size_t)count * EXTSORT_RUN_BUFFERS * buffer_bytes;
+    char *output[2] = {outputs, outputs + buffer_bytes};
+    uint32_t current = 0;
+    size_t filled = 0;
+    struct extsort_write write = {.running = false};
+
+    while (ok){
+        uint32_t winner = merge.tree[0];
+        struct extsort_run *run = &merge.runs[winner];
+        if (run->done){
+            break;      // the winner is exhausted, so they all are
+        }
+        memcpy(output[current] + filled * record_size, run->buffer + run->next * record_size, record_size);
+        if (++filled == buffer_records){
+            ok = ExtSort_write_start(&write, out, output[current], filled * record_size);
+            current ^= 1;
+            filled = 0;
+        }
+        if (++run->next == run->count){
+            ExtSort_run_next(&merge, winner, &ok);
+        }
+        ExtSort_replay(&merge, winner);
+    }
+    if (ok && filled){
+        ok = ExtSort_write_start(&write, out, output[current], filled * record_size);
+    }
+    ok = ExtSort_write_finish(&write) && ok;
+    ExtSort_reader_stop(&merge);
+
+    free(memory);
+    free(merge.runs);
+    free(merge.tree);
+    return ok;
+}
+
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+bool ExtSort_file(FILE *in, FILE *out, size_t record_size, ExtSortCompare compare, size_t memory_budget, ExtSortStats *stats){
+    /* Sort the records in in into out, as described in the header and
+       in the notes at the top. The temporary files are removed when the
+       sort is over, whether it succeeded or not.
+    */
+    ExtSortStats result = {0};
+    double start = ExtSort_seconds();
+
+    if (memory_budget < 4 * record_size){
+        memory_budget = 4 * record_size;    // room for at least 2 records in each run buffer
+    }
+
+    /* ---- run formation ---- */
+    size_t run_records = (memory_budget / 2) / record_size;
+    char *memory = malloc(run_records * record_size * 2);
+    if (!memory){
+        exit(EXIT_FAILURE);
+    }
+    char *buffers[2] = {memory, memory + run_records * record_size};
+    uint32_t current = 0;
+    struct extsort_write write = {.running = false};
+
+    FILE *runs_file = NULL;     // the runs, one after the other
+    uint64_t *run_lengths = NULL;   // in records
+    uint64_t run_count = 0, runs_size = 0;
+    bool ok = true;
+    bool single_run = false;
+
+    while (ok){
+        size_t count = ExtSort_read_records(in, buffers[current], run_records, record_size, &ok);
+        if (!ok || !count){
+            break;
+        }
+        qsort(buffers[current], count, record_size, compare);
+        result.records += count;
+        result.runs++;
+
+        if (!run_count && count < run_records){
+            // the whole input fit in one buffer: no need for a temporary file
+            ok = fwrite(buffers[current], record_size, count, out) == count;
+            single_run = true;
+            break;
+        }
+
+        if (!runs_file && !(runs_file = tmpfile())){
+            ok = false;
+            break;
+        }
+        if (run_count == runs_size){
+            runs_size = runs_size ? 2 * runs_size : 16;
+            run_lengths = realloc(run_lengths, sizeof(uint64_t) * runs_size);
+            if (!run_lengths){
+                exit(EXIT_FAILURE);
+            }
+        }
+        run_lengths[run_count++] = count;
+        ok = ExtSort_write_start(&write, runs_file, buffers[current], count * record_size);
+        current ^= 1;
+    }
+    ok = ExtSort_write_finish(&write) && ok;
+    free(memory);
+    result.bytes = result.records * record_size;
+    double formed = ExtSort_seconds();
+    result.run_seconds = formed - start;
+
+    /* ---- merging ---- */
+    // the fan-in: how many runs get their buffers of at least EXTSORT_MIN_BUFFER (besides the 2 output buffers)
+    size_t min_buffer = (record_size > EXTSORT_MIN_BUFFER) ? record_size : EXTSORT_MIN_BUFFER;
+    uint64_t fan_in = memory_budget / min_buffer;
+    fan_in = (fan_in >= 2 + 2 * EXTSORT_RUN_BUFFERS) ? (fan_in - 2) / EXTSORT_RUN_BUFFERS : 2;
+    if (fan_in > EXTSORT_MAX_FANIN){
+        fan_in = EXTSORT_MAX_FANIN;
+    }
+
+    while (ok && !single_run && run_count){
+        bool last_pass = (run_count <= fan_in);
+        FILE *merged = last_pass ? out : tmpfile();
+        if (!merged){
+            ok = false;
+            break;
+        }
+        uint64_t merged_count = 0;
+        off_t run_start = 0;    // where in runs_file the group's first run starts
+        for (uint64_t first = 0; ok && first < run_count; first += fan_in){
+            uint32_t group = (uint32_t)((run_count - first < fan_in) ? run_count - first : fan_in);
+            size_t buffer_records = (memory_budget / ((size_t)group * EXTSORT_RUN_BUFFERS + 2)) / record_size;
+            if (!buffer_records){
+                buffer_records = 1;
+            }
+            ok = ExtSort_merge_runs(runs_file, run_start, run_lengths + first, group, merged, record_size, compare, buffer_records);
+            uint64_t length = 0;
+            for (uint32_t i = 0; i < group; i++){
+                length += run_lengths[first + i];
+            }
+            run_start += (off_t)(length * record_size);
+            run_lengths[merged_count++] = length;   // the merged runs go to the front: first >= merged_count
+        }
+        result.merge_passes++;
+        fclose(runs_file);
+        runs_file = last_pass ? NULL : merged;
+        run_count = last_pass ? 0 : merged_count;
+    }
+    if (runs_file){
+        fclose(runs_file);
+    }
+    free(run_lengths);
+    ok = (fflush(out) == 0) && ok;
+
+    double end = ExtSort_seconds();
+    result.merge_seconds = end - formed;
+    result.mb_per_second = (end > start) ? (double)result.bytes / 1e6 / (end - start) : 0;
+    if (stats){
+        *stats = result;
+    }
+    return ok;
+}
+
+
+void ExtSort_print_stats(const ExtSortStats *stats){
+    printf("%llu records (%.1f MB) in %llu run(s), %u merge pass(es): "
+           "runs %.3fs, merge %.3fs, %.1f MB/s\n",
+           (unsigned long long)stats->records, (double)stats->bytes / 1e6,
+           (unsigned long long)stats->runs, stats->merge_passes,
+           stats->run_seconds, stats->merge_seconds, stats->mb_per_second);
+}
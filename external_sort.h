@@ -0,0 +1,74 @@
+#ifndef EXTERNAL_SORT_H
+#define EXTERNAL_SORT_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+
+
+/* *********************************************************************** */
+/* ---------------------- External merge sort ---------------------------- */
+/* *********************************************************************** */
+/*
+ * Sorts a file of fixed-size records that may be far larger than the
+ * memory available, using no more than (roughly) a given memory budget.
+ *
+ * The sort has two phases:
+ *  - run formation: the input is read a buffer at a time (half the
+ *    budget), each buffer is sorted in memory with qsort() and written
+ *    out to a temporary file (tmpfile()) as a sorted 'run'.
+ *  - merging: the runs are merged k at a time through a loser tree (a
+ *    tournament tree that needs log2(k) comparisons per record), each
+ *    run read through two buffers of its own. If there are more runs
+ *    than fit in the budget at once, they're merged in several passes.
+ * An input that fits in a single buffer is sorted and written straight
+ * to the output, without a temporary file.
+ *
+ * I/O overlaps with CPU work: a run is written out by a worker thread
+ * while the next one is read and sorted; while merging, a reader thread
+ * reads each run's next buffer while the other one is merged, and the
+ * merged output is written by a worker thread while the next buffer of
+ * it is merged (link with -pthread).
+ *
+ * File positions are 64-bit (off_t, with fseeko()), so inputs and
+ * temporary files can be larger than 2GB on 32-bit systems too.
+ *
+ * Records are compared by a qsort()-style comparator. Records that
+ * compare equal come out in no particular order (the sort is not stable).
+ *
+ * Example (sorting a file of uint64_t, with 64MB of memory)
+ *      ExtSortStats stats;
+ *      ExtSort_file(in, out, sizeof(uint64_t), compare_u64, 64u << 20, &stats);
+ *      printf("%.1f MB/s\n", stats.mb_per_second);
+ */
+
+typedef int (*ExtSortCompare)(const void *record1, const void *record2);
+
+// what a sort did, and how fast
+typedef struct{
+    uint64_t records;
+    uint64_t bytes;
+    uint64_t runs;              // sorted runs formed
+    uint32_t merge_passes;      // 0 if the input fit in a single run
+    double run_seconds;         // time spent forming runs
+    double merge_seconds;       // time spent merging them
+    double mb_per_second;       // bytes sorted (in 10^6 bytes) over the total time
+} ExtSortStats;
+
+
+// sort the records in in (read from its current position to the end) into out;
+// returns false on an I/O error, or if in doesn't hold a whole number of records.
+// stats can be NULL
+bool ExtSort_file(FILE *in, FILE *out, size_t record_size, ExtSortCompare compare, size_t memory_budget, ExtSortStats *stats);
+void ExtSort_print_stats(const ExtSortStats *stats);
+
+
+
+
+
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef HASH_MIX_H
+#define HASH_MIX_H
+
+
+#include <stdint.h>
+
+
+/* Scramble the bits of h so that every bit of the input affects every
+ * bit of the output (the MurmurHash3 64-bit finalizer, 'fmix64').
+ * Shared by the hash-based structures (hash_set, bloom_filter,
+ * hyperloglog), which all need even a weak hash to spread evenly.
+ */
+static inline uint64_t Hash_mix(uint64_t h){
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+
+
+
+#endif
@@ -0,0 +1,468 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash_set.h"
+#include "hash_mix.h"
+#include "bloom_filter.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* ********************************************************** */
+/*                  Implementation Notes
+
+    The set is an open-addressing hash table: the keys are stored
+    directly in an array of slots, and a key that hashes to a slot
+    that's already taken goes into the next free slot after it
+    (linear probing).
+
+    -------------------- Control bytes -------------------------
+    Next to the slots there's an array of control bytes, one per
+    slot. A control byte is either EMPTY (0x80), or, if the slot
+    holds a key, the lowest 7 bits of that key's hash.
+    The rest of the hash picks the slot the key would ideally go in
+    (its 'home' slot).
+
+    A lookup starts at the home slot and looks at the control bytes
+    16 at a time: with SSE2, a single compare gives a 16-bit mask
+    of the slots whose control byte matches the 7 hash bits of the
+    key, and another one the mask of the empty slots. The key is
+    only compared (by calling the equality callback) against the
+    slots in the first mask, and only up to the first empty slot,
+    which is where the probe sequence, and so the lookup, ends.
+    Since a random 7-bit match is 1 in 128, the key comparison
+    almost always happens only once, against the right key.
+
+    So that a group of 16 control bytes can be loaded starting from
+    any slot, even near the end of the table, the first 16 control
+    bytes are repeated after the last one.
+
+    -------------------- Deletion ------------------------------
+    Open-addressing tables usually delete by marking the slot with
+    a 'tombstone', because simply emptying it would cut short the
+    probe sequence of any key stored after it. Tombstones pile up
+    and make lookups longer, until the table is rebuilt.
+
+    With linear probing, that's not necessary: after a slot has
+    been emptied, the keys following it are moved back into it,
+    one by one, as long as that doesn't move a key before its home
+    slot (backward-shift deletion). The table is then exactly as
+    if the deleted key had never been inserted.
+
+    -------------------- Growth --------------------------------
+    The number of slots is always a power of two, and the table
+    is doubled when it gets 7/8 full.
+
+    -------------------- Bloom filter --------------------------
+    Once HSet_enable_bloom() has been called, the set keeps a Bloom
+    filter (see bloom_filter.h) of its keys, sized for as many keys
+    as the table can hold before it next grows. Every lookup asks
+    the filter first, with the hash it needs for the table anyway,
+    and only probes the table if the filter says the key might be
+    there. Insertions add the key to the filter; deletions leave it
+    as is (the filter can't forget keys, which only costs lookups
+    for deleted keys a trip to the table). Whenever the table grows,
+    the filter is rebuilt for the new capacity from the keys
+    actually in the set, which also drops deleted keys from it.
+*/
+
+
+
+#define HSET_EMPTY 0x80
+#define HSET_GROUP_WIDTH 16      // control bytes looked at in one go
+#define HSET_INITIAL_CAPACITY 16   // must be a power of two, >= HSET_GROUP_WIDTH
+
+
+struct hash_set{
+    size_t key_size;
+    HSetHash hash;
+    HSetEqual equal;
+    uint64_t capacity;      // number of slots (a power of two)
+    uint64_t size;          // number of keys in the set
+    uint8_t *control;       // capacity + HSET_GROUP_WIDTH control bytes
+    char *slots;            // capacity * key_size bytes
+    Bloom filter;           // NULL unless HSet_enable_bloom() was called
+    double false_positive_rate;     // what filter is sized for
+};
+
+
+
+
+/* ***************************** Private ****************************** */
+/* -------------------------------------------------------------------- */
+
+static uint64_t HSet_hash_bytes_P(const void *bytes, size_t length){
+    /* FNV-1a over length bytes, followed by Hash_mix() */
+    const unsigned char *byte = bytes;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++){
+        h ^= byte[i];
+        h *= 0x100000001b3ULL;
+    }
+    return Hash_mix(h);
+}
+
+
+static uint64_t HSet_hash_key_P(HSet the_set, const void *key){
+    /* Hash key with the set's callback, or its raw bytes if there is none */
+    return the_set->hash ? the_set->hash(key) : HSet_hash_bytes_P(key, the_set->key_size);
+}
+
+
+static bool HSet_equal_key_P(HSet the_set, const void *key1, const void *key2){
+    /* Compare two keys with the set's callback, or byte by byte if there is none */
+    return the_set->equal ? the_set->equal(key1, key2) : !memcmp(key1, key2, the_set->key_size);
+}
+
+
+static inline uint64_t HSet_home_P(HSet the_set, uint64_t hash){
+    /* The slot a key with this hash would ideally go in */
+    return (hash >> 7) & (the_set->capacity - 1);
+}
+
+
+static inline uint8_t HSet_tag_P(uint64_t hash){
+    /* The 7 bits of the hash kept in the control byte */
+    return hash & 0x7F;
+}
+
+
+static inline char *HSet_slot_P(HSet the_set, uint64_t slot){
+    /* Address of the key stored in slot */
+    return the_set->slots + slot * the_set->key_size;
+}
+
+
+static inline void HSet_set_control_P(HSet the_set, uint64_t slot, uint8_t value){
+    /* Set the control byte of slot, and its copy past the end if it has one */
+    the_set->control[slot] = value;
+    if (slot < HSET_GROUP_WIDTH){
+        the_set->control[the_set->capacity + slot] = value;
+    }
+}
+
+
+static inline uint16_t HSet_match_P(const uint8_t *group, uint8_t value){
+    /* Return a mask with bit i set if group[i] == value, for the
+       HSET_GROUP_WIDTH control bytes starting at group.
+    */
+#if defined(__SSE2__)
+    __m128i bytes = _mm_loadu_si128((const __m128i *)group);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)value)));
+#else
+    uint16_t mask = 0;
+    for (uint8_t i = 0; i < HSET_GROUP_WIDTH; i++){
+        mask |= (uint16_t)(group[i] == value) << i;
+    }
+    return mask;
+#endif
+}
+
+
+static inline uint8_t HSet_lowest_bit_P(uint32_t mask){
+    /* Position of the lowest set bit in mask, which must not be 0 */
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    uint8_t position = 0;
+    while (!(mask & 1)){
+        mask >>= 1;
+        position++;
+    }
+    return position;
+#endif
+}
+
+
+static bool HSet_find_P(HSet the_set, const void *key, uint64_t hash, uint64_t *slot){
+    /* Look key up. If it's found, store the slot it's in in *slot and
+       return true. Otherwise store the first empty slot of its probe
+       sequence, which is where it would have to be inserted, and
+       return false.
+    */
+    uint64_t mask = the_set->capacity - 1;
+    uint64_t position = HSet_home_P(the_set, hash);
+    uint8_t tag = HSet_tag_P(hash);
+
+    while (1){
+        const uint8_t *group = the_set->control + position;
+        uint32_t matches = HSet_match_P(group, tag);
+        uint32_t empties = HSet_match_P(group, HSET_EMPTY);
+
+        if (empties){   // the probe sequence ends in this group: ignore matches past its end
+            matches &= (empties & -empties) - 1;
+        }
+        while (matches){
+            uint64_t candidate = (position + HSet_lowest_bit_P(matches)) & mask;
+            if (HSet_equal_key_P(the_set, HSet_slot_P(the_set, candidate), key)){
+                *slot = candidate;
+                return true;
+            }
+            matches &= matches - 1;
+        }
+        if (empties){
+            *slot = (position + HSet_lowest_bit_P(empties)) & mask;
+            return false;
+        }
+        position = (position + HSET_GROUP_WIDTH) & mask;
+    }
+}
+
+
+static void HSet_allocate_P(HSet the_set, uint64_t capacity){
+    /* Give the_set capacity empty slots */
+    uint8_t *control = malloc(capacity + HSET_GROUP_WIDTH);
+    char *slots = malloc(capacity * the_set->key_size);
+    if (!(control && slots)){
+        exit(EXIT_FAILURE);
+    }
+    memset(control, HSET_EMPTY, capacity + HSET_GROUP_WIDTH);
+
+    the_set->control = control;
+    the_set->slots = slots;
+    the_set->capacity = capacity;
+}
+
+
+static void HSet_build_bloom_P(HSet the_set){
+    /* (Re)build the_set's Bloom filter from the keys in the table,
+       sized for as many keys as the table can take before growing.
+    */
+    Bloom_destroy(&the_set->filter);
+    Bloom_init(&the_set->filter, the_set->capacity - the_set->capacity / 8, the_set->false_positive_rate);
+
+    for (uint64_t i = 0; i < the_set->capacity; i++){
+        if (the_set->control[i] != HSET_EMPTY){
+            Bloom_add(the_set->filter, HSet_hash_key_P(the_set, HSet_slot_P(the_set, i)));
+        }
+    }
+}
+
+
+static void HSet_grow_P(HSet the_set){
+    /* Double the number of slots and reinsert every key.
+       The keys are known to be distinct, so each one just goes
+       into the first empty slot of its probe sequence.
+    */
+    uint8_t *old_control = the_set->control;
+    char *old_slots = the_set->slots;
+    uint64_t old_capacity = the_set->capacity;
+
+    HSet_allocate_P(the_set, old_capacity * 2);
+
+    for (uint64_t i = 0; i < old_capacity; i++){
+        if (old_control[i] == HSET_EMPTY){
+            continue;
+        }
+        const char *key = old_slots + i * the_set->key_size;
+        uint64_t hash = HSet_hash_key_P(the_set, key);
+        uint64_t slot;
+        HSet_find_P(the_set, key, hash, &slot);
+
+        memcpy(HSet_slot_P(the_set, slot), key, the_set->key_size);
+        HSet_set_control_P(the_set, slot, HSet_tag_P(hash));
+    }
+
+    free(old_control);
+    free(old_slots);
+
+    if (the_set->filter){
+        HSet_build_bloom_P(the_set);
+    }
+}
+
+/* ---------------------------------------------------------------- */
+/* ***************************** End Private ********************** */
+
+
+
+void HSet_init(HSet *the_set, size_t key_size, HSetHash hash, HSetEqual equal){
+    /* Allocate memory for an HSet holding keys of key_size bytes
+       and initialize it to the empty set.
+       hash and equal may be NULL; see hash_set.h.
+    */
+    HSet newset = malloc(sizeof(struct hash_set));
+    if (!newset){
+        exit(EXIT_FAILURE);
+    }
+    newset->key_size = key_size;
+    newset->hash = hash;
+    newset->equal = equal;
+    newset->size = 0;
+    newset->filter = NULL;
+    newset->false_positive_rate = 0.0;
+    HSet_allocate_P(newset, HSET_INITIAL_CAPACITY);
+
+    *the_set = newset;
+}
+
+
+uint64_t HSet_size(HSet the_set){
+    /* Return the number of items in the set */
+    return the_set->size;
+}
+
+
+bool HSet_is_empty(HSet the_set){
+    /* Return true if the_set is empty, false otherwise */
+    return the_set->size == 0;
+}
+
+
+bool HSet_contains(HSet the_set, const void *key){
+    /* Return true if key is found in the_set, false otherwise.
+       If the set has a Bloom filter, most keys that aren't there
+       are turned away by it without probing the table.
+    */
+    uint64_t hash = HSet_hash_key_P(the_set, key);
+    if (the_set->filter && !Bloom_might_contain(the_set->filter, hash)){
+        return false;
+    }
+    uint64_t slot;
+    return HSet_find_P(the_set, key, hash, &slot);
+}
+
+
+void HSet_insert(HSet the_set, const void *key){
+    /* Insert key into the set, if not already there */
+    uint64_t hash = HSet_hash_key_P(the_set, key);
+    uint64_t slot;
+
+    if (HSet_find_P(the_set, key, hash, &slot)){
+        return;
+    }
+    // keep at least 1/8 of the slots empty, so probe sequences stay short (and always end)
+    if (the_set->size + 1 > the_set->capacity - the_set->capacity / 8){
+        HSet_grow_P(the_set);
+        HSet_find_P(the_set, key, hash, &slot);
+    }
+
+    memcpy(HSet_slot_P(the_set, slot), key, the_set->key_size);
+    HSet_set_control_P(the_set, slot, HSet_tag_P(hash));
+    the_set->size++;
+
+    if (the_set->filter){
+        Bloom_add(the_set->filter, hash);
+    }
+}
+
+
+void HSet_enable_bloom(HSet the_set, double false_positive_rate){
+    /* Put a Bloom filter with the given false positive rate (e.g. 0.01)
+       in front of the_set, to short-circuit lookups of keys that
+       aren't there. It's kept up to date from then on; see the
+       implementation notes at the top.
+       Calling it again rebuilds the filter with the new rate.
+    */
+    the_set->false_positive_rate = false_positive_rate;
+    HSet_build_bloom_P(the_set);
+}
+
+
+Bloom HSet_bloom(HSet the_set){
+    /* Return the_set's Bloom filter, e.g. to check its estimated false
+       positive rate, or NULL if it doesn't have one.
+       The filter belongs to the set: don't add to or destroy it.
+    */
+    return the_set->filter;
+}
+
+
+void HSet_del(HSet the_set, const void *key){
+    /* Delete key from the_set, if found.
+
+       The slot is emptied, and the keys after it are shifted back
+       (see the implementation notes at the top), so no tombstone
+       is left behind.
+    */
+    uint64_t hole;
+    if (!HSet_find_P(the_set, key, HSet_hash_key_P(the_set, key), &hole)){
+        return;
+    }
+    HSet_set_control_P(the_set, hole, HSET_EMPTY);
+    the_set->size--;
+
+    uint64_t mask = the_set->capacity - 1;
+    uint64_t next = hole;
+    while (1){
+        next = (next + 1) & mask;
+        if (the_set->control[next] == HSET_EMPTY){
+            break;      // end of the probe sequence
+        }
+        uint64_t home = HSet_home_P(the_set, HSet_hash_key_P(the_set, HSet_slot_P(the_set, next)));
+
+        // the key in next can fill the hole unless its home slot lies after the hole,
+        // i.e. somewhere in (hole, next] (going around the end of the table if need be)
+        if (((next - home) & mask) < ((next - hole) & mask)){
+            continue;
+        }
+        memcpy(HSet_slot_P(the_set, hole), HSet_slot_P(the_set, next), the_set->key_size);
+        HSet_set_control_P(the_set, hole, the_set->control[next]);
+        HSet_set_control_P(the_set, next, HSET_EMPTY);
+        hole = next;
+    }
+}
+
+
+void *HSet_items(HSet the_set){
+    /* Returns a dynamically-allocated array containing all the keys
+       in the_set (HSet_size() of them), in no particular order.
+       It's the responsibility of the caller to call free() on this
+       returned array when no longer needed.
+    */
+    char *items_array = malloc(the_set->size * the_set->key_size + 1);  // +1 so that an empty set doesn't malloc(0)
+    if (!items_array){
+        exit(EXIT_FAILURE);
+    }
+
+    char *next = items_array;
+    for (uint64_t i = 0; i < the_set->capacity; i++){
+        if (the_set->control[i] != HSET_EMPTY){
+            memcpy(next, HSet_slot_P(the_set, i), the_set->key_size);
+            next += the_set->key_size;
+        }
+    }
+    return items_array;
+}
+
+
+void HSet_destroy(HSet *the_set){
+    /* Deallocate all associated heap memory and set
+       *the_set to NULL
+    */
+    if (!(*the_set)){
+        return;
+    }
+    Bloom_destroy(&(*the_set)->filter);
+    free((*the_set)->control);
+    free((*the_set)->slots);
+    free(*the_set);
+    *the_set = NULL;
+}
+
+
+
+uint64_t HSet_hash_u64(const void *key){
+    /* Hash callback for uint64_t keys */
+    return Hash_mix(*(const uint64_t *)key);
+}
+
+
+bool HSet_equal_u64(const void *key1, const void *key2){
+    /* Equality callback for uint64_t keys */
+    return *(const uint64_t *)key1 == *(const uint64_t *)key2;
+}
+
+
+uint64_t HSet_hash_string(const void *key){
+    /* Hash callback for string keys: key points to a char pointer */
+    const char *string = *(const char * const *)key;
+    return HSet_hash_bytes_P(string, strlen(string));
+}
+
+
+bool HSet_equal_string(const void *key1, const void *key2){
+    /* Equality callback for string keys: key1 and key2 point to char pointers */
+    return !strcmp(*(const char * const *)key1, *(const char * const *)key2);
+}
@@ -0,0 +1,77 @@
+#ifndef HASHSET_H
+#define HASHSET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bloom_filter.h"
+
+
+/* ***************************************************************** */
+/*                          * * *                                    */
+/*                   Hash Set (unordered)
+ *
+ *  This is an implementation of a mutable, UNORDERED Set ADT
+ *  for keys of any type.
+ *
+ *  Unlike the DSet (see mutable_set.h), which keeps its items sorted
+ *  in a BST and is limited to chars, this one is a hash table, and
+ *  so offers O(1) expected lookup, insertion and deletion for keys
+ *  such as 64-bit ids or strings. It gives up ordering to do so:
+ *  HSet_items() returns the items in no particular order.
+ *
+ *  Every key takes up key_size bytes, which are copied into the set.
+ *  Keys are hashed and compared by the callbacks passed to HSet_init().
+ *  Both get pointers to keys (i.e. to key_size bytes). If NULL is
+ *  passed for either, the key bytes are hashed or compared as they are.
+ *
+ *  Callbacks for the two common cases are provided below:
+ *  - uint64_t keys:   HSet_hash_u64 and HSet_equal_u64
+ *  - string keys:     HSet_hash_string and HSet_equal_string.
+ *                     Here the key is a char pointer (key_size is
+ *                     sizeof(char *)): the set stores the pointer, and
+ *                     the string it points to has to outlive the set.
+ *
+ *  Example
+ *      HSet ids;
+ *      HSet_init(&ids, sizeof(uint64_t), HSet_hash_u64, HSet_equal_u64);
+ *      uint64_t id = 1234567;
+ *      HSet_insert(ids, &id);
+ *      HSet_contains(ids, &id);     // true
+ *      HSet_destroy(&ids);
+ *
+ *  For sets where most lookups are for keys that aren't there,
+ *  HSet_enable_bloom() puts a Bloom filter in front of the table,
+ *  which the set then keeps up to date by itself. Lookups of
+ *  missing keys are then mostly answered by the filter, which is
+ *  much smaller than the table, and so more likely to be in cache.
+ *
+ * *************************************************************** */
+
+typedef struct hash_set *HSet;
+
+typedef uint64_t (*HSetHash)(const void *key);
+typedef bool (*HSetEqual)(const void *key1, const void *key2);
+
+
+void HSet_init(HSet *the_set, size_t key_size, HSetHash hash, HSetEqual equal);
+bool HSet_contains(HSet the_set, const void *key);
+void HSet_insert(HSet the_set, const void *key);
+void HSet_del(HSet the_set, const void *key);
+uint64_t HSet_size(HSet the_set);
+bool HSet_is_empty(HSet the_set);
+void *HSet_items(HSet the_set);   // returns a dynamically-allocated array of HSet_size() keys, in no particular order
+void HSet_destroy(HSet *the_set);   // destroy an HSet and free all memory associated with it
+
+void HSet_enable_bloom(HSet the_set, double false_positive_rate);
+Bloom HSet_bloom(HSet the_set);     // the set's Bloom filter, or NULL
+
+uint64_t HSet_hash_u64(const void *key);
+bool HSet_equal_u64(const void *key1, const void *key2);
+uint64_t HSet_hash_string(const void *key);
+bool HSet_equal_string(const void *key1, const void *key2);
+
+
+
+#endif
@@ -0,0 +1,223 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hyperloglog.h"
+#include "hash_mix.h"
+
+/* ********************************************************** */
+/*                  Implementation Notes
+
+    The hash of an item is split in two: its top 'precision' bits
+    pick one of the m = 2^precision registers, and the position of
+    the first 1 bit in the remaining bits (1 for a leading 1, 2 for
+    01, ...) is the item's 'rank'. Each register holds the largest
+    rank of the items that went to it.
+
+    A rank of r comes up once in about 2^r distinct items, so the
+    registers together say how many distinct items there were;
+    the same item always goes to the same register with the same
+    rank, so repeats make no difference. The estimate is
+
+        alpha * m^2 / sum(2^-register)
+
+    (alpha corrects for a bias of the harmonic mean). For small
+    counts, while some registers are still 0, that estimate is
+    poor, and 'linear counting' is used instead: m ln(m / zeros).
+    With 64-bit hashes there's no need for the large-range
+    correction of the original 32-bit algorithm.
+
+    Merging takes the larger of each pair of registers, which
+    gives exactly the registers a single sketch would have had
+    after seeing both streams.
+*/
+
+
+#define HLL_MAGIC "HLL1"
+#define HLL_HEADER_SIZE 5       // magic + precision
+
+
+struct hyperloglog{
+    uint8_t precision;
+    uint32_t registers_count;       // 2^precision
+    uint8_t *registers;
+};
+
+
+
+
+/* ***************************** Private ****************************** */
+/* -------------------------------------------------------------------- */
+
+static inline uint8_t HLL_leading_zeros_P(uint64_t word){
+    /* Number of leading 0 bits in word, which must not be 0 */
+#if defined(__GNUC__)
+    return __builtin_clzll(word);
+#else
+    uint8_t count = 0;
+    while (!(word >> 63)){
+        word <<= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+
+static HLL HLL_new_P(uint8_t precision){
+    /* Allocate a sketch of the given precision, with all its registers 0 */
+    HLL newsketch = malloc(sizeof(struct hyperloglog));
+    if (!newsketch){
+        exit(EXIT_FAILURE);
+    }
+    newsketch->precision = precision;
+    newsketch->registers_count = (uint32_t)1 << precision;
+    newsketch->registers = calloc(newsketch->registers_count, 1);
+    if (!newsketch->registers){
+        exit(EXIT_FAILURE);
+    }
+    return newsketch;
+}
+
+/* ---------------------------------------------------------------- */
+/* ***************************** End Private ********************** */
+
+
+
+void HLL_init(HLL *sketch, uint8_t precision){
+    /* Allocate and initialize an empty sketch with 2^precision registers.
+       precision is clamped to [HLL_MIN_PRECISION, HLL_MAX_PRECISION].
+    */
+    if (precision < HLL_MIN_PRECISION){
+        precision = HLL_MIN_PRECISION;
+    }
+    if (precision > HLL_MAX_PRECISION){
+        precision = HLL_MAX_PRECISION;
+    }
+    *sketch = HLL_new_P(precision);
+}
+
+
+void HLL_add(HLL sketch, uint64_t hash){
+    /* Add the item with this hash to the sketch */
+    hash = Hash_mix(hash);
+    uint32_t index = hash >> (64 - sketch->precision);
+
+    // the remaining bits, with a 1 after them so that a run of 0s ends within the word
+    uint64_t rest = (hash << sketch->precision) | ((uint64_t)1 << (sketch->precision - 1));
+    uint8_t rank = HLL_leading_zeros_P(rest) + 1;
+
+    if (rank > sketch->registers[index]){
+        sketch->registers[index] = rank;
+    }
+}
+
+
+uint64_t HLL_count(HLL sketch){
+    /* Return the estimated number of distinct items added to the sketch */
+    double m = sketch->registers_count;
+    double sum = 0.0;
+    uint32_t zeros = 0;
+
+    for (uint32_t i = 0; i < sketch->registers_count; i++){
+        sum += ldexp(1.0, -sketch->registers[i]);
+        zeros += !sketch->registers[i];
+    }
+
+    double alpha;
+    switch (sketch->registers_count){
+        case 16: alpha = 0.673; break;
+        case 32: alpha = 0.697; break;
+        case 64: alpha = 0.709; break;
+        default: alpha = 0.7213 / (1.0 + 1.079 / m); break;
+    }
+
+    double estimate = alpha * m * m / sum;
+    if (estimate <= 2.5 * m && zeros){
+        estimate = m * log(m / zeros);     // linear counting
+    }
+    return (uint64_t)(estimate + 0.5);
+}
+
+
+double HLL_standard_error(HLL sketch){
+    /* Return the relative standard error of the sketch's estimates */
+    return 1.04 / sqrt((double)sketch->registers_count);
+}
+
+
+bool HLL_merge(HLL target, HLL other){
+    /* Add all the items seen by other to target.
+       Return false, leaving target untouched, if the two sketches
+       don't have the same precision.
+    */
+    if (target->precision != other->precision){
+        return false;
+    }
+    for (uint32_t i = 0; i < target->registers_count; i++){
+        if (other->registers[i] > target->registers[i]){
+            target->registers[i] = other->registers[i];
+        }
+    }
+    return true;
+}
+
+
+size_t HLL_serialized_size(HLL sketch){
+    /* Return the number of bytes HLL_serialize() writes */
+    return HLL_HEADER_SIZE + sketch->registers_count;
+}
+
+
+size_t HLL_serialize(HLL sketch, uint8_t buffer[]){
+    /* Write sketch into buffer in the format described in hyperloglog.h,
+       and return the number of bytes written.
+    */
+    memcpy(buffer, HLL_MAGIC, 4);
+    buffer[4] = sketch->precision;
+    memcpy(buffer + HLL_HEADER_SIZE, sketch->registers, sketch->registers_count);
+    return HLL_serialized_size(sketch);
+}
+
+
+bool HLL_deserialize(HLL *sketch, const uint8_t buffer[], size_t length){
+    /* Build a new sketch out of the length bytes in buffer, written by
+       HLL_serialize(), and store it in *sketch.
+       If the data is malformed or truncated, *sketch is set to NULL
+       and false is returned.
+    */
+    *sketch = NULL;
+    if (length < HLL_HEADER_SIZE || memcmp(buffer, HLL_MAGIC, 4)){
+        return false;
+    }
+    uint8_t precision = buffer[4];
+    if (precision < HLL_MIN_PRECISION || precision > HLL_MAX_PRECISION
+            || length != HLL_HEADER_SIZE + ((size_t)1 << precision)){
+        return false;
+    }
+
+    HLL newsketch = HLL_new_P(precision);
+    for (uint32_t i = 0; i < newsketch->registers_count; i++){
+        uint8_t rank = buffer[HLL_HEADER_SIZE + i];
+        if (rank > 64 - precision + 1){     // no hash can give a rank that high
+            HLL_destroy(&newsketch);
+            return false;
+        }
+        newsketch->registers[i] = rank;
+    }
+    *sketch = newsketch;
+    return true;
+}
+
+
+void HLL_destroy(HLL *sketch){
+    /* Deallocate all associated heap memory and set
+       *sketch to NULL
+    */
+    if (!(*sketch)){
+        return;
+    }
+    free((*sketch)->registers);
+    free(*sketch);
+    *sketch = NULL;
+}
@@ -0,0 +1,59 @@
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* ***************************************************************** */
+/*                          * * *                                    */
+/*                HyperLogLog distinct-count sketch
+ *
+ *  A HyperLogLog estimates how many DISTINCT items it has seen,
+ *  in a fixed, small amount of memory, however long the stream of
+ *  items and however many of them there are: 2^precision one-byte
+ *  registers (16KB for the default precision of 14).
+ *
+ *  The estimate is approximate: its relative standard error is
+ *  1.04 / sqrt(2^precision), i.e. about 0.8% at precision 14.
+ *  HLL_standard_error() returns it for a given sketch.
+ *
+ *  Items are added by their 64-bit hash; any of the hash callbacks
+ *  in hash_set.h will do (e.g. HSet_hash_u64).
+ *
+ *  Two sketches of the same precision can be merged: the result
+ *  estimates the number of distinct items in the union of the two
+ *  streams, so streams can be counted in pieces (on different
+ *  threads or machines) and combined afterwards.
+ *
+ *  Serialization format:
+ *      "HLL1"                  4 bytes
+ *      precision               uint8_t
+ *      registers               2^precision bytes
+ *
+ *  Link with -lm.
+ *
+ * *************************************************************** */
+
+typedef struct hyperloglog *HLL;
+
+#define HLL_MIN_PRECISION 4
+#define HLL_MAX_PRECISION 18
+#define HLL_DEFAULT_PRECISION 14
+
+
+void HLL_init(HLL *sketch, uint8_t precision);
+void HLL_add(HLL sketch, uint64_t hash);
+uint64_t HLL_count(HLL sketch);     // estimated number of distinct items added
+double HLL_standard_error(HLL sketch);
+bool HLL_merge(HLL target, HLL other);     // add other's items to target; false if their precisions differ
+void HLL_destroy(HLL *sketch);   // destroy an HLL and free all memory associated with it
+
+size_t HLL_serialized_size(HLL sketch);
+size_t HLL_serialize(HLL sketch, uint8_t buffer[]);  // buffer must hold HLL_serialized_size() bytes
+bool HLL_deserialize(HLL *sketch, const uint8_t buffer[], size_t length);
+
+
+
+#endif
@@ -1,635 +1,556 @@
-
-
 /* *********************** IMPLEMENTATION NOTES ************************ */
 /* --------------------------------------------------------------------- */
-/* The heap, as implemented here, relies on the structure of a binary tree.
-   That is to say, the nodes in the heap are linked together explicitly
-   by means of pointers, rather than implicitly - when the heap is stored
-   compactly, as an implicit data structure, inside an array.
-
-   There are two additional constraints to be complied with for a binary tree
-   to be a heap:
-   - the shape property : the heap is an almost complete binary tree, with
-   new nodes having to be added as far left as possible, until the last 
-   level is filled, before starting a new level. In other words, insertions
-   are done at the bottom, from left to right. 
-   - the heap property: this is the relative ordering of the heap, where
-   each node is either greater than its children (in a max heap) or smaller
-   than them (in a min heap).
-
-   The two 'properties' above, while straightforward to understand, pose
-   perhaps surprisingly challenging issues to explicit, binary-tree -based
-   heap implementations, as discussed below. 
-
-
-   ------------------Explicit and Implicit Heaps--------------------------
-   It's safe to say Heaps are usually implemented as implicit data structures
-   inside an array, where the heap operations manipulate the array indexes
-   mathematically, to modify the array in place. 
-   This is as opposed to the explicit implementation of the heap, where use
-   of pointers is involved in a binary-tree structure, which is comparatively
-   only very rarely the approach taken, in practice.
-
-   While the implicit implementation does have its own issues - mainly 
-   having to grow the array when new items are inserted into the heap (
-   which is a costly operation) - the reason heaps are all but always
-   implemented implicitly rather than explicitly becomes apparent
-   when trying to take the latter approach. 
-
-
-   --------------Explicit Heap Implementation Challenges-----------------
-
-   The issue of having to resize the array aside, array-based heaps afford
-   constant time insertion of new nodes at the end of the array. 
-   This is the fundamental issue, really. Since array manipulation
-   boils down to indexes, and since the relationship between the nodes
-   in an array-stored heap can be determined easily in terms of indexes,
-   one can easily determine the position of the last heap node. 
-   This is of the utmost importance, because various fundamental operations
-   are centered around it: removing the root replaces it with the last node,
-   which is then 'sifted down'; inserting a new node is done at the free 
-   slot following the last-added node, and then the new node is 'sifted up'.
-
-   The last sentence encapsulates both, on the one hand, the ease and 
-   convenience of implementing a heap as an array-based structure, and
-   on the other hand, the difficulties and pains of doing it in a
-   binary-tree context.
-
-   Knowing the position of the last-added item, the next open slot is
-   the one immediately following it. 
-   In an array, the former is easily determined, and the latter is 
-   simply x+1, where x is the index of the last-added item. 
-   In a tree, it's comparatively more difficult to find the last-added
-   node, and arguably even more so finding the open slot after it,
-   where the new node is supposed to be inserted. 
-
-   The 'shape property' of the heap thus proves difficult to maintain. 
-   
-   There are a few things that could be done, ranging in complexity
-   and overhead. 
-
-   Probably the most obvious solution would be to traverse the tree
-   breadth-first. But this might mean unacceptable or prohibitive 
-   overhead in the case of a very large heap: building a queue data
-   structure where, on by one, all the nodes are enqueued, then
-   examining each node until the free slot is found. This free slot
-   will invariably be found only at the very end of the heap,
-   which means you ALWAYS have to carry out a complete traversal
-   going over every single node. Knowing this, you could simply
-   enqueue all the nodes, but jump ahead to some calculated point deep
-   into the queue, where you know the last level of the tree is
-   supposed to start. That notwithstanding, this is an expensive 
-   option.
-
-   You could try and keep a pointer tracking the last-added node, 
-   and then starting from there, find the next free slot. 
-   But this pointer adds space overhead, has to be updated every
-   time an insertion occurs, and solves only half of the problem:
-   you still have to find the next free slot from there, which 
-   is easier said than done. 
-   A related, more full-fledged, alternative is to use a threaded
-   binary tree where the leaves have pointers to their successor/
-   predecessor. This would again though add substantial overhead
-   and complexity as the threaded-tree apparatus has to be 
-   maintained.
-
-   After figuring these two out, and are in a position where you
-   can relatively efficiently find the slot where a new node needs 
-   to go, you then have to 'sift up' or 'percolate up' this node, 
-   so as to find its correct position in the heap and abide by the 
-   'heap property'.
-   That is to say, a node is swapped with its parent if its value
-   is larger (max-heap) or smaller (min-heap).
-
-   Each parent has a pointer to each one of its children, but
-   this relationship is one-way only: a child has no pointer to
-   its parent. 
-   To move a node UP the heap then, you need the parent of said node.
-   You could write a routine tracking the node immediately preceding
-   the last node, and then you could compare and potentially swap
-   the newly-inserted node with its parent. 
-   But you need not only its immediate parent, but all the parent nodes
-   on the way to root, potentially. 
-   This means that this routine would have to be called 
-   repeatedly (a number of times proportional to the height of
-   the tree) each time the node has moved up one position, in order
-   to find its next parent up the tree. Needless to say, this would
-   make sift-up a very costly operation.
-   A better solution, but which would add space overhead, would be
-   to have each node also have a pointer to its parent, making
-   movement up and down the tree trivial.
-
-   
-   ---------- Specific Implementation -------------------------
-
-   No matter the route taken, there's going to be some overhead
-   involved, and normally some time-space tradeoffs. 
-
-   This specific implementation doesn't add extra 'parent'
-   pointers to the nodes, nor does it keep a 'last' pointer,
-   though these would both (especially the former) be valid
-   options, depending on the implementation and its goals.
-
-   Instead it relies on the idea that, like in an array, the
-   next free slot can be determined mathematically, and the
-   same applies to the position of the parent of any node. 
-
-   Given a heap of 7 items, the next slot, will of course, be
-   slot 7+1, just like in an array. 
-   This answers part of the question. The part it doesn't answer
-   is how you find slot 7+1.
-   This can be easily determined as well, based on the observation
-   that the position of each parent is equal to the position of its
-   child divided by two, disregarding any remainder. 
-
-   (Node positions are numbered breadth-first, from left to right).
-                       1
-                    2     3
-                   4 5   6 7
-    The parent of node seven is 7/2 = 3 (remainder of 1, dropped). 
-
-    Building on this, the WHOLE PATH from this node to the root can
-    be traced, by combining these observations.
-    1. Each new insertion happens at n+1, where n is the total number
-    of nodes in the heap. 
-    So given the heap above where n=7, a new node '8' will be inserted 
-    at n+1 = 8. 
-    2. The parent of '8' will be at 8 / 2 = 4, and the parent of 4 will
-    be at 4/2 = 2, and the parent of 2 will be at 2/2 = 1, which is root. 
-    
-    Therefore the path from root to '8' is 1-2-4-8. 
-    As can be seen above, this is all the way down the tree, hugging the left
-    side. All the divisions above left no remainder. This is important: if the 
-    division leaves no remainder, then the number is even, and starting at
-    root, the path goes to the left. Conversely, if there's a remainder of 1, 
-    the path is to the right.
-
-    So the modulo operator will come in handy here, for tracing the path
-    to the node, starting off at root.
-    Alternatively, you can use bitwise shifting. It will probably not lead
-    to better performance though, as the compiler is in all likelihood already
-    using this for the modulo operation anyway.
-
-    Given the same example above, you can trace the path from root to node '8'
-    as follows. 
-        8 in binary: 1000
-    You can use a mask of 0001 and AND the two. If the bitwise result is a 1,
-    you go right, while if it's a 0, you go left. 
-    Then shift 8 left by one (8 >>= 1).
-    Notice that when you've reached the slot, '8' still has a bit (the left-most, 1)
-    left in it. This isn't necessary, since you've already reached the end
-    of the path. So the left-most bit is to be disregarded.
-
-    ***********************************************
-    This specific implementation uses the approach above to find the next free 
-    slot for insertions, and then trace the path from root to where this new
-    node is to be inserted. This path is needed twice, in opposite directions: 
-    coming down from root to find the slot to insert the new node, and going back 
-    up the path during sift-up, after the node is inserted. 
-
-    To avoid computing the path twice, a stack data structure is used. 
-    The top of the stack will be the slot itself, the top-1 will be
-    its parent, top-2 the next parent up the tree, and so on.
-    
-    compute the path with bitwise shift:
-    push0, push0, push1, for example.
-    
-    stack1                      
-    1  pop1 - go right 
-    0  pop0 - go left  
-    0  pop0 - go left 
-
-    Going back up:
-    stack 2:
-    0
-    0
-    1
-    pop0, pop0,pop1
-
-    In the implementation below, only one stack is used.
-    It looks like stack1. The top of the stack is discarded,
-    and top-1 (which is the parent of the free slot) is only
-    peeked at, not popped off the stack. 
-    Then the stack is reversed (turned upside down, upended),
-    and fed to the sift-up routine as the path back up the tree
-    to root.
-    
-    The above is just very simplified pseudocode, to give an idea. 
-    In the actual implementation 1 means a pointer to the right child,
-    and 0 means a pointer to the left child. That means the each child
-    along the path has a pointer to the parent above it by popping this 
-    pointer off the stack. 
-    The path from root to the next free slot is therefore created and 
-    kept on the stack, as a series of pointers. 
-
-    To avoid having to count the number of nodes in the tree for every 
-    insertion (necessary for finding the next free slot), there are two
-    separate structs being used: one for heap nodes, which has a key and 
-    right and left pointers, and a separate struct for the heap itself,
-    having a pointer to the root of the heap, and a count member, storing
-    the number of nodes and thus making determining the size of the tree
-    a matter of looking it up rather than computing it every time.
-
-    ----------------------CONCLUSION----------------------------------
-
-    Implementing a heap explicitly as a binary tree is something
-    that's very rarely done in practice, and there are good reasons
-    for that. It does have the upside of being able to better
-    visualize the heap structure (which is why heaps are often shown
-    in tree form in diagrams) as well as being able to grow the 
-    heap without having to resize an array. 
-
-    On the flip side, the fundamental heap operations are more complicated
-    and awkward to reason about in a tree-based heap, specifically
-    finding the next free slot for new node insertions and finding
-    the next parent up the tree for the sift-up routine.
-
+/* The heap is implemented as a pairing heap: a tree where each node can
+   have any number of children, and where the only constraint is the
+   heap property: each node is smaller than its children (in a min-heap)
+   or greater than them (in a max-heap).
+
+   ---------------------------- Why not a binary heap -------------------
+   A binary heap also has to keep its 'shape property': it has to be an
+   almost complete binary tree, filled in from left to right. In an array
+   that comes for free, since the next free slot is simply index n.
+   In a pointer-based tree, though, every insertion and every pop has to
+   trace the path from the root to the last slot (from the bits of n),
+   and sift a value up or down that path, which is a lot of pointer
+   chasing for what's a single index in an array.
+
+   A pairing heap drops the shape property altogether. There's no
+   'last slot': new nodes and whole heaps are simply linked in at the
+   top, and the work of restoring some order is deferred to the pops.
+
+   ---------------------------- Representation -------------------------
+   Each node has three pointers:
+   - child: its leftmost child. The children of a node form a list,
+     linked through:
+   - sibling: the next child of the same parent, and
+   - prev: the previous child of the same parent or, for the leftmost
+     child, the parent itself. The root's prev is NULL.
+   This 'child, sibling' form makes it a binary tree in memory, while
+   prev allows any node to be unlinked from its list in O(1), which is
+   what node handles need.
+
+   ---------------------------- Operations ------------------------------
+   The basic operation is LINKING two heaps: the root that comes second
+   in heap order becomes the leftmost child of the other root. That's O(1).
+   - insert: link a new single-node heap with the heap.
+   - meld: link the two roots.
+   - pop root: remove the root, and combine the list of its children
+     into a single heap, in two passes: first link them in pairs, left
+     to right, then link the pairs right to left, each into the heap
+     built so far. The two passes are what make the pop O(log n)
+     amortized: a long list of children is shortened to half its length
+     in one go, and the results are linked in an order that keeps lists
+     short for the later pops.
+   - delete a node: unlink it (with its subtree) from its list, combine
+     its children as in pop root, and link the result back with the heap.
+
+   ---------------------------- Node pool -------------------------------
+   Nodes are allocated HEAP_POOL_BLOCK at a time, in blocks kept by the
+   heap, and nodes that are deleted go onto a free list they're reused
+   from. Inserting thus only calls malloc() once every HEAP_POOL_BLOCK
+   insertions (and never while there are free nodes), deleting never
+   calls free(), and Heap_destroy() frees whole blocks.
+   Melding two heaps also hands over the blocks and free list of the
+   heap that goes away, in O(1).
+
+   ---------------------------- Min and max -----------------------------
+   The heap keeps a flag for its ordering, and all comparisons go
+   through Heap_before_P(). Heap_maxheapify() and Heap_minheapify()
+   set that flag and, if it changed, take all the nodes apart and
+   combine them again, in O(n).
     *********************************************************************   
 */
 
 
 #include "minheap_ex.h"
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
-#include "stack.h"
-#include "queue.h"
 #include <stdio.h>
 
+#define HEAP_POOL_BLOCK 64      // nodes allocated at a time
+
+
 // structure of a Min-Heap node
+struct minheapnode{
+    char data;
+    HeapNode child;     // leftmost child
+    HeapNode sibling;   // next child of the same parent
+    HeapNode prev;      // previous child of the same parent, or the parent, for the leftmost child
+};
+
+// a block of nodes in the pool
+struct heap_block{
+    struct heap_block *next;
+    struct minheapnode nodes[HEAP_POOL_BLOCK];
+};
+
 struct minheap{
     HeapNode root;
     uint32_t count;
+    bool is_max;        // true after Heap_maxheapify()
+    struct heap_block *blocks;      // all the blocks of the pool, newest first
+    struct heap_block *first_block; // the oldest one, i.e. the end of the list
+    HeapNode free_nodes;    // nodes to reuse, linked through sibling
+    HeapNode free_tail;     // last node on that list
 };
 
-struct minheapnode{
-    char data;
-    HeapNode left;
-    HeapNode right;
-};
 
 
+/* ***************************** Private ****************************** */
+/* -------------------------------------------------------------------- */
 
-uint32_t Heap_count(Heap the_heap){
-    return the_heap->count;
-};
+static inline bool Heap_before_P(Heap the_heap, char value1, char value2){
+    /* Return true if value1 has to be above value2 in the heap */
+    return the_heap->is_max ? value1 > value2 : value1 < value2;
+}
 
 
+static HeapNode Heap_make_new_node_P(Heap the_heap, char the_value){
+    /* Take a node from the pool (refilling it if it's empty),
+       and initialize it as a single-node heap holding the_value.
+       Return NULL if memory runs out.
+    */
+    if (!the_heap->free_nodes){
+        struct heap_block *block = malloc(sizeof(struct heap_block));
+        if (!block){
+            return NULL;
+        }
+        block->next = the_heap->blocks;
+        the_heap->blocks = block;
+        if (!the_heap->first_block){
+            the_heap->first_block = block;
+        }
+        for (uint32_t i = 0; i < HEAP_POOL_BLOCK - 1; i++){
+            block->nodes[i].sibling = &block->nodes[i+1];
+        }
+        block->nodes[HEAP_POOL_BLOCK-1].sibling = NULL;
+        the_heap->free_nodes = &block->nodes[0];
+        the_heap->free_tail = &block->nodes[HEAP_POOL_BLOCK-1];
+    }
 
+    HeapNode newnode = the_heap->free_nodes;
+    the_heap->free_nodes = newnode->sibling;
+    if (!the_heap->free_nodes){
+        the_heap->free_tail = NULL;
+    }
 
-void Heap_init(Heap *heap_ref){
-    /* Allocate memory for a Heap and initialize it with
-       the correct values
+    newnode->data = the_value;
+    newnode->child = newnode->sibling = newnode->prev = NULL;
+    return newnode;
+}
+
+
+static void Heap_free_node_P(Heap the_heap, HeapNode the_node){
+    /* Put the_node back in the pool */
+    the_node->sibling = the_heap->free_nodes;
+    the_heap->free_nodes = the_node;
+    if (!the_heap->free_tail){
+        the_heap->free_tail = the_node;
+    }
+}
+
+
+static HeapNode Heap_link_P(Heap the_heap, HeapNode root1, HeapNode root2){
+    /* Link two heaps (either can be NULL) and return the root of the
+       result: the root that comes second becomes the leftmost child
+       of the other one.
     */
-    Heap newheap = malloc(sizeof(struct minheap));
-    
-    if (newheap){
-        newheap->root = NULL;
-        newheap->count = 0;
+    if (!root1){
+        return root2;
+    }
+    if (!root2){
+        return root1;
     }
+    if (Heap_before_P(the_heap, root2->data, root1->data)){
+        HeapNode temp = root1;
+        root1 = root2;
+        root2 = temp;
+    }
+    root2->sibling = root1->child;
+    if (root1->child){
+        root1->child->prev = root2;
+    }
+    root2->prev = root1;
+    root1->child = root2;
 
-    *heap_ref = newheap;
-};
+    root1->sibling = root1->prev = NULL;
+    return root1;
+}
 
-static Stack Heap_find_path_to_node_P(Heap the_heap, int32_t node_position){
-    Stack way_down;   
-    Stack_init(&way_down);
-    // trace the path from the root to the free slot by pushing each node along the path
-    // on the stack. They can then be popped one by one to get from
-    // the root to the free slot
 
+static HeapNode Heap_combine_siblings_P(Heap the_heap, HeapNode first){
+    /* Combine a list of heaps, linked through their sibling pointers,
+       into a single heap, and return its root (NULL for an empty list).
+       This is the two-pass pairing described in the notes at the top.
+    */
+    // first pass: link the heaps in pairs, left to right, stacking the results up
+    HeapNode pairs = NULL;      // stack of linked pairs, through sibling
+    while (first){
+        HeapNode heap1 = first;
+        HeapNode heap2 = heap1->sibling;
+        first = heap2 ? heap2->sibling : NULL;
+
+        heap1->sibling = heap1->prev = NULL;
+        if (heap2){
+            heap2->sibling = heap2->prev = NULL;
+        }
+        HeapNode pair = Heap_link_P(the_heap, heap1, heap2);
+        pair->sibling = pairs;
+        pairs = pair;
+    }
 
-    // push root onto the stack first 
-    StackItem node = Stack_make_item(the_heap->root); 
-    // the_heap->root is stored as a void pointer in 'node', which is returned by
-    // Stack_pop() and Stack_peek()
-    Stack_push(way_down, node);     // push the node onto the way_down stack
+    // second pass: link the pairs right to left (the stack has them in that order)
+    HeapNode result = NULL;
+    while (pairs){
+        HeapNode pair = pairs;
+        pairs = pair->sibling;
+        pair->sibling = NULL;
+        result = Heap_link_P(the_heap, pair, result);
+    }
+    return result;
+}
 
-    
-    uint8_t temp;   // used to test the result of the bit shift in the while loop below
-    HeapNode current = (HeapNode)Stack_peek(way_down); 
-    
-    // turn the bits in node_position around
-    {
-        uint32_t bits_flipped = 1;  // this first, leftmost bit will be disregarded when tracing the path from root to node
 
-        while (node_position){
-            temp = node_position & 1;
+static HeapNode Heap_parent_P(HeapNode the_node){
+    /* Return the parent of the_node, or NULL for the root */
+    while (the_node->prev && the_node->prev->child != the_node){
+        the_node = the_node->prev;
+    }
+    return the_node->prev;
+}
+
 
-            bits_flipped <<= 1;
-            bits_flipped += temp;
-            node_position >>= 1;
+static HeapNode Heap_next_P(HeapNode the_node, bool skip_children){
+    /* Return the node after the_node in a preorder walk of the heap
+       (NULL at the end). If skip_children is true, the subtree
+       below the_node is left out of the walk.
+       Walking this way needs no stack or queue.
+    */
+    if (the_node->child && !skip_children){
+        return the_node->child;
+    }
+    while (the_node && !the_node->sibling){
+        the_node = Heap_parent_P(the_node);
+    }
+    return the_node ? the_node->sibling : NULL;
+}
+
+
+static void Heap_reorder_P(Heap the_heap){
+    /* Take all the nodes apart and combine them again, after the
+       ordering of the heap changed.
+
+       The nodes are first strung into a single sibling list: the walk
+       keeps a list of the nodes still to visit, and replaces each node
+       it visits with the list of its children. Each child list is only
+       walked once, to find its end, so that's O(n), as is combining
+       the list afterwards.
+    */
+    HeapNode pending = the_heap->root;
+    HeapNode all = NULL;
+
+    while (pending){
+        HeapNode node = pending;
+        pending = node->sibling;
+
+        if (node->child){
+            HeapNode last = node->child;
+            while (last->sibling){
+                last = last->sibling;
+            }
+            last->sibling = pending;
+            pending = node->child;
         }
+        node->child = node->prev = NULL;
+        node->sibling = all;
+        all = node;
+    }
+    the_heap->root = Heap_combine_siblings_P(the_heap, all);
+}
 
-        bits_flipped>>=1;   // the rightmost bit in bits_flipped is the leftmost bit in node_position; drop it.
-        node_position = bits_flipped;
-    }
-
-
-    while (node_position > 1){  
-        temp = node_position & 1;    
-         
-        if (temp == 0){
-            node = Stack_make_item(current->left);
-            current = current->left;
-        }else{
-            node = Stack_make_item(current->right);
-            current = current->right;
-        };
-        node_position >>= 1;
-        Stack_push(way_down, node);
-    };
-    return way_down;    
+
+static void Heap_print_P(HeapNode root){
+    /* Print the heap below root in preorder */
+    for (HeapNode node = root; node; node = Heap_next_P(node, false)){
+        printf("%c\t", node->data);
+    }
 };
 
+/* ---------------------------------------------------------------- */
+/* ***************************** End Private ********************** */
 
 
-static void Heap_sift_up_P(Stack path_to_root, HeapNode current){
-    HeapNode parent = (HeapNode)Stack_pop(path_to_root); // Stack_pop() returns a void pointer to the stack top
-    while (1){
-        if (parent){
 
-            if (current->data < parent->data){
-                char temp = parent->data;
-                parent->data = current->data;
-                current->data = temp;
+uint32_t Heap_count(Heap the_heap){
+    return the_heap->count;
+};
+
 
-                current = parent;
-                parent = (HeapNode)Stack_pop(path_to_root);
-            }else{
-                break;
-            }
 
-        }
-        else{
-            break;
-        }
-   }
 
+void Heap_init(Heap *heap_ref){
+    /* Allocate memory for a Heap and initialize it with
+       the correct values
+    */
+    Heap newheap = malloc(sizeof(struct minheap));
+    
+    if (newheap){
+        newheap->root = NULL;
+        newheap->count = 0;
+        newheap->is_max = false;
+        newheap->blocks = newheap->first_block = NULL;
+        newheap->free_nodes = newheap->free_tail = NULL;
+    }
+
+    *heap_ref = newheap;
 };
 
 
-static HeapNode Heap_make_new_node_P(char the_value){
-    HeapNode newnode = malloc(sizeof(struct minheapnode));
-    if (newnode){
-        newnode->data = the_value;
-        newnode->left = newnode->right = NULL;
+
+HeapNode Heap_insert_node(Heap the_heap, char the_value){
+    /* Insert the_value into the_heap, in O(1), and return a handle
+       to its node, which can later be passed to Heap_delete_node().
+       The handle stays valid until the node is deleted (or popped).
+       Return NULL if memory runs out.
+    */
+    HeapNode newnode = Heap_make_new_node_P(the_heap, the_value);
+    if (!newnode){
+        return NULL;
     }
+    the_heap->root = Heap_link_P(the_heap, the_heap->root, newnode);
+    the_heap->count++;
     return newnode;
 }
 
+
 Heap Heap_insert(Heap the_heap, char the_value){
-    /* Insert a new node into the_heap such that the shape property 
-       of the heap is respected. 
-       The new node's key will be the_value.
-       The new heap is then returned (Heap is actually a typdef
-       for a pointer to a struct heap).
-
-       It calls Heap_find_path_to_node_P() to map a path from
-       root down to the free slot where the insertion is to occur.
-
-       The path is saved on a Stack data structure as a series of pointers 
-       -- a pointer for each node along the path, starting with root. 
-
-       A second stack is created, for use as explained below. 
-       After the path from root to the free slot is computed and
-       put on the stack, moving down the tree is done by popping
-       the top of the stack and following the returned pointer
-       until the parent of the free slot is reached. 
-       The insertion is done for the child pointer that's NULL,
-       going from the left one to the right one. 
-
-       As each pointer is popped off the stack, it's pushed onto
-       the second stack mentioned above. This essentially reverses
-       the array. The purpose of this is to remember the way back up
-       from the newly inserted node to root - which is needed in
-       the sift-up routine, and which is the inverse of the path
-       down from root. 
-
-       The Heap_sift_up_P() function is then called with this second
-       stack as an argument, to find the correct position of the node
-       in the tree, such that the heap property is maintained or
-       restored.
+    /* Insert a new node with the_value as its key into the_heap,
+       and return the heap.
+       The new node is simply linked with the root (see the notes
+       at the top), which is O(1).
     */
-   
     if (!the_heap){     // heap not initialized properly
         return NULL;
     }
+    Heap_insert_node(the_heap, the_value);
+    return the_heap;
+};
 
-    if (the_heap->count == 0){      // heap empty - no root. 
-        HeapNode newnode = Heap_make_new_node_P(the_value);
-        the_heap->root = newnode;
-        the_heap->count++;
-        return the_heap;
-    }
-    // declare and initialize a Stack type
-    Stack path_to_node; 
-    // compute the path from root to node (the next insertion spot)
-    path_to_node = Heap_find_path_to_node_P(the_heap, the_heap->count+1);  
-    // the new insertion spot is always n+1, where n is the number of nodes in the heap
 
-    // pop off the top - not needed. This is the actual current node - which is NULL. 
-    // we need the parent instead
-    Stack_pop(path_to_node); 
-    HeapNode parent = (HeapNode)Stack_peek(path_to_node);   // Stack_peek() returns a void pointer to the stack top
-    
-    // create new heap node
-    HeapNode newnode = Heap_make_new_node_P(the_value);
+char Heap_node_value(HeapNode the_node){
+    /* Return the value in the node a handle refers to */
+    return the_node->data;
+}
 
-    if (newnode){
-        if (parent->left == NULL){
-            parent->left = newnode;
-        }
-        else if (parent->right == NULL){
-            parent->right = newnode;
-        }
 
-        // sift up the new node
+char Heap_peek_root(Heap *the_heap){
+    /* Return the value at the root (the smallest one in a min-heap,
+       the largest one in a max-heap) without removing it.
+       It's up to the caller to make sure the heap isn't empty.
+    */
+    return (*the_heap)->root->data;
+}
 
-        Heap_sift_up_P(path_to_node, newnode);
-        
-        // the stack is no longer needed : deallocate it
-        Stack_destroy(&path_to_node);
-    };
-    the_heap->count++;
-    return the_heap;
-};
-    
 
-static void Heap_print_P(HeapNode root){
-    if (!root){
-        return;
-    }
-    Heap_print_P(root->left);
-    printf("%c\t", root->data);
-    Heap_print_P(root->right);
-};
+char Heap_pop_root(Heap the_heap){
+    /* Remove the root and return its value.
+       It's up to the caller to make sure the_heap
+       has been initialzied correctly and is not NULL
+       and that the_heap isn't empty. 
+       If either of the above isn't so, it will lead to a crash
+       or worse.
 
+       The children of the root are combined into the new heap
+       with the two-pass pairing; O(log n) amortized.
+    */
+    HeapNode old_root = the_heap->root;
+    char return_val = old_root->data;
 
-void Heap_print(Heap the_heap){
-    if (!the_heap){
-        return;
-    }
-    Heap_print_P(the_heap->root);    
-}
+    the_heap->root = Heap_combine_siblings_P(the_heap, old_root->child);
+    Heap_free_node_P(the_heap, old_root);
+    the_heap->count--;
+    return return_val;
+};
 
-void Heap_print_BF(Heap the_heap){
-    Queue q;
-    Queue_init(&q);
-    
-    QueueItem item = Queue_make_item(the_heap->root);
-    Queue_enqueue(q, item);
-    HeapNode node = Queue_dequeue(q);
-    QueueItem new;
-    while (node){
-        printf("%c-", node->data);
-        new = Queue_make_item(node->left);
-        Queue_enqueue(q, new);
-        new = Queue_make_item(node->right);
-        Queue_enqueue(q, new);
-
-        node = Queue_dequeue(q);
-    };
-    
-    Queue_destroy(&q);
 
-    };
-    
+char Heap_delete_node(Heap the_heap, HeapNode the_node){
+    /* Remove the node a handle refers to from the_heap, wherever it
+       is in it, and return its value. The handle is invalid afterwards.
 
+       The node is unlinked from its parent's list of children, its own
+       children are combined into a single heap, and that is linked back
+       with the rest; O(log n) amortized.
+    */
+    char return_val = the_node->data;
+    if (the_node == the_heap->root){
+        return Heap_pop_root(the_heap);
+    }
 
+    // unlink the_node and its subtree
+    if (the_node->prev->child == the_node){
+        the_node->prev->child = the_node->sibling;
+    }
+    else{
+        the_node->prev->sibling = the_node->sibling;
+    }
+    if (the_node->sibling){
+        the_node->sibling->prev = the_node->prev;
+    }
 
+    HeapNode subtree = Heap_combine_siblings_P(the_heap, the_node->child);
+    the_heap->root = Heap_link_P(the_heap, the_heap->root, subtree);
 
-static void Heap_sift_down_P(HeapNode the_node){
+    Heap_free_node_P(the_heap, the_node);
+    the_heap->count--;
+    return return_val;
+}
 
-    // sift down the value to the correct spot to maintain the heap property
-    uint8_t keep_sifting = 1;
 
-    while (keep_sifting){
-        // trying to access the -> left or ->right field of a NULL Heap will crash the
-        // system. So that needs to be checked against first
+bool Heap_delete(Heap *the_heap, char the_value, char *the_deleted){
+    /* Delete a node holding the_value from the heap, store its value
+       in *the_deleted (unless the_deleted is NULL) and return true.
+       If there's no such node, nothing is deleted and false is returned.
 
-        // case 1: both children are not NULL
-        if (the_node->left && the_node->right){
-            HeapNode smaller= (the_node->left->data < the_node->right->data) ? the_node->left : the_node->right; 
+       The node is searched for with a preorder walk that skips every
+       subtree whose root already comes after the_value in heap order
+       (by the heap property, the_value can't be below it).
+    */
+    Heap heap = *the_heap;
+    HeapNode node = heap->root;
 
-            if (smaller->data < the_node->data){
-                char temp = smaller->data;
-                smaller->data = the_node->data;
-                the_node->data = temp;
-                the_node = smaller;
-            }
-            else{
-                break;
+    while (node){
+        if (node->data == the_value){
+            char deleted = Heap_delete_node(heap, node);
+            if (the_deleted){
+                *the_deleted = deleted;
             }
+            return true;
         }
+        node = Heap_next_P(node, Heap_before_P(heap, the_value, node->data));
+    }
+    return false;
+}
 
-        // case 2: left child is not NULL
-        else if (the_node->left){
-            HeapNode smaller = (the_node->left->data < the_node->data) ? the_node->left : NULL; 
 
-            if (smaller){
-                char temp = smaller->data;
-                smaller->data = the_node->data;
-                the_node->data = temp;
-                the_node = smaller;
-            }
-            else{
-                break;
-            }
-        }
-        
-        // case 3: right child is not NULL
-        else if (the_node->right){
-            HeapNode smaller = (the_node->right->data < the_node->data) ? the_node->right: NULL; 
-
-            if (smaller){
-                char temp = smaller->data;
-                smaller->data = the_node->data;
-                the_node->data = temp;
-                the_node = smaller;
-            }
-            else{
-                break;
-            }
-        }
-        else{
-            break;
-        }
+void Heap_maxheapify(Heap *the_heap){
+    /* Turn the heap into a max-heap: the root is the largest value from
+       now on, and all the operations keep it that way. O(n).
+    */
+    if (!(*the_heap)->is_max){
+        (*the_heap)->is_max = true;
+        Heap_reorder_P(*the_heap);
     }
-};
-        
+}
 
 
+void Heap_minheapify(Heap *the_heap){
+    /* Turn the heap (back) into a min-heap. O(n) */
+    if ((*the_heap)->is_max){
+        (*the_heap)->is_max = false;
+        Heap_reorder_P(*the_heap);
+    }
+}
 
-char Heap_pop_root(Heap the_heap){
-    /* It's up to the caller to make sure the_heap
-       has been initialzied correctly and is not NULL
-       and that the_heap isn't empty. 
-       If either of the above isn't so, it will lead to a crash
-       or worse.
 
-    */
-    char return_val = the_heap->root->data;
+void Heap_meld(Heap the_heap, Heap *other_ref){
+    /* Move all the nodes of *other_ref into the_heap, then destroy
+       *other_ref and set it to NULL.
 
-    if (the_heap->count == 1){
-        free(the_heap->root);
-        the_heap->count--;
-        return return_val;
-    };
+       The two roots are linked, and the pool of *other_ref (which the
+       moved nodes live in) is handed over to the_heap, all in O(1).
+       If the two heaps are ordered differently, *other_ref is first
+       reordered to match, which is O(m).
+    */
+    Heap other = *other_ref;
+    if (other->is_max != the_heap->is_max){
+        other->is_max = the_heap->is_max;
+        Heap_reorder_P(other);
+    }
 
-    Stack path_to_last_node = Heap_find_path_to_node_P(the_heap, the_heap->count);
+    the_heap->root = Heap_link_P(the_heap, the_heap->root, other->root);
+    the_heap->count += other->count;
 
-    {
-    // replace root with the last node
-    HeapNode last_node = Stack_pop(path_to_last_node);
-    the_heap->root->data = last_node->data;
-    HeapNode parent = Stack_pop(path_to_last_node);
-    if (parent->left == last_node){
-        parent->left = NULL;
+    if (other->blocks){
+        other->first_block->next = the_heap->blocks;
+        the_heap->blocks = other->blocks;
+        if (!the_heap->first_block){
+            the_heap->first_block = other->first_block;
+        }
     }
-    else{
-        parent->right = NULL;
+    if (other->free_nodes){
+        other->free_tail->sibling = the_heap->free_nodes;
+        if (!the_heap->free_nodes){
+            the_heap->free_tail = other->free_tail;
+        }
+        the_heap->free_nodes = other->free_nodes;
     }
-    free(last_node);
-    } 
 
-    Stack_destroy(&path_to_last_node);
-    the_heap->count--;
+    free(other);
+    *other_ref = NULL;
+}
 
-    Heap_sift_down_P(the_heap->root);
-    return return_val;
-};
+
+void Heap_print(Heap the_heap){
+    if (!the_heap){
+        return;
+    }
+    Heap_print_P(the_heap->root);    
+}
 
 
+void Heap_print_BF(Heap the_heap){
+    /* Print the nodes breadth-first, level by level.
 
-void static Heap_destroy_P(HeapNode node){
-    if (!node){
+       Nothing is allocated: each level is printed by a preorder walk
+       of the levels above it (climbing back up with the parent links,
+       as Heap_next_P() does), so there's no queue of nodes to keep.
+       That's O(n * height) rather than O(n), which is fine for
+       printing a heap out.
+    */
+    if (!the_heap->count){
         return;
     }
-    Heap_destroy_P(node->left);
-    Heap_destroy_P(node->right);
-    free(node);
-    return;
-}
+    bool deeper = true;     // some node on the level being printed has children
+    for (uint32_t level = 0; deeper; level++){
+        deeper = false;
+        HeapNode node = the_heap->root;
+        uint32_t depth = 0;
+        while (node){
+            if (depth == level){
+                printf("%c-", node->data);
+                deeper = deeper || node->child;
+            }
+            else if (node->child){  // above the level: go down
+                node = node->child;
+                depth++;
+                continue;
+            }
+            // on to the next sibling, climbing up as far as needed
+            while (node && !node->sibling){
+                node = Heap_parent_P(node);
+                depth--;
+            }
+            node = node ? node->sibling : NULL;
+        }
+    }
+};
+
 
 void Heap_destroy(Heap *heap_ref){
+    /* Free the heap and all of its nodes, and set *heap_ref to NULL.
+       The nodes live in the pool's blocks, so it's the blocks that
+       are freed, without walking the tree.
+    */
     if (!(*heap_ref)){
         return;
     }
-    if (!(*heap_ref)->count){
-        free((*heap_ref));
-        *heap_ref = NULL; 
-        return;
+    struct heap_block *block = (*heap_ref)->blocks;
+    while (block){
+        struct heap_block *next = block->next;
+        free(block);
+        block = next;
     }
-    Heap_destroy_P((*heap_ref)->root); 
-
+    free((*heap_ref));
+    *heap_ref = NULL; 
 };
-
-/*
-void Heap_insert(Heap *the_heap, char the_value);
-char Heap_delete(Heap *the_heap, char the_value);
-char Heap_peek_root(Heap *the_heap);
-void Heap_maxheapify(Heap *the_heap);
-void Heap_minheapify(Heap *the_heap);
-void Heap_destroy(Heap **heap_ref);
-*/
-
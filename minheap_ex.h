@@ -7,24 +7,32 @@
  * This is an implementation of a min-heap. That is, each parent is smaller than both
  * of its child nodes, going back to root. This means that the root of the heap
  * has the smallest value.
+ * (Heap_maxheapify() turns it into a max-heap, and Heap_minheapify() back.)
  *
  * Note that a heap is only a partially-ordered data structure. That is to say,
  * aside from the heap property where the child nodes are smaller than the parent
  * (max-heap) or greater than it (min-heap), there's no particular order among
  * sibling nodes. For a sorted data structure, a BST is the way to go. 
  *
- * In this implementation the heap is an EXPLICIT data structure, being built 
- * as a binary tree structure, using pointers to link the heap elements together.
- * This is in contrast to the heap as an IMPLICIT data structure: that is to say,
- * heaps can and are often stored implicitly in an array, especially for use in
- * the heapsort algorithm, where they thus entail no additional overhead beyond
- * the constant space complexity of the array itself. 
+ * In this implementation the heap is an EXPLICIT data structure: the nodes are
+ * linked together with pointers, rather than stored implicitly in an array (see
+ * minheap_im.h for that). 
+ * Specifically, it's a PAIRING HEAP: a tree where each node can have any number of
+ * children, and which, unlike a binary heap, doesn't have to keep any particular
+ * shape. That's what makes it a good fit for pointers: 
+ *   - inserting a node and melding two heaps are O(1),
+ *   - popping the root is O(log n) amortized,
+ *   - any node can be deleted through the handle Heap_insert_node() returns for it,
+ *     in O(log n) amortized.
+ * Nodes are allocated from a pool kept by each heap, so inserting doesn't usually
+ * call malloc(), and deleting never calls free().
  *
  * ******************************************************************************** */
 
 
 
 /* ******* Includes ****** */
+#include <stdbool.h>
 #include <stdint.h>
 
 
@@ -42,14 +50,19 @@ typedef struct minheapnode *HeapNode;
 void Heap_init(Heap *heap_ref);
 uint32_t Heap_count(Heap the_heap);
 Heap Heap_insert(Heap the_heap, char the_value);
-char Heap_delete(Heap *the_heap, char the_value);
+bool Heap_delete(Heap *the_heap, char the_value, char *the_deleted);   // false if the_value isn't in the heap
 char Heap_pop_root(Heap the_heap);
 char Heap_peek_root(Heap *the_heap);
 void Heap_maxheapify(Heap *the_heap);
 void Heap_minheapify(Heap *the_heap);
 void Heap_destroy(Heap *heap_ref);
-void Heap_print(Heap the_heap);   // traverse the heap in order and print out the value of each node to stdout
-void Heap_print_BF(Heap the_heap);   // traverse the heap in order and print out the value of each node to stdout
+void Heap_print(Heap the_heap);   // traverse the heap and print out the value of each node to stdout
+void Heap_print_BF(Heap the_heap);   // traverse the heap breadth-first and print out the value of each node to stdout
+
+HeapNode Heap_insert_node(Heap the_heap, char the_value);    // insert, returning a handle to the new node
+char Heap_node_value(HeapNode the_node);
+char Heap_delete_node(Heap the_heap, HeapNode the_node);    // delete the node a handle refers to; the handle is then invalid
+void Heap_meld(Heap the_heap, Heap *other_ref);     // move all the nodes of *other_ref into the_heap, and destroy *other_ref
 
 
 #endif
@@ -1,12 +1,49 @@
 #include "minheap_im.h"
+#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
+
+/* ************************* Implementation notes ************************** */
+/*
+   The heap is stored in an array, root first. With an arity of d, the
+   children of the node at index i are at d*i+1 ... d*i+d, and its parent
+   is at (i-1)/d. Arity 2 is the usual binary heap.
+
+   A wider heap is shallower (log_d n levels instead of log_2 n), so a
+   pop sifts down through fewer levels, each of which is a cache miss
+   on a big heap. In exchange, each level has to find the first of d
+   children instead of 2. That's cheap, as long as the d children come
+   in as few cache lines as possible: they're contiguous, and the array
+   is allocated so that each group of siblings starts on a multiple of
+   d entries. An entry is 16 bytes, so a group of 4 fills exactly one
+   64-byte cache line, and a group of 8 two. Since the first group starts
+   at index 1, that's done by pointing the array d-1 entries past the
+   start of a 64-byte-aligned block: index 1 is then at offset d entries,
+   and every later group at a multiple of d entries.
+
+   Entries are compared by priority, inline, unless the heap has a
+   comparator. Every comparison checks which: a branch that always goes
+   the same way for a given heap, which costs next to nothing. With no
+   comparator, the first child is found with a loop of conditional
+   selects rather than branches (compilers turn it into cmov
+   instructions), since which child comes first is unpredictable.
+
+   The array grows by doubling when it's full, and halves when it's
+   down to a quarter full, but never below the capacity hint.
+*/
+
+#define HEAP_CACHE_LINE 64
 
 
 
 struct min_heap_implicit{
     int32_t size;
+    int32_t min_size;   // the capacity hint: the array isn't shrunk below it
     int32_t last_index;
-    char *array;    // array that needs to be regrown
+    uint8_t arity;
+    HeapCompare compare;    // NULL: by priority
+    HeapEntry *block;   // the allocated memory, aligned to HEAP_CACHE_LINE
+    HeapEntry *array;   // arity-1 entries into block
 };
 
 
@@ -14,162 +51,343 @@ struct min_heap_implicit{
 /* ********************************************************************************* */
 /* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
 
-static void Heap_sift_up(char the_array[], int32_t current_index){
-    /* Sift the value at current index up in the array */
-    char temp;
-    int32_t parent = (current_index-1)>>1;  // parent is (current-1) / 2 (floor division)
+static inline bool Heap_before(const HeapEntry *entry1, const HeapEntry *entry2, HeapCompare compare){
+    /* True if entry1 belongs above entry2 */
+    return compare ? compare(entry1, entry2) < 0 : entry1->priority < entry2->priority;
+}
+
+
+static void Heap_allocate(Heap the_heap, int32_t new_size){
+    /* (Re)allocate the array with room for new_size entries, keeping
+       the sibling groups aligned (see the notes at the top).
+       The entries in the heap are carried over.
+    */
+    size_t bytes = ((size_t)new_size + the_heap->arity - 1) * sizeof(HeapEntry);
+    bytes = (bytes + HEAP_CACHE_LINE - 1) / HEAP_CACHE_LINE * HEAP_CACHE_LINE;  // aligned_alloc() wants a multiple of the alignment
+
+    HeapEntry *block = aligned_alloc(HEAP_CACHE_LINE, bytes);
+    if (!block){
+        exit(EXIT_FAILURE);
+    }
+    HeapEntry *array = block + the_heap->arity - 1;
+
+    if (the_heap->block){
+        memcpy(array, the_heap->array, sizeof(HeapEntry) * (size_t)(the_heap->last_index + 1));
+        free(the_heap->block);
+    }
+    the_heap->block = block;
+    the_heap->array = array;
+    the_heap->size = new_size;
+}
 
-    while( parent >= 0){
-        if(the_array[parent] > the_array[current_index]){
-           temp = the_array[current_index];
-           the_array[current_index] = the_array[parent]; 
-           the_array[parent] = temp;
 
-           current_index = parent;
-           parent = (current_index-1)>>1;
+static inline int32_t Heap_min_child(const HeapEntry the_array[], int32_t first_child, int32_t children, HeapCompare compare){
+    /* Return the index of the first (in heap order) of the children
+       (at most arity of them) starting at first_child. Branch-free when
+       comparing by priority: every comparison is a conditional select.
+    */
+    int32_t smallest = first_child;
+    if (!compare){
+        int64_t smallest_priority = the_array[first_child].priority;
+        for (int32_t i = 1; i < children; i++){
+            int64_t priority = the_array[first_child + i].priority;
+            smallest = (priority < smallest_priority) ? first_child + i : smallest;
+            smallest_priority = (priority < smallest_priority) ? priority : smallest_priority;
         }
-        else{   // don't sift if parent !< current
+        return smallest;
+    }
+    for (int32_t i = 1; i < children; i++){
+        smallest = (compare(&the_array[first_child + i], &the_array[smallest]) < 0) ? first_child + i : smallest;
+    }
+    return smallest;
+}
+
+
+static void Heap_sift_up(HeapEntry the_array[], int32_t current_index, uint8_t arity, HeapCompare compare){
+    /* Sift the entry at current index up in the array */
+    HeapEntry entry = the_array[current_index];
+
+    while (current_index > 0){
+        int32_t parent = (current_index - 1) / arity;
+        if (Heap_before(&entry, &the_array[parent], compare)){
+            the_array[current_index] = the_array[parent];   // move the parent down into the hole
+            current_index = parent;
+        }
+        else{   // don't sift if current !< parent
             break;
         }
-
-    } 
+    }
+    the_array[current_index] = entry;
 };
 
 
 
-static void Heap_sift_down(char the_array[], int32_t last_index){
-    /* Sift down the root to its correct position in the_array so
-       as to repair and uphold the heap property (children > parent).
+static void Heap_sift_down(HeapEntry the_array[], int32_t current, int32_t last_index, uint8_t arity, HeapCompare compare){
+    /* Sift down the entry at current to its correct position in the_array
+       so as to repair and uphold the heap property (children > parent).
+       A node can have fewer than arity children (only at the end of the
+       array): it's still compared against the ones it has.
     */
-    int32_t current = 0;
-    int32_t left_child = 1 + (current<<1);
-    int32_t right_child = 2 + (current<<1);
-   
-    char temp;
-    while(left_child <= last_index && right_child <= last_index){
-        int32_t smaller = (the_array[left_child] < the_array[right_child]) ? left_child : right_child;
-        if (the_array[smaller] < the_array[current]){
-            temp = the_array[smaller];
-            the_array[smaller] = the_array[current];
-            the_array[current] = temp;
-        
+    HeapEntry entry = the_array[current];
+
+    while (1){
+        int32_t first_child = arity * current + 1;
+        if (first_child > last_index){
+            break;
+        }
+        int32_t children = last_index - first_child + 1;
+        if (children > arity){
+            children = arity;
+        }
+
+        int32_t smaller = Heap_min_child(the_array, first_child, children, compare);
+        if (Heap_before(&the_array[smaller], &entry, compare)){
+            the_array[current] = the_array[smaller];    // move the child up into the hole
             current = smaller;
-            left_child = 1 + (current<<1);
-            right_child = 2 + (current<<1);
         }
         else{
             break;
         }
-            
     }
+    the_array[current] = entry;
+}
+ 
+
+
+static void Heap_heapify(HeapEntry the_array[], int32_t last_index, uint8_t arity, HeapCompare compare){
+    /* Turn the_array[0..last_index] into a heap in place, bottom-up
+       (Floyd's method): every node that has children is sifted down,
+       starting from the last one and working back to the root.
+       Half of the nodes are leaves and are never touched, a quarter
+       (for a binary heap) sift down at most one level, and so on,
+       which adds up to O(n), as opposed to O(n log n) for n inserts.
+    */
+    if (last_index < 1){
+        return;
+    }
+    for (int32_t i = (last_index - 1) / arity; i >= 0; i--){
+        Heap_sift_down(the_array, i, last_index, arity, compare);
+    }
+}
+
+
+static void Heap_shrink_to_fit(Heap the_heap){
+    /* Halve the array for as long as Heap_pop() would, in a single reallocation */
+    int32_t new_size = the_heap->size;
+    while (new_size / 2 >= the_heap->min_size && the_heap->last_index + 1 < new_size / 4){
+        new_size /= 2;
+    }
+    if (new_size != the_heap->size){
+        Heap_allocate(the_heap, new_size);
+    }
+}
+
+
+static HeapEntry Heap_remove_root(Heap the_heap){
+    /* Remove and return the root, moving the last entry into its place
+       and sifting it down. The heap mustn't be empty.
+    */
+    HeapEntry root = the_heap->array[0];
+    the_heap->array[0] = the_heap->array[the_heap->last_index];
+    the_heap->last_index--;
+    if (the_heap->last_index > 0){
+        Heap_sift_down(the_heap->array, 0, the_heap->last_index, the_heap->arity, the_heap->compare);
+    }
+    return root;
 }
  
 /* ------------------------------- END PRIVATE ------------------------------------- */
 /* ********************************************************************************* */
 
 
-void Heap_init(Heap *heap_ref, int32_t initial_size){
+void Heap_init_arity(Heap *heap_ref, int32_t capacity_hint, uint8_t arity, HeapCompare compare){
+    /* Allocate an empty heap in which each node has up to arity
+       children, with room for capacity_hint entries. arity must be
+       2, 4 or 8; any other value gives a binary heap. compare orders
+       the entries; if it's NULL, they're ordered by priority.
+    */
+    if (arity != 2 && arity != 4 && arity != 8){
+        arity = 2;
+    }
+    if (capacity_hint < 1){
+        capacity_hint = 1;
+    }
+
     // allocate memory for a min_heap_implicit struct
     Heap new_min_heap = malloc(sizeof(struct min_heap_implicit));
-    char *new_array= malloc(sizeof(char) * initial_size);
-    if (!(new_min_heap && new_array)){
+    if (!new_min_heap){
         exit(EXIT_FAILURE);
     }
     
-    new_min_heap->array = new_array;
-    
+    new_min_heap->arity = arity;
+    new_min_heap->compare = compare;
+    new_min_heap->block = NULL;
     new_min_heap->last_index = -1;
-    new_min_heap->size = initial_size;
-    new_array[0] = '\0';   // in an array of n items, n+1 will be Nul. This has to be maintained
+    new_min_heap->min_size = capacity_hint;
+    Heap_allocate(new_min_heap, capacity_hint);
 
     *heap_ref = new_min_heap;
 }
 
+
+void Heap_init(Heap *heap_ref, int32_t capacity_hint, HeapCompare compare){
+    /* Allocate an empty binary heap */
+    Heap_init_arity(heap_ref, capacity_hint, 2, compare);
+}
+
    
     
 
 
-void Heap_insert(Heap the_heap, char the_value){
-    /* Insert a new node into the heap */
-    the_heap->array[++the_heap->last_index] = the_value; 
-    the_heap->array[the_heap->last_index+1] = '\0';
-
-    if(the_heap->last_index+3 > the_heap->size){
+void Heap_insert(Heap the_heap, int64_t priority, void *payload){
+    /* Insert a new entry into the heap */
+    if (the_heap->last_index + 1 == the_heap->size){
         // double the size of the array
-        char *temp = realloc(the_heap->array, sizeof(char) * the_heap->size*2);
-        
-        if (!temp){
-            exit(EXIT_FAILURE);
-        }
-
-        the_heap->array = temp;
-        the_heap->size *= 2;
+        Heap_allocate(the_heap, the_heap->size * 2);
     }
+    the_heap->array[++the_heap->last_index] = (HeapEntry){.priority = priority, .payload = payload};
+
     // if last_index is only 0, the heap only has root so far : no sift-up necessary
     if (the_heap->last_index > 0){
-        Heap_sift_up(the_heap->array, the_heap->last_index);
+        Heap_sift_up(the_heap->array, the_heap->last_index, the_heap->arity, the_heap->compare);
     }
 };
     
 
 
-char Heap_pop(Heap the_heap){
+HeapEntry Heap_pop(Heap the_heap){
     /* Remove and return the root of the_heap,
        then repair the heap_property.
     */
-    char val = the_heap->array[0];  // get the root
-    
-    // reestablish the heap property, broken by having removed the root
-    // put the last element in root's place
-    the_heap->array[0] = the_heap->array[the_heap->last_index];
-    the_heap->array[the_heap->last_index] = '\0';
-    the_heap->last_index--;     // one less element in the heap now
+    if (the_heap->last_index < 0){
+        return (HeapEntry){.priority = 0, .payload = NULL};
+    }
+    HeapEntry root = Heap_remove_root(the_heap);
 
     // check if the array needs shrinking
-    if (the_heap->last_index < (the_heap->size/2)-2){
+    if (the_heap->size / 2 >= the_heap->min_size && the_heap->last_index + 1 < the_heap->size / 4){
         // halve the size of the array
-        the_heap->size /= 2;
-        char *temp = realloc(the_heap->array, sizeof(char) * the_heap->size);
-            
-        if (!temp){
-            exit(EXIT_FAILURE);
-        }
-    
-        the_heap->array = temp;
+        Heap_allocate(the_heap, the_heap->size / 2);
     }
+    return root;
+}
 
-    // sift down the new root to the correct place in the array
-    if (the_heap->last_index < 2){  
-    // if there's only root and nothing else, not necessary
-        if(the_heap->last_index == 0){
-            return val;
-        }
-        else{ // root only has one child. Check if it needs swapping
-            if (the_heap->array[0] > the_heap->array[1]){
-                char temp = the_heap->array[1];
-                the_heap->array[1] = the_heap->array[0];
-                the_heap->array[0] = temp;
-            }
-            return val;
-        }
+
+int32_t Heap_count(Heap the_heap){
+    /* Return the number of entries in the heap */
+    return the_heap->last_index + 1;
+}
+
+
+HeapEntry Heap_peek(Heap the_heap){
+    /* Return the root (the first entry) without removing it */
+    if (the_heap->last_index < 0){
+        return (HeapEntry){.priority = 0, .payload = NULL};
     }
-                
-    Heap_sift_down(the_heap->array, the_heap->last_index);
-    return val;
+    return the_heap->array[0];
 }
 
 
 void Heap_destroy(Heap *heap_ref){
-    /* Free all meory assocaited with the heap
-       and set *heap_ref to NULL.
+    /* Free all memory associated with the heap (but not what
+       the payloads point to) and set *heap_ref to NULL.
     */
     if (!(*heap_ref)){
         return;
     }
 
-    free((*heap_ref)->array);
+    free((*heap_ref)->block);
     free(*heap_ref);
     *heap_ref = NULL;
 }
 
 
+
+void Heap_from_array(Heap *heap_ref, const HeapEntry the_array[], int32_t count, uint8_t arity, HeapCompare compare){
+    /* Make a new heap (of the given arity and order; see
+       Heap_init_arity()) holding the count entries in the_array,
+       in O(n): they're copied in as they are, with a single
+       allocation, and then heapified bottom-up, rather than
+       inserted one by one.
+    */
+    Heap_init_arity(heap_ref, count, arity, compare);
+    Heap new_heap = *heap_ref;
+
+    memcpy(new_heap->array, the_array, sizeof(HeapEntry) * (size_t)count);
+    new_heap->last_index = count - 1;
+    Heap_heapify(new_heap->array, new_heap->last_index, new_heap->arity, compare);
+}
+
+
+void Heap_sort(HeapEntry the_array[], int32_t count, HeapCompare compare){
+    /* Sort the count entries in the_array in ascending order (by
+       priority, or by compare if it's not NULL), in place, in
+       O(n log n) and without allocating anything (heapsort).
+
+       The array is heapified into a min-heap, then the root is
+       repeatedly swapped with the last entry of the shrinking heap and
+       sifted down: that puts the entries at the end of the array from
+       the smallest one back, i.e. in descending order, which is then
+       reversed.
+    */
+    Heap_heapify(the_array, count - 1, 2, compare);
+
+    for (int32_t last = count - 1; last > 0; last--){
+        HeapEntry temp = the_array[0];
+        the_array[0] = the_array[last];
+        the_array[last] = temp;
+        Heap_sift_down(the_array, 0, last - 1, 2, compare);
+    }
+
+    for (int32_t i = 0, j = count - 1; i < j; i++, j--){
+        HeapEntry temp = the_array[i];
+        the_array[i] = the_array[j];
+        the_array[j] = temp;
+    }
+}
+
+
+HeapEntry Heap_pushpop(Heap the_heap, int64_t priority, void *payload){
+    /* Insert an entry, then pop the root, and return it; that is,
+       return the first of the new entry and the ones in the heap.
+       This takes a single sift-down (or none, if the new entry
+       comes before the root), rather than a sift-up and a sift-down.
+       The heap may be empty.
+    */
+    HeapEntry entry = {.priority = priority, .payload = payload};
+    if (the_heap->last_index < 0 || !Heap_before(&the_heap->array[0], &entry, the_heap->compare)){
+        return entry;   // it would go in at the root and straight back out
+    }
+    HeapEntry root = the_heap->array[0];
+    the_heap->array[0] = entry;
+    Heap_sift_down(the_heap->array, 0, the_heap->last_index, the_heap->arity, the_heap->compare);
+    return root;
+}
+
+
+HeapEntry Heap_replace(Heap the_heap, int64_t priority, void *payload){
+    /* Pop the root, then insert an entry, and return the popped root.
+       Unlike Heap_pushpop(), the returned entry may come after the
+       new one. This too takes a single sift-down.
+       It's up to the caller to make sure the heap isn't empty.
+    */
+    HeapEntry root = the_heap->array[0];
+    the_heap->array[0] = (HeapEntry){.priority = priority, .payload = payload};
+    Heap_sift_down(the_heap->array, 0, the_heap->last_index, the_heap->arity, the_heap->compare);
+    return root;
+}
+
+
+int32_t Heap_pop_n(Heap the_heap, HeapEntry out[], int32_t how_many){
+    /* Pop up to how_many entries into out, in order, and return how
+       many were popped (fewer than how_many if the heap runs out).
+       The array is shrunk, if need be, once at the end rather than
+       after every pop.
+    */
+    int32_t popped = 0;
+    while (popped < how_many && the_heap->last_index >= 0){
+        out[popped++] = Heap_remove_root(the_heap);
+    }
+    Heap_shrink_to_fit(the_heap);
+    return popped;
+}
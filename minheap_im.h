@@ -11,14 +11,49 @@
 /* ------------------ Implicit implementation of a min heap -------------- */
 /* *********************************************************************** */
 
+/* A priority queue of entries, each a 64-bit priority and a payload
+   pointer (to whatever the entry stands for; the heap never touches
+   what it points to). The entry that comes first is at the root.
+
+   By default, entries are ordered by priority, smallest first, which
+   is compared inline. A comparator can be passed to Heap_init() instead,
+   for any other order (largest first, ties broken by payload ...);
+   it's given two entries, and returns <0, 0 or >0, like qsort()'s.
+
+   The heap is binary by default. Heap_init_arity() makes a d-ary one,
+   where each node has up to 4 or 8 children: it's shallower, so a pop
+   touches fewer levels (and cache lines), for a few more comparisons
+   per level. Each group of siblings is kept within whole cache lines.
+
+   Peeking at or popping from an empty heap returns an entry with a
+   priority of 0 and a NULL payload.
+*/
+
 typedef struct min_heap_implicit *Heap;
 
+typedef struct{
+    int64_t priority;
+    void *payload;
+} HeapEntry;
 
-void Heap_init(Heap *heap_ref, int32_t initial_size);
-void Heap_insert(Heap the_heap, char the_value);
-char Heap_pop(Heap the_heap);
+typedef int (*HeapCompare)(const HeapEntry *entry1, const HeapEntry *entry2);
+
+
+// capacity_hint: how many entries to make room for up front (the array never shrinks below it); compare can be NULL
+void Heap_init(Heap *heap_ref, int32_t capacity_hint, HeapCompare compare);
+void Heap_init_arity(Heap *heap_ref, int32_t capacity_hint, uint8_t arity, HeapCompare compare);   // arity: 2, 4 or 8
+void Heap_insert(Heap the_heap, int64_t priority, void *payload);
+HeapEntry Heap_pop(Heap the_heap);
+HeapEntry Heap_peek(Heap the_heap);
+int32_t Heap_count(Heap the_heap);
 void Heap_destroy(Heap *heap_ref);
 
+void Heap_from_array(Heap *heap_ref, const HeapEntry the_array[], int32_t count, uint8_t arity, HeapCompare compare);  // O(n) bottom-up build
+void Heap_sort(HeapEntry the_array[], int32_t count, HeapCompare compare);    // in-place heapsort, ascending
+HeapEntry Heap_pushpop(Heap the_heap, int64_t priority, void *payload);   // insert, then pop: a single sift
+HeapEntry Heap_replace(Heap the_heap, int64_t priority, void *payload);   // pop, then insert: a single sift (the heap mustn't be empty)
+int32_t Heap_pop_n(Heap the_heap, HeapEntry out[], int32_t how_many);   // pop up to how_many entries into out, in order
+
 
 
 
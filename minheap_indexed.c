@@ -0,0 +1,307 @@
+#include "minheap_indexed.h"
+#include <stdlib.h>
+
+
+
+#define IPQ_ABSENT IPQ_MAX_HANDLES     // position of a handle that isn't in the queue; never a valid handle
+
+
+struct ipq_entry{
+    int64_t priority;
+    uint32_t handle;
+};
+
+struct indexed_min_pq{
+    struct ipq_entry *entries;  // the heap: entries[0] is the root, entries[i]'s children are at 2i+1 and 2i+2
+    uint32_t count;             // number of entries in the heap
+    uint32_t capacity;          // number of entries allocated
+    uint32_t *positions;        // positions[handle]: index of handle's entry in entries, or IPQ_ABSENT
+    uint32_t handles;           // number of handles positions has room for
+};
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static void IPQ_place(IPQ the_pq, uint32_t index, struct ipq_entry entry){
+    /* Store entry at index, and record its new position */
+    the_pq->entries[index] = entry;
+    the_pq->positions[entry.handle] = index;
+}
+
+
+static void IPQ_sift_up(IPQ the_pq, uint32_t index){
+    /* Sift the entry at index up towards the root.
+       Rather than swapping at every level, the entry is held aside
+       and its parents are moved down into the hole until its place
+       is found; every entry moved gets its position updated.
+    */
+    struct ipq_entry entry = the_pq->entries[index];
+    while (index > 0){
+        uint32_t parent = (index - 1) >> 1;
+        if (the_pq->entries[parent].priority <= entry.priority){
+            break;
+        }
+        IPQ_place(the_pq, index, the_pq->entries[parent]);
+        index = parent;
+    }
+    IPQ_place(the_pq, index, entry);
+}
+
+
+static void IPQ_sift_down(IPQ the_pq, uint32_t index){
+    /* Sift the entry at index down, the same way IPQ_sift_up() sifts up.
+       A node with only a left child is handled too.
+    */
+    struct ipq_entry entry = the_pq->entries[index];
+    while (1){
+        uint32_t child = 2 * index + 1;
+        if (child >= the_pq->count){
+            break;
+        }
+        if (child + 1 < the_pq->count && the_pq->entries[child+1].priority < the_pq->entries[child].priority){
+            child++;
+        }
+        if (entry.priority <= the_pq->entries[child].priority){
+            break;
+        }
+        IPQ_place(the_pq, index, the_pq->entries[child]);
+        index = child;
+    }
+    IPQ_place(the_pq, index, entry);
+}
+
+
+static void IPQ_reserve_handle(IPQ the_pq, uint32_t handle){
+    /* Make sure the position map has room for handle, which must be
+       below IPQ_MAX_HANDLES: the map then never needs more than
+       IPQ_MAX_HANDLES entries, which a uint32_t can count.
+    */
+    if (handle < the_pq->handles){
+        return;
+    }
+    uint32_t handles = the_pq->handles ? the_pq->handles : 16;
+    while (handles <= handle){
+        handles = (handles > IPQ_MAX_HANDLES / 2) ? IPQ_MAX_HANDLES : handles * 2;
+    }
+    uint32_t *temp = realloc(the_pq->positions, sizeof(uint32_t) * (size_t)handles);
+    if (!temp){
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t i = the_pq->handles; i < handles; i++){
+        temp[i] = IPQ_ABSENT;
+    }
+    the_pq->positions = temp;
+    the_pq->handles = handles;
+}
+
+
+static void IPQ_remove_at(IPQ the_pq, uint32_t index){
+    /* Remove the entry at index: the last entry takes its place, and
+       is then sifted up or down, whichever way it has to go.
+    */
+    the_pq->positions[the_pq->entries[index].handle] = IPQ_ABSENT;
+    the_pq->count--;
+    if (index == the_pq->count){    // it was the last entry
+        return;
+    }
+    IPQ_place(the_pq, index, the_pq->entries[the_pq->count]);
+    if (index > 0 && the_pq->entries[index].priority < the_pq->entries[(index - 1) >> 1].priority){
+        IPQ_sift_up(the_pq, index);
+    }
+    else{
+        IPQ_sift_down(the_pq, index);
+    }
+}
+ 
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+void IPQ_init(IPQ *pq_ref, uint32_t handles_hint){
+    /* Allocate an empty queue, with room for handles up to handles_hint-1
+       (more are made room for as needed). A hint above IPQ_MAX_HANDLES
+       can't be given, since it's a uint32_t: every handle it makes
+       room for is a valid one.
+    */
+    IPQ new_pq = malloc(sizeof(struct indexed_min_pq));
+    if (!new_pq){
+        exit(EXIT_FAILURE);
+    }
+    new_pq->count = 0;
+    new_pq->capacity = 16;
+    new_pq->entries = malloc(sizeof(struct ipq_entry) * new_pq->capacity);
+    new_pq->positions = NULL;
+    new_pq->handles = 0;
+    if (!new_pq->entries){
+        exit(EXIT_FAILURE);
+    }
+    if (handles_hint){
+        IPQ_reserve_handle(new_pq, handles_hint - 1);
+    }
+
+    *pq_ref = new_pq;
+}
+
+
+uint32_t IPQ_count(IPQ the_pq){
+    return the_pq->count;
+}
+
+
+bool IPQ_is_empty(IPQ the_pq){
+    return the_pq->count == 0;
+}
+
+
+bool IPQ_contains(IPQ the_pq, uint32_t handle){
+    /* Return true if handle is in the queue. O(1)
+       Handles of IPQ_MAX_HANDLES and up are never in it: they're
+       beyond the position map, which holds at most IPQ_MAX_HANDLES.
+    */
+    return handle < the_pq->handles && the_pq->positions[handle] != IPQ_ABSENT;
+}
+
+
+bool IPQ_insert(IPQ the_pq, uint32_t handle, int64_t priority){
+    /* Insert handle with the given priority. O(log n).
+       Return false, changing nothing, if handle is already in the queue
+       (use one of the *_key functions to change its priority), or if
+       handle isn't below IPQ_MAX_HANDLES.
+    */
+    if (handle >= IPQ_MAX_HANDLES || IPQ_contains(the_pq, handle)){
+        return false;
+    }
+    IPQ_reserve_handle(the_pq, handle);
+
+    if (the_pq->count == the_pq->capacity){
+        // double the size of the array; there are never more entries than handles, so IPQ_MAX_HANDLES is enough
+        uint32_t capacity = (the_pq->capacity > IPQ_MAX_HANDLES / 2) ? IPQ_MAX_HANDLES : the_pq->capacity * 2;
+        struct ipq_entry *temp = realloc(the_pq->entries, sizeof(struct ipq_entry) * (size_t)capacity);
+        if (!temp){
+            exit(EXIT_FAILURE);
+        }
+        the_pq->entries = temp;
+        the_pq->capacity = capacity;
+    }
+
+    struct ipq_entry entry = {priority, handle};
+    IPQ_place(the_pq, the_pq->count++, entry);
+    IPQ_sift_up(the_pq, the_pq->count - 1);
+    return true;
+}
+
+
+int64_t IPQ_priority_of(IPQ the_pq, uint32_t handle){
+    /* Return the priority of handle, or 0 if it isn't in the queue. O(1) */
+    if (!IPQ_contains(the_pq, handle)){
+        return 0;
+    }
+    return the_pq->entries[the_pq->positions[handle]].priority;
+}
+
+
+bool IPQ_decrease_key(IPQ the_pq, uint32_t handle, int64_t priority){
+    /* Lower the priority of handle (moving it towards the root). O(log n).
+       Return false, changing nothing, if handle isn't in the queue or
+       priority isn't smaller than its current one.
+    */
+    if (!IPQ_contains(the_pq, handle)){
+        return false;
+    }
+    uint32_t index = the_pq->positions[handle];
+    if (priority >= the_pq->entries[index].priority){
+        return false;
+    }
+    the_pq->entries[index].priority = priority;
+    IPQ_sift_up(the_pq, index);
+    return true;
+}
+
+
+bool IPQ_increase_key(IPQ the_pq, uint32_t handle, int64_t priority){
+    /* Raise the priority of handle (moving it away from the root). O(log n).
+       Return false, changing nothing, if handle isn't in the queue or
+       priority isn't larger than its current one.
+    */
+    if (!IPQ_contains(the_pq, handle)){
+        return false;
+    }
+    uint32_t index = the_pq->positions[handle];
+    if (priority <= the_pq->entries[index].priority){
+        return false;
+    }
+    the_pq->entries[index].priority = priority;
+    IPQ_sift_down(the_pq, index);
+    return true;
+}
+
+
+bool IPQ_change_key(IPQ the_pq, uint32_t handle, int64_t priority){
+    /* Set the priority of handle, whether it goes up or down. O(log n).
+       Return false if handle isn't in the queue.
+    */
+    if (!IPQ_contains(the_pq, handle)){
+        return false;
+    }
+    uint32_t index = the_pq->positions[handle];
+    int64_t old_priority = the_pq->entries[index].priority;
+    the_pq->entries[index].priority = priority;
+    if (priority < old_priority){
+        IPQ_sift_up(the_pq, index);
+    }
+    else{
+        IPQ_sift_down(the_pq, index);
+    }
+    return true;
+}
+
+
+bool IPQ_remove(IPQ the_pq, uint32_t handle){
+    /* Remove handle from the queue, wherever it is in the heap. O(log n).
+       Return false if it isn't in the queue.
+    */
+    if (!IPQ_contains(the_pq, handle)){
+        return false;
+    }
+    IPQ_remove_at(the_pq, the_pq->positions[handle]);
+    return true;
+}
+
+
+uint32_t IPQ_peek(IPQ the_pq, int64_t *priority){
+    /* Return the handle with the smallest priority, and store that
+       priority in *priority (unless it's NULL), without removing it.
+       It's up to the caller to make sure the queue isn't empty.
+    */
+    if (priority){
+        *priority = the_pq->entries[0].priority;
+    }
+    return the_pq->entries[0].handle;
+}
+
+
+uint32_t IPQ_pop(IPQ the_pq, int64_t *priority){
+    /* Remove and return the handle with the smallest priority, storing
+       that priority in *priority (unless it's NULL). O(log n).
+       It's up to the caller to make sure the queue isn't empty.
+    */
+    uint32_t handle = IPQ_peek(the_pq, priority);
+    IPQ_remove_at(the_pq, 0);
+    return handle;
+}
+
+
+void IPQ_destroy(IPQ *pq_ref){
+    /* Free all memory associated with the queue
+       and set *pq_ref to NULL.
+    */
+    if (!(*pq_ref)){
+        return;
+    }
+    free((*pq_ref)->entries);
+    free((*pq_ref)->positions);
+    free(*pq_ref);
+    *pq_ref = NULL;
+}
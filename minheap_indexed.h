@@ -0,0 +1,60 @@
+#ifndef MINHEAP_INDEXED_H
+#define MINHEAP_INDEXED_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+
+
+/* *********************************************************************** */
+/* ------------------ Indexed min priority queue ------------------------- */
+/* *********************************************************************** */
+/*
+ * An implicit (array-based) min-heap, like the one in minheap_im.h, of
+ * (handle, priority) entries, where the handle is a small integer that
+ * identifies an item (a vertex of a graph, a task id ...) and the
+ * priority orders the items: the item with the smallest priority is at
+ * the root.
+ *
+ * Alongside the heap the queue keeps a position map: for every handle,
+ * where its entry currently is in the heap array. That makes it possible
+ * to look an item up by its handle in O(1), and so to change its priority
+ * or remove it in O(log n), rather than pushing a duplicate entry with
+ * the new priority and skipping the stale one when it's popped.
+ *
+ * A handle can be in the queue at most once. Handles index the position
+ * map directly, so they should be dense (0 to n-1, as graph vertices
+ * usually are): the map grows to the largest handle inserted.
+ *
+ * Handles go from 0 to IPQ_MAX_HANDLES-1. UINT32_MAX itself is used
+ * inside the queue to mark handles that aren't in it, so IPQ_insert()
+ * rejects it (returning false), and no other function finds it there.
+ */
+
+#define IPQ_MAX_HANDLES UINT32_MAX     // handles must be below this
+
+typedef struct indexed_min_pq *IPQ;
+
+
+void IPQ_init(IPQ *pq_ref, uint32_t handles_hint);  // handles_hint: expected largest handle + 1
+uint32_t IPQ_count(IPQ the_pq);
+bool IPQ_is_empty(IPQ the_pq);
+bool IPQ_contains(IPQ the_pq, uint32_t handle);
+bool IPQ_insert(IPQ the_pq, uint32_t handle, int64_t priority);   // handle < IPQ_MAX_HANDLES; false if it isn't, or is already in the queue
+int64_t IPQ_priority_of(IPQ the_pq, uint32_t handle);   // 0 if handle isn't in the queue
+bool IPQ_decrease_key(IPQ the_pq, uint32_t handle, int64_t priority);   // false if handle isn't there, or priority isn't smaller
+bool IPQ_increase_key(IPQ the_pq, uint32_t handle, int64_t priority);   // false if handle isn't there, or priority isn't larger
+bool IPQ_change_key(IPQ the_pq, uint32_t handle, int64_t priority);     // either way; false if handle isn't there
+bool IPQ_remove(IPQ the_pq, uint32_t handle);   // false if handle isn't there
+uint32_t IPQ_peek(IPQ the_pq, int64_t *priority);   // the handle with the smallest priority; the queue must not be empty
+uint32_t IPQ_pop(IPQ the_pq, int64_t *priority);    // remove and return it; priority may be NULL
+void IPQ_destroy(IPQ *pq_ref);
+
+
+
+
+
+
+#endif
@@ -0,0 +1,299 @@
+#include "minmaxheap.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* ************************* Implementation notes ************************** */
+/*
+   The layout is that of a binary heap: the children of the node at
+   index i are at 2i+1 and 2i+2, and its parent at (i-1)/2. The node at
+   index i is on level log2(i+1) (rounded down), the root on level 0.
+   Even levels are min levels and odd levels max levels: an entry on a
+   min level is <= everything below it, and one on a max level >= it
+   (by priority, or in the comparator's order).
+   The smallest entry is thus the root, and the largest the larger of
+   the root's two children (or the root, if it's alone).
+
+   Each operation works like its counterpart in a plain heap, except
+   that an entry moves by grandparents and grandchildren, i.e. between
+   levels of the same kind, and is only compared to its parent or
+   children to find out which kind of level it belongs on:
+
+   - sift up (after an insert at the end): if the new entry is on a min
+     level but larger than its parent (on a max level), it swaps with
+     the parent and goes on up the max levels; otherwise it goes on up
+     the min levels. Symmetrically on a max level. That's at most one
+     comparison per level.
+
+   - sift down (after the root, or a max, is replaced by the last entry):
+     on a min level, the smallest of the entry's children and
+     grandchildren is found. If that's a grandchild smaller than the
+     entry, they swap, and if the entry is then larger than its new
+     parent (on a max level), those two swap as well; then it goes on
+     down from the grandchild. If it's a child, they swap if need be,
+     and that's the end of it. Symmetrically on a max level.
+
+   Both are written once, for min levels, with a flag that flips the
+   comparisons for max levels.
+
+   As in minheap_im.c, entries are compared by priority, inline, unless
+   the heap has a comparator, and entries are moved by value: at 16
+   bytes, they're cheap to copy.
+
+   MMHeap_from_array() is Floyd's method, as in minheap_im.c: the
+   nodes that have children are sifted down, from the last one back to
+   the root, which is O(n).
+*/
+
+
+
+struct min_max_heap{
+    int32_t size;
+    int32_t last_index;
+    HeapCompare compare;    // NULL: by priority
+    HeapEntry *array;
+};
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static inline bool MMHeap_is_max_level(int32_t index){
+    /* True if index is on a max level, i.e. an odd one */
+#if defined(__GNUC__)
+    int level = 31 - __builtin_clz((unsigned)index + 1);
+#else
+    int level = 0;
+    for (uint32_t i = (uint32_t)index + 1; i > 1; i >>= 1){
+        level++;
+    }
+#endif
+    return level & 1;
+}
+
+
+static inline bool MMHeap_before(const HeapEntry *entry1, const HeapEntry *entry2, bool max_level, HeapCompare compare){
+    /* True if entry1 belongs above entry2: if it comes first on a min
+       level, or last on a max level.
+    */
+    if (compare){
+        int order = compare(entry1, entry2);
+        return max_level ? order > 0 : order < 0;
+    }
+    return max_level ? entry1->priority > entry2->priority : entry1->priority < entry2->priority;
+}
+
+
+static void MMHeap_allocate(MMHeap the_heap, int32_t new_size){
+    /* (Re)allocate the array with room for new_size entries */
+    HeapEntry *array = realloc(the_heap->array, sizeof(HeapEntry) * (size_t)new_size);
+    if (!array){
+        exit(EXIT_FAILURE);
+    }
+    the_heap->array = array;
+    the_heap->size = new_size;
+}
+
+
+static void MMHeap_sift_up(HeapEntry the_array[], int32_t current, HeapCompare compare){
+    /* Sift the entry at current up to its place (see the notes at the top) */
+    if (current == 0){
+        return;
+    }
+    HeapEntry value = the_array[current];
+    bool max_level = MMHeap_is_max_level(current);
+    int32_t parent = (current - 1) / 2;
+
+    // does it belong on the other kind of level? Then it swaps with its parent
+    if (MMHeap_before(&the_array[parent], &value, max_level, compare)){
+        the_array[current] = the_array[parent];
+        current = parent;
+        max_level = !max_level;
+    }
+    // from here on, it moves up by grandparents
+    while (current > 2){
+        int32_t grandparent = (current - 3) / 4;
+        if (!MMHeap_before(&value, &the_array[grandparent], max_level, compare)){
+            break;
+        }
+        the_array[current] = the_array[grandparent];
+        current = grandparent;
+    }
+    the_array[current] = value;
+}
+
+
+static void MMHeap_sift_down(HeapEntry the_array[], int32_t current, int32_t last_index, HeapCompare compare){
+    /* Sift the entry at current down to its place (see the notes at the top) */
+    HeapEntry value = the_array[current];
+    bool max_level = MMHeap_is_max_level(current);
+
+    while (1){
+        int32_t first_child = 2 * current + 1;
+        if (first_child > last_index){
+            break;
+        }
+        // the best (smallest on a min level, largest on a max one) of the children and grandchildren
+        int32_t best = first_child;
+        if (first_child + 1 <= last_index && MMHeap_before(&the_array[first_child + 1], &the_array[best], max_level, compare)){
+            best = first_child + 1;
+        }
+        int32_t first_grandchild = 2 * first_child + 1;
+        int32_t end = (first_grandchild + 3 <= last_index) ? first_grandchild + 3 : last_index;
+        for (int32_t i = first_grandchild; i <= end; i++){
+            best = MMHeap_before(&the_array[i], &the_array[best], max_level, compare) ? i : best;
+        }
+
+        if (!MMHeap_before(&the_array[best], &value, max_level, compare)){
+            break;
+        }
+        the_array[current] = the_array[best];   // move it up into the hole
+        current = best;
+        if (best < first_grandchild){
+            break;      // a child: there's nothing below it on the same kind of level
+        }
+        // a grandchild: the entry may not belong below the parent in between
+        int32_t parent = (best - 1) / 2;
+        if (MMHeap_before(&the_array[parent], &value, max_level, compare)){
+            HeapEntry temp = the_array[parent];
+            the_array[parent] = value;
+            value = temp;
+        }
+    }
+    the_array[current] = value;
+}
+
+
+static HeapEntry MMHeap_remove_at(MMHeap the_heap, int32_t index){
+    /* Remove and return the entry at index, moving the last entry into
+       its place and sifting it down, and shrink the array if need be.
+    */
+    HeapEntry val = the_heap->array[index];
+    the_heap->array[index] = the_heap->array[the_heap->last_index];
+    the_heap->last_index--;
+
+    if (index <= the_heap->last_index){
+        MMHeap_sift_down(the_heap->array, index, the_heap->last_index, the_heap->compare);
+    }
+    if (the_heap->size > 2 && the_heap->last_index < (the_heap->size/2)-2){
+        MMHeap_allocate(the_heap, the_heap->size / 2);
+    }
+    return val;
+}
+
+
+static int32_t MMHeap_max_index(MMHeap the_heap){
+    /* Index of the largest entry: the root or one of its children */
+    if (the_heap->last_index < 1){
+        return 0;
+    }
+    if (the_heap->last_index == 1 || !MMHeap_before(&the_heap->array[2], &the_heap->array[1], true, the_heap->compare)){
+        return 1;
+    }
+    return 2;
+}
+
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+void MMHeap_init(MMHeap *heap_ref, int32_t initial_size, HeapCompare compare){
+    /* Allocate an empty min-max heap, with room for initial_size
+       entries. compare orders the entries; if it's NULL, they're
+       ordered by priority.
+    */
+    if (initial_size < 2){
+        initial_size = 2;
+    }
+    MMHeap new_heap = malloc(sizeof(struct min_max_heap));
+    if (!new_heap){
+        exit(EXIT_FAILURE);
+    }
+    new_heap->array = NULL;
+    new_heap->last_index = -1;
+    new_heap->compare = compare;
+    MMHeap_allocate(new_heap, initial_size);
+
+    *heap_ref = new_heap;
+}
+
+
+void MMHeap_from_array(MMHeap *heap_ref, const HeapEntry the_array[], int32_t count, HeapCompare compare){
+    /* Make a new min-max heap (in compare's order; see MMHeap_init())
+       holding the count entries in the_array, in O(n): they're copied
+       in with a single allocation, then heapified bottom-up (see the
+       notes at the top).
+    */
+    MMHeap_init(heap_ref, count + 1, compare);
+    MMHeap new_heap = *heap_ref;
+
+    memcpy(new_heap->array, the_array, sizeof(HeapEntry) * (size_t)count);
+    new_heap->last_index = count - 1;
+    for (int32_t i = (count - 2) / 2; i >= 0 && count > 1; i--){
+        MMHeap_sift_down(new_heap->array, i, new_heap->last_index, compare);
+    }
+}
+
+
+void MMHeap_insert(MMHeap the_heap, int64_t priority, void *payload){
+    /* Insert a new entry into the heap, in O(log n) */
+    if (the_heap->last_index + 1 == the_heap->size){
+        MMHeap_allocate(the_heap, the_heap->size * 2);
+    }
+    the_heap->array[++the_heap->last_index] = (HeapEntry){.priority = priority, .payload = payload};
+    MMHeap_sift_up(the_heap->array, the_heap->last_index, the_heap->compare);
+}
+
+
+HeapEntry MMHeap_peek_min(MMHeap the_heap){
+    /* Return the smallest entry, or an empty one (0, NULL) if the heap is empty */
+    return (the_heap->last_index < 0) ? (HeapEntry){.priority = 0, .payload = NULL} : the_heap->array[0];
+}
+
+
+HeapEntry MMHeap_peek_max(MMHeap the_heap){
+    /* Return the largest entry, or an empty one (0, NULL) if the heap is empty */
+    return (the_heap->last_index < 0) ? (HeapEntry){.priority = 0, .payload = NULL} : the_heap->array[MMHeap_max_index(the_heap)];
+}
+
+
+HeapEntry MMHeap_pop_min(MMHeap the_heap){
+    /* Remove and return the smallest entry, or an empty one (0, NULL) if the heap is empty */
+    if (the_heap->last_index < 0){
+        return (HeapEntry){.priority = 0, .payload = NULL};
+    }
+    return MMHeap_remove_at(the_heap, 0);
+}
+
+
+HeapEntry MMHeap_pop_max(MMHeap the_heap){
+    /* Remove and return the largest entry, or an empty one (0, NULL) if the heap is empty */
+    if (the_heap->last_index < 0){
+        return (HeapEntry){.priority = 0, .payload = NULL};
+    }
+    return MMHeap_remove_at(the_heap, MMHeap_max_index(the_heap));
+}
+
+
+int32_t MMHeap_count(MMHeap the_heap){
+    /* Return the number of entries in the heap */
+    return the_heap->last_index + 1;
+}
+
+
+bool MMHeap_is_empty(MMHeap the_heap){
+    return the_heap->last_index < 0;
+}
+
+
+void MMHeap_destroy(MMHeap *heap_ref){
+    /* Free all memory associated with the heap
+       and set *heap_ref to NULL.
+    */
+    if (!(*heap_ref)){
+        return;
+    }
+    free((*heap_ref)->array);
+    free(*heap_ref);
+    *heap_ref = NULL;
+}
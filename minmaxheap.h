@@ -0,0 +1,57 @@
+#ifndef MINMAXHEAP_H
+#define MINMAXHEAP_H
+
+
+#include "minheap_im.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+
+
+
+/* *********************************************************************** */
+/* ------------------ Implicit implementation of a min-max heap ---------- */
+/* *********************************************************************** */
+
+/* A double-ended priority queue: both the entry that comes first and
+   the one that comes last can be peeked at in O(1) and popped in
+   O(log n), out of one array, rather than out of a min heap and a max
+   heap kept in sync.
+
+   It's stored in an array, like the implicit heap in minheap_im.h,
+   but its levels alternate: the root level is a min level, the next one
+   a max level, and so on. An entry on a min level comes first in its
+   subtree, and one on a max level last.
+
+   Entries are those of minheap_im.h: a 64-bit priority and a payload
+   pointer, which the heap never looks through. They're ordered by
+   priority, smallest first, unless a comparator (a HeapCompare, as
+   for Heap_init()) is given to MMHeap_init(); 'min' and 'max' then
+   mean first and last in its order.
+
+   MMHeap_from_array() builds a heap out of an array in O(n).
+   Peeking at or popping from an empty heap returns an entry with a
+   priority of 0 and a NULL payload.
+*/
+
+typedef struct min_max_heap *MMHeap;
+
+
+// compare can be NULL: by priority
+void MMHeap_init(MMHeap *heap_ref, int32_t initial_size, HeapCompare compare);
+void MMHeap_from_array(MMHeap *heap_ref, const HeapEntry the_array[], int32_t count, HeapCompare compare);   // O(n) bottom-up build
+void MMHeap_insert(MMHeap the_heap, int64_t priority, void *payload);
+HeapEntry MMHeap_peek_min(MMHeap the_heap);
+HeapEntry MMHeap_peek_max(MMHeap the_heap);
+HeapEntry MMHeap_pop_min(MMHeap the_heap);
+HeapEntry MMHeap_pop_max(MMHeap the_heap);
+int32_t MMHeap_count(MMHeap the_heap);
+bool MMHeap_is_empty(MMHeap the_heap);
+void MMHeap_destroy(MMHeap *heap_ref);
+
+
+
+
+
+
+#endif
@@ -0,0 +1,227 @@
+#include "multiqueue.h"
+#include "minheap_im.h"
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+/* ************************* Implementation notes ************************** */
+/*
+   Each heap sits in its own struct mq_queue, along with its lock, a
+   copy of the priority of its root, 'top', and its number of entries,
+   'size', both of which are updated (under the lock) whenever the heap
+   changes. Popping threads compare the tops of two heaps without taking
+   either lock, and only lock the heap they chose; the tops and sizes
+   are atomics, so reading one that's being updated gets either the
+   old value or the new one. It may thus be stale by the time the lock
+   is taken, which only makes the choice a little less good, never wrong:
+   the heap itself is always looked at under the lock.
+
+   The structs are aligned to a cache line, so that threads working on
+   neighbouring heaps don't keep taking the line away from each other
+   (false sharing).
+
+   Random choices come from a per-thread xorshift generator, so threads
+   don't share (and fight over) a random state either.
+
+   A pop that finds both of its heaps empty tries again a few times, then
+   goes through all the heaps in order, waiting for each lock; only if
+   they're all empty does it report the queue as empty.
+*/
+
+#define MQ_CACHE_LINE 64
+#define MQ_INITIAL_HEAP_SIZE 64
+#define MQ_EMPTY_PICKS 8                // random picks of two empty heaps before a full scan
+
+
+struct mq_queue{
+    alignas(MQ_CACHE_LINE) pthread_mutex_t lock;
+    Heap heap;
+    _Atomic int64_t top;    // priority of the root of heap (meaningless while size is 0)
+    atomic_uint size;       // number of entries in heap
+};
+
+struct multiqueue{
+    struct mq_queue *queues;
+    uint32_t count;     // number of heaps
+};
+
+
+static _Thread_local uint64_t MQ_random_state = 0;     // per-thread generator state; 0 until seeded
+static atomic_uint_fast64_t MQ_seed = 0x9e3779b97f4a7c15ULL;
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static uint32_t MQ_random(uint32_t bound){
+    /* Return a random number in [0, bound), from this thread's generator */
+    if (!MQ_random_state){
+        // every thread gets a different seed: the golden ratio, stepped per thread
+        MQ_random_state = atomic_fetch_add(&MQ_seed, 0x9e3779b97f4a7c15ULL) | 1;
+    }
+    MQ_random_state ^= MQ_random_state << 13;
+    MQ_random_state ^= MQ_random_state >> 7;
+    MQ_random_state ^= MQ_random_state << 17;
+    return (uint32_t)(((MQ_random_state >> 32) * bound) >> 32);
+}
+
+
+static void MQ_update_top(struct mq_queue *queue){
+    /* Refresh queue->top and queue->size from its heap. The caller holds the lock */
+    atomic_store_explicit(&queue->top, Heap_peek(queue->heap).priority, memory_order_relaxed);
+    atomic_store_explicit(&queue->size, (unsigned)Heap_count(queue->heap), memory_order_relaxed);
+}
+
+
+static bool MQ_pop_locked(struct mq_queue *queue, int64_t *priority, void **payload){
+    /* Pop the root of queue's heap into *priority and *payload (either
+       of which may be NULL), if it has one. The caller holds the lock.
+    */
+    if (!Heap_count(queue->heap)){
+        return false;
+    }
+    HeapEntry root = Heap_pop(queue->heap);
+    if (priority){
+        *priority = root.priority;
+    }
+    if (payload){
+        *payload = root.payload;
+    }
+    MQ_update_top(queue);
+    return true;
+}
+ 
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+void MQ_init(MultiQueue *mq_ref, uint32_t threads, uint32_t c){
+    /* Allocate a MultiQueue for use by up to threads threads, made of
+       c*threads heaps (at least 2).
+    */
+    MultiQueue new_mq = malloc(sizeof(struct multiqueue));
+    if (!new_mq){
+        exit(EXIT_FAILURE);
+    }
+    new_mq->count = (threads ? threads : 1) * (c ? c : 1);
+    if (new_mq->count < 2){
+        new_mq->count = 2;
+    }
+
+    new_mq->queues = aligned_alloc(MQ_CACHE_LINE, sizeof(struct mq_queue) * new_mq->count);
+    if (!new_mq->queues){
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t i = 0; i < new_mq->count; i++){
+        struct mq_queue *queue = &new_mq->queues[i];
+        if (pthread_mutex_init(&queue->lock, NULL)){
+            exit(EXIT_FAILURE);
+        }
+        Heap_init(&queue->heap, MQ_INITIAL_HEAP_SIZE, NULL);
+        atomic_init(&queue->top, 0);
+        atomic_init(&queue->size, 0);
+    }
+
+    *mq_ref = new_mq;
+}
+
+
+void MQ_insert(MultiQueue the_mq, int64_t priority, void *payload){
+    /* Insert an entry into one of the heaps, picked at random.
+       A heap that's locked by another thread is skipped, and
+       another one picked.
+    */
+    while (1){
+        struct mq_queue *queue = &the_mq->queues[MQ_random(the_mq->count)];
+        if (pthread_mutex_trylock(&queue->lock)){
+            continue;
+        }
+        Heap_insert(queue->heap, priority, payload);
+        MQ_update_top(queue);
+        pthread_mutex_unlock(&queue->lock);
+        return;
+    }
+}
+
+
+bool MQ_pop(MultiQueue the_mq, int64_t *priority, void **payload){
+    /* Pop an entry with a small priority (see multiqueue.h for how small)
+       into *priority and *payload; either may be NULL.
+       Return false if all the heaps were found empty.
+    */
+    uint32_t empty_picks = 0;
+
+    while (empty_picks < MQ_EMPTY_PICKS){
+        struct mq_queue *queue1 = &the_mq->queues[MQ_random(the_mq->count)];
+        struct mq_queue *queue2 = &the_mq->queues[MQ_random(the_mq->count)];
+        bool empty1 = !atomic_load_explicit(&queue1->size, memory_order_relaxed);
+        bool empty2 = !atomic_load_explicit(&queue2->size, memory_order_relaxed);
+
+        if (empty1 && empty2){
+            empty_picks++;
+            continue;
+        }
+        struct mq_queue *queue;
+        if (empty1 || empty2){
+            queue = empty1 ? queue2 : queue1;
+        }
+        else{
+            int64_t top1 = atomic_load_explicit(&queue1->top, memory_order_relaxed);
+            int64_t top2 = atomic_load_explicit(&queue2->top, memory_order_relaxed);
+            queue = (top2 < top1) ? queue2 : queue1;
+        }
+        if (pthread_mutex_trylock(&queue->lock)){
+            continue;
+        }
+        bool popped = MQ_pop_locked(queue, priority, payload);     // the heap may have been emptied since its size was read
+        pthread_mutex_unlock(&queue->lock);
+        if (popped){
+            return true;
+        }
+    }
+
+    // random picks keep coming up empty: look at every heap before giving up
+    for (uint32_t i = 0; i < the_mq->count; i++){
+        struct mq_queue *queue = &the_mq->queues[i];
+        if (!atomic_load_explicit(&queue->size, memory_order_relaxed)){
+            continue;
+        }
+        pthread_mutex_lock(&queue->lock);
+        bool popped = MQ_pop_locked(queue, priority, payload);
+        pthread_mutex_unlock(&queue->lock);
+        if (popped){
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool MQ_is_empty(MultiQueue the_mq){
+    /* Return true if all the heaps are empty at the time they're looked at */
+    for (uint32_t i = 0; i < the_mq->count; i++){
+        if (atomic_load_explicit(&the_mq->queues[i].size, memory_order_relaxed)){
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void MQ_destroy(MultiQueue *mq_ref){
+    /* Free all memory associated with the MultiQueue
+       and set *mq_ref to NULL.
+    */
+    if (!(*mq_ref)){
+        return;
+    }
+    for (uint32_t i = 0; i < (*mq_ref)->count; i++){
+        pthread_mutex_destroy(&(*mq_ref)->queues[i].lock);
+        Heap_destroy(&(*mq_ref)->queues[i].heap);
+    }
+    free((*mq_ref)->queues);
+    free(*mq_ref);
+    *mq_ref = NULL;
+}
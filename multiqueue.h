@@ -0,0 +1,59 @@
+#ifndef MULTIQUEUE_H
+#define MULTIQUEUE_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+
+
+/* *********************************************************************** */
+/* ------------------ MultiQueue: relaxed concurrent min-PQ -------------- */
+/* *********************************************************************** */
+/*
+ * A priority queue that many threads can insert into and pop from at
+ * the same time, built from c*P implicit heaps (see minheap_im.h), P
+ * being the number of threads using it, each heap with its own lock.
+ *
+ * A single heap behind a single lock lets only one thread in at a
+ * time, however many cores there are. Here instead:
+ *  - an insertion goes into a heap picked at random,
+ *  - a pop looks at the roots of two heaps picked at random, and pops
+ *    the smaller of the two,
+ * and in both cases, if the heap's lock is taken, the thread doesn't
+ * wait for it, but picks again. With c*P heaps, threads rarely pick
+ * the same one, so they rarely get in each other's way.
+ *
+ * The price is that the queue is RELAXED: a pop returns an item that's
+ * among the smallest, but not necessarily THE smallest. How far off it
+ * is (its rank error) only depends on the number of heaps, not on the
+ * number of items: it's O(c*P) on average. Schedulers that pick 'one of
+ * the most urgent tasks' can live with that.
+ *
+ * bench_multiqueue.c measures both sides of that trade: throughput for
+ * 1 to 8 threads against a single heap behind a mutex, and the mean and
+ * largest rank error.
+ *
+ * Entries are a priority and a payload, as in minheap_im.h; the payload
+ * is stored as is, and handed back by the pop that removes the entry.
+ *
+ * The MultiQueue must not be destroyed while other threads still use it.
+ * Link with -pthread.
+ */
+
+typedef struct multiqueue *MultiQueue;
+
+
+void MQ_init(MultiQueue *mq_ref, uint32_t threads, uint32_t c);    // c*threads heaps (c of 2 to 4 is typical)
+void MQ_insert(MultiQueue the_mq, int64_t priority, void *payload);
+bool MQ_pop(MultiQueue the_mq, int64_t *priority, void **payload);   // false if the queue was found empty; either pointer may be NULL
+bool MQ_is_empty(MultiQueue the_mq);    // a snapshot: other threads may change it right away
+void MQ_destroy(MultiQueue *mq_ref);
+
+
+
+
+
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef DSET_BITMAP     // BST backend; see mutable_set.h
+
+#include <limits.h>
 #include <stdint.h>
 #include <stdlib.h>
 
@@ -9,9 +12,201 @@
 
 struct dynamic_set{
     BinaryTree items;
+    uint16_t size;      // number of items, kept up to date by every operation that changes items
+};
+
+
+
+/* ***************************** Private ****************************** */
+/* -------------------------------------------------------------------- */
+
+/* A set can hold at most 256 items (one per char value), so no path in
+   its tree is ever longer than that. This bounds the stack an in-order
+   walk needs, which can then be a plain local array. 
+*/
+#define SET_MAX_ITEMS 256
+
+
+// state of an in-order walk over the tree of a set, one item at a time
+struct set_walk{
+    BinaryTree stack[SET_MAX_ITEMS];    // nodes whose left subtree is being walked
+    uint16_t top;                       // number of nodes on the stack
+};
+
+
+// which items Set_merge_P() keeps
+enum set_merge_flags{
+    SET_KEEP_FIRST = 1,     // items only in the first set
+    SET_KEEP_SECOND = 2,    // items only in the second set
+    SET_KEEP_BOTH = 4       // items in both sets
 };
 
 
+static void Set_walk_push_left_P(struct set_walk *walk, BinaryTree node){
+    /* Push node and all the left children below it onto the walk stack */
+    while (node){
+        walk->stack[walk->top++] = node;
+        node = node->left_child;
+    }
+}
+
+
+static void Set_walk_start_P(struct set_walk *walk, BinaryTree tree){
+    /* Position walk before the smallest item in tree */
+    walk->top = 0;
+    Set_walk_push_left_P(walk, tree);
+}
+
+
+static BinaryTree Set_walk_next_node_P(struct set_walk *walk){
+    /* Return the node holding the next item of the walk, in ascending
+       order, or NULL once there are no items left.
+       The node's child pointers have already been read when it's
+       returned, so the caller is free to relink it.
+    */
+    if (!walk->top){
+        return NULL;
+    }
+    BinaryTree node = walk->stack[--walk->top];
+    Set_walk_push_left_P(walk, node->right_child);
+    return node;
+}
+
+
+static bool Set_walk_next_P(struct set_walk *walk, char *the_value){
+    /* Store the next item of the walk in *the_value, in ascending order.
+       Return false once there are no items left.
+    */
+    BinaryTree node = Set_walk_next_node_P(walk);
+    if (!node){
+        return false;
+    }
+    *the_value = node->data;
+    return true;
+}
+
+
+static inline uint8_t Set_rank_of_P(char the_value){
+    /* Map the_value to its rank (0-255) among all char values */
+    return (uint8_t)((int)the_value - CHAR_MIN);
+}
+
+
+static void Set_mark_batch_P(const char items[], uint32_t how_many, bool marked[]){
+    /* Sort and deduplicate a batch of items: set marked[rank] for the
+       rank of every item in it. marked must have SET_MAX_ITEMS entries.
+
+       This is a counting sort, really: there are only 256 possible
+       values, so a batch of any size is sorted in a single O(n) pass,
+       and reading marked in order of rank yields its items sorted
+       and without duplicates.
+    */
+    for (uint16_t i = 0; i < SET_MAX_ITEMS; i++){
+        marked[i] = false;
+    }
+    for (uint32_t i = 0; i < how_many; i++){
+        marked[Set_rank_of_P(items[i])] = true;
+    }
+}
+
+
+static BinaryTree Set_link_balanced_P(BinaryTree nodes[], int32_t first, int32_t last){
+    /* Relink nodes[first..last], which are sorted, into a balanced
+       tree and return its root. No node is allocated or freed.
+    */
+    if (first > last){
+        return NULL;
+    }
+    int32_t middle = first + (last - first) / 2;
+    BinaryTree root = nodes[middle];
+    root->left_child = Set_link_balanced_P(nodes, first, middle - 1);
+    root->right_child = Set_link_balanced_P(nodes, middle + 1, last);
+    return root;
+}
+
+
+static void Set_merge_P(DSet set1, DSet set2, enum set_merge_flags keep, DSet result){
+    /* Walk the items of set1 and set2 side by side, in ascending order,
+       as in the merge step of merge sort, and make result hold the items
+       selected by keep, stored in a balanced tree. Whatever result held
+       before is freed. result may be set1 or set2 itself: its old tree is
+       only freed after the walk is over.
+
+       Union, intersection, difference and symmetric difference are all
+       this same walk, only keeping different items. Each item of each
+       set is looked at once and the result is built from a sorted array,
+       so the whole thing is O(n+m).
+    */
+    struct set_walk walk1, walk2;
+    Set_walk_start_P(&walk1, set1->items);
+    Set_walk_start_P(&walk2, set2->items);
+
+    char merged[SET_MAX_ITEMS];     // left uninitialized: only merged[0 .. count-1], written below, is ever read
+    uint16_t count = 0;
+
+    char value1 = 0, value2 = 0;
+    bool has1 = Set_walk_next_P(&walk1, &value1);
+    bool has2 = Set_walk_next_P(&walk2, &value2);
+
+    while (has1 || has2){
+        // once one of the sets runs out, stop unless the rest of the other one is to be kept
+        if ((!has1 && !(keep & SET_KEEP_SECOND)) || (!has2 && !(keep & SET_KEEP_FIRST))){
+            break;
+        }
+
+        if (has1 && (!has2 || value1 < value2)){     // only in set1
+            if (keep & SET_KEEP_FIRST){
+                merged[count++] = value1;
+            }
+            has1 = Set_walk_next_P(&walk1, &value1);
+        }
+        else if (has2 && (!has1 || value2 < value1)){    // only in set2
+            if (keep & SET_KEEP_SECOND){
+                merged[count++] = value2;
+            }
+            has2 = Set_walk_next_P(&walk2, &value2);
+        }
+        else{   // in both
+            if (keep & SET_KEEP_BOTH){
+                merged[count++] = value1;
+            }
+            has1 = Set_walk_next_P(&walk1, &value1);
+            has2 = Set_walk_next_P(&walk2, &value2);
+        }
+    }
+
+    BinaryTree merged_tree = NULL;
+    if (count){
+        merged_tree = BST_from_sorted_array(merged, count);
+        if (!merged_tree){
+            exit(EXIT_FAILURE);
+        }
+    }
+    BST_destroy(&result->items);
+    result->items = merged_tree;
+    result->size = count;
+}
+
+static BinaryTree *Set_find_link_P(DSet the_set, char the_value){
+    /* Return the address of the pointer that points to the node holding
+       the_value: either the_set->items or the child pointer of its parent.
+       If the_value isn't in the set, the pointer it addresses is NULL, 
+       and it's where a node for the_value would have to be attached.
+
+       This way Set_insert() and Set_del() find out whether the_value
+       is there and change the tree with the same, single descent.
+    */
+    BinaryTree *link = &the_set->items;
+    while (*link && (*link)->data != the_value){
+        link = (the_value < (*link)->data) ? &(*link)->left_child : &(*link)->right_child;
+    }
+    return link;
+}
+
+/* ---------------------------------------------------------------- */
+/* ***************************** End Private ********************** */
+
+
 void Set_init(DSet *the_set){
     /* Initializes a Dset to the correct values after allocating
        memory. 
@@ -24,15 +219,18 @@ void Set_init(DSet *the_set){
     }
     // initialize the inner BinaryTree member
     BST_init(&newset->items);
+    newset->size = 0;
     *the_set = newset;
     return;
 }
 
 
 uint16_t Set_size(DSet the_set){
-    /* Return the number of items in the set */
-    BinaryTree inner_tree = the_set->items;
-    return BST_count_nodes(inner_tree);
+    /* Return the number of items in the set.
+       This is kept count of as items are inserted and deleted,
+       so the tree doesn't need to be walked.
+    */
+    return the_set->size;
 }
 
 
@@ -49,17 +247,130 @@ bool Set_contains(DSet the_set, char the_value){
 }
 
 
+DSet Set_from_array(const char items[], uint32_t how_many){
+    /* Return a new DSet holding the items in the array, which may
+       be in any order and hold duplicates.
+
+       The items are sorted and deduplicated in one pass (see
+       Set_mark_batch_P()), and the tree is then built balanced
+       from them in linear time, rather than with one descent per
+       item (which, for items that come sorted, would also leave
+       the tree a linked list).
+    */
+    bool marked[SET_MAX_ITEMS];
+    Set_mark_batch_P(items, how_many, marked);
+
+    char sorted[SET_MAX_ITEMS];
+    uint16_t count = 0;
+    for (uint16_t rank = 0; rank < SET_MAX_ITEMS; rank++){
+        if (marked[rank]){
+            sorted[count++] = (char)(rank + CHAR_MIN);
+        }
+    }
+
+    DSet newset;
+    Set_init(&newset);
+    newset->items = BST_from_sorted_array(sorted, count);
+    if (count && !newset->items){
+        exit(EXIT_FAILURE);
+    }
+    newset->size = count;
+    return newset;
+}
+
+
+void Set_insert_many(DSet the_set, const char items[], uint32_t how_many){
+    /* Insert all the items in the array into the set, skipping
+       those already there. The array may be in any order and
+       hold duplicates.
+
+       The batch is sorted, then merged with an in-order walk of the
+       tree in a single pass. The nodes already in the tree are kept
+       and only new items get a new node; all of them are then
+       relinked into a balanced tree.
+    */
+    bool marked[SET_MAX_ITEMS];
+    Set_mark_batch_P(items, how_many, marked);
+
+    BinaryTree nodes[SET_MAX_ITEMS];
+    uint16_t count = 0;
+
+    struct set_walk walk;
+    Set_walk_start_P(&walk, the_set->items);
+    BinaryTree node = Set_walk_next_node_P(&walk);
+
+    for (uint16_t rank = 0; rank < SET_MAX_ITEMS; rank++){
+        if (node && Set_rank_of_P(node->data) == rank){     // already in the set
+            nodes[count++] = node;
+            node = Set_walk_next_node_P(&walk);
+        }
+        else if (marked[rank]){
+            if (!(nodes[count++] = BST_insert_nd(NULL, (char)(rank + CHAR_MIN)))){
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    the_set->items = Set_link_balanced_P(nodes, 0, (int32_t)count - 1);
+    the_set->size = count;
+}
+
+
+void Set_del_many(DSet the_set, const char items[], uint32_t how_many){
+    /* Delete all the items in the array from the set, skipping those
+       that aren't there. The array may be in any order and hold
+       duplicates.
+
+       As with Set_insert_many(), the batch is sorted and applied in a
+       single in-order walk of the tree: the nodes of deleted items are
+       freed, and the rest are relinked into a balanced tree.
+    */
+    bool marked[SET_MAX_ITEMS];
+    Set_mark_batch_P(items, how_many, marked);
+
+    BinaryTree nodes[SET_MAX_ITEMS];
+    uint16_t count = 0;
+
+    struct set_walk walk;
+    Set_walk_start_P(&walk, the_set->items);
+    BinaryTree node;
+
+    while ((node = Set_walk_next_node_P(&walk))){
+        if (marked[Set_rank_of_P(node->data)]){
+            node->left_child = node->right_child = NULL;    // the walk is done with them
+            BST_destroy(&node);
+        }
+        else{
+            nodes[count++] = node;
+        }
+    }
+
+    the_set->items = Set_link_balanced_P(nodes, 0, (int32_t)count - 1);
+    the_set->size = count;
+}
+
+
 void Set_insert(DSet the_set, char the_value){
     /* Insert the_value into the set, if not already there */
-    BinaryTree inner_tree = the_set->items;
-    the_set->items = BST_insert_nd(inner_tree, the_value);   // insert_no_duplicates
+    BinaryTree *link = Set_find_link_P(the_set, the_value);
+    if (*link){     // already there
+        return;
+    }
+    if (!(*link = BST_insert_nd(NULL, the_value))){     // a single new node, hung where the search ended
+        exit(EXIT_FAILURE);
+    }
+    the_set->size++;
 }
 
 
 void Set_del(DSet the_set, char the_value){
     /* Delete the_value from the_set, if found */
-    BinaryTree inner_tree = the_set->items;
-    the_set->items = BST_remove_node(inner_tree, the_value);
+    BinaryTree *link = Set_find_link_P(the_set, the_value);
+    if (!(*link)){      // not there
+        return;
+    }
+    *link = BST_remove_node(*link, the_value);  // the_value is at the root of *link's subtree
+    the_set->size--;
 }
 
 
@@ -72,6 +383,9 @@ char *Set_items(DSet the_set){
     BinaryTree inner_tree = the_set->items;
     uint16_t size = Set_size(the_set);  // calling Set_size instead of BST_count_nodes() for the sake of maintainability
     char *items_array = malloc(sizeof(char) * (size+1));    // +1 for the terminating null char
+    if (!items_array){
+        exit(EXIT_FAILURE);
+    }
 
     BST_to_array(inner_tree, items_array, 0); // traverse the tree in-order and write all the values to items_array
     items_array[size] = '\0';
@@ -82,30 +396,27 @@ char *Set_items(DSet the_set){
 
 
 bool Set_is_same(DSet set1, DSet set2){
-    uint16_t set1_size = Set_size(set1);
-    if (set1_size != Set_size(set2)){
+    /* Return true if set1 and set2 hold exactly the same items.
+
+       The two trees are walked in-order side by side, and the walk
+       stops at the first pair of items that differ. Nothing is allocated.
+    */
+    if (set1->size != set2->size){
         return false;
     } // the sets differ in size, so they're different. No further checking required
 
     //else, they're the same size. Compare elements 
-    char *set1_items = malloc(sizeof(char) * set1_size);
-    char *set2_items = malloc(sizeof(char) * set1_size);
-    
-    if (!(set1_items && set2_items)){
-        exit(EXIT_FAILURE);  // one of the allocations above failed
-    }
-
-    BST_to_array(set1->items, set1_items, 0); // get all the items in set1 in sorted order
-    BST_to_array(set2->items, set2_items, 0); // ditto
-
-    // iterate over the arrays and compare. If any incongruity is found, return false
-    for (uint16_t i = 0; i < set1_size; i++){
-        if (set1_items[i] != set2_items[i]){
+    struct set_walk walk1, walk2;
+    Set_walk_start_P(&walk1, set1->items);
+    Set_walk_start_P(&walk2, set2->items);
+
+    char value1, value2;
+    while (Set_walk_next_P(&walk1, &value1)){
+        // same size, so there's always a next item in set2 too, unless a size is off
+        if (!Set_walk_next_P(&walk2, &value2) || value1 != value2){
             return false;
         }
     }
-    free(set1_items);
-    free(set2_items);
     // if the flow of control makes it thus far, return true
     return true;
 };
@@ -114,151 +425,104 @@ bool Set_is_same(DSet set1, DSet set2){
 bool Set_is_subset(DSet set1, DSet set2){
     /* Return true if set1 is a subset of set2.
        Otherwise, return false.
+
+       The two trees are walked in-order side by side: for each item
+       of set1, set2 is advanced past the items smaller than it, and 
+       the next one has to be that same item. The walk stops as soon
+       as one isn't. Nothing is allocated.
     */
-    uint16_t set1_size = Set_size(set1);
-    if (set1_size >= Set_size(set2)){
+    if (set1->size >= set2->size){
         return false;
     } //set1 can't possibly be a subset of subset2, since it's larger 
 
     //else, set1 is smaller, check elements 
-    char *set1_items = malloc(sizeof(char) * set1_size);
-    char *set2_items = malloc(sizeof(char) * set1_size);
-    
-    if (!(set1_items && set2_items)){
-        exit(EXIT_FAILURE);  // one of the allocations above failed
-    }
-
-    BST_to_array(set1->items, set1_items, 0); // get all the items in set1 in sorted order
-    BST_to_array(set2->items, set2_items, 0); // ditto
-
-    // iterate over the arrays and compare. If any incongruity is found, return false
-    for (uint16_t i = 0; i < set1_size; i++){
-        if (!Set_contains(set2, set1_items[i])){
-                return false;
+    struct set_walk walk1, walk2;
+    Set_walk_start_P(&walk1, set1->items);
+    Set_walk_start_P(&walk2, set2->items);
+
+    char value1, value2;
+    while (Set_walk_next_P(&walk1, &value1)){
+        do{
+            if (!Set_walk_next_P(&walk2, &value2)){
+                return false;   // set2 ran out before value1 was found
+            }
+        }while (value2 < value1);
+
+        if (value2 != value1){
+            return false;
         }
     }
-    free(set1_items);
-    free(set2_items);
     // if the flow of control makes it thus far, return true
     return true;
 };
 
 
 
-char *Set_union(DSet set1,  DSet set2){
-    /* Return a dynamically allocated char array containing
-       the union of set1 and set2. 
+DSet Set_union(DSet set1,  DSet set2){
+    /* Return a new DSet holding the union of set1 and set2.
 
-       It's the responsibility of the caller to then free
-       this array when no longer needed, by calling free
-       on it.
+       It's the responsibility of the caller to destroy it with
+       Set_destroy() when no longer needed.
     */
-     uint16_t set1_size = Set_size(set1);
-     uint16_t set2_size = Set_size(set2);
+    DSet newset;
+    Set_init(&newset);
+    Set_merge_P(set1, set2, SET_KEEP_FIRST | SET_KEEP_SECOND | SET_KEEP_BOTH, newset);
+    return newset;
+}
 
-    char *set1_items = malloc(sizeof(char) * set1_size);
-    char *set2_items = malloc(sizeof(char) * set2_size);
 
-    if (!(set1_items && set2_items)){ 
-        exit(EXIT_FAILURE);  // one of the allocations above failed
-    }
-    BST_to_array(set1->items, set1_items, 0); // get all the items in set1 in sorted order
-    BST_to_array(set2->items, set2_items, 0); // ditto
-    
-    /* build a BinaryTree out of the items in set1 and the items in set2, using the nd (no
-     * duplicates) BST insert function. This tree will contain the union of the other two
-     * sets, since it doesn't allow duplicates */
-    BinaryTree union_tree;
-    BST_init(&union_tree);
-
-    // insert the items in the first set into the union_tree
-    for (uint16_t i = 0; i < set1_size; i++){
-        union_tree = BST_insert_nd(union_tree, set1_items[i]);
-    }
-    // do the same for the items in the second set
-    for (uint16_t i = 0; i < set2_size; i++){
-        union_tree = BST_insert_nd(union_tree, set2_items[i]);
-    }
-    // the two arrays are no longer needed
-    free(set1_items);
-    free(set2_items);
-
-    // create an array equal in size to the number of items in the union_tree
-    uint16_t union_size = BST_count_nodes(union_tree);
-    char *set_union = malloc(sizeof(char) * (union_size+1));    // +1 for the terminating Nul
-    if (!set_union){
-        exit(EXIT_FAILURE);
-    }
+DSet Set_difference(DSet set1,  DSet set2){
+    /* Return a new DSet holding the items in set1 that aren't in set2 */
+    DSet newset;
+    Set_init(&newset);
+    Set_merge_P(set1, set2, SET_KEEP_FIRST, newset);
+    return newset;
+}
 
-   // write the union tree to the array, and return that
-    BST_to_array(union_tree, set_union, 0);
-    set_union[union_size] = '\0';
-    BST_destroy(&union_tree);
 
-    return set_union;
+DSet Set_intersection(DSet set1,  DSet set2){
+    /* Return a new DSet holding the items that are both in set1 and set2 */
+    DSet newset;
+    Set_init(&newset);
+    Set_merge_P(set1, set2, SET_KEEP_BOTH, newset);
+    return newset;
 }
 
 
-char *Set_difference(DSet set1,  DSet set2){
-    /* Return a malloc-ed char array containing the 
-       elements in set1 that aren't in set2
+DSet Set_symmetric_difference(DSet set1,  DSet set2){
+    /* Return a new DSet holding the items that are in either
+       set1 or set2, but not in both.
     */
-    uint16_t set1_size = BST_count_nodes(set1->items);
-    char *set1_items = malloc(sizeof(char) * set1_size);
-    char *set_difference = malloc(sizeof(char) * (set1_size +1));   // +1 for the terminating Nul
-    
-    if (!(set1_items && set_difference)){
-        exit(EXIT_FAILURE);
-    }
-    
-    // write all the elements in the set1 tree to the set1_items array
-    BST_to_array(set1->items, set1_items, 0);
-
-    uint16_t set_difference_index = 0;
-    char current = 0;
-    for (uint16_t i = 0; i<set1_size; i++){
-        current = set1_items[i]; 
-        // if current is in set1 but not in set2, add it to set_difference
-        if (!(BST_contains(set2->items, current))){
-            set_difference[set_difference_index] = current;
-            set_difference_index++;
-        }
-    };
-    set_difference[set_difference_index] = '\0';
-    free(set1_items);
-    return set_difference;
+    DSet newset;
+    Set_init(&newset);
+    Set_merge_P(set1, set2, SET_KEEP_FIRST | SET_KEEP_SECOND, newset);
+    return newset;
 }
 
 
-char *Set_intersection(DSet set1,  DSet set2){
-    /* Return a malloc-ed char array containing the 
-       items that are both in set1 and set2.
-    */
+void Set_union_into(DSet target, DSet other){
+    /* Add all the items in other to target */
+    Set_merge_P(target, other, SET_KEEP_FIRST | SET_KEEP_SECOND | SET_KEEP_BOTH, target);
+}
 
-    uint16_t set1_size = BST_count_nodes(set1->items);
-    char *set1_items = malloc(sizeof(char) * set1_size);
-    char *set_intersection = malloc(sizeof(char) * (set1_size +1));   // +1 for the terminating Nul
-    
-    if (!(set1_items && set_intersection)){
-        exit(EXIT_FAILURE);
-    }
-    
-    // write all the elements in the set1 tree to the set1_items array
-    BST_to_array(set1->items, set1_items, 0);
-
-    uint16_t set_intersection_index = 0;
-    char current = 0;
-    for (uint16_t i = 0; i<set1_size; i++){
-        current = set1_items[i]; 
-        // if current is in set1 but not in set2, add it to set_difference
-        if (BST_contains(set2->items, current)){
-            set_intersection[set_intersection_index] = current;
-            set_intersection_index++;
-        }
-    };
-   set_intersection[set_intersection_index] = '\0';
-    free(set1_items);
-    return set_intersection;
+
+void Set_difference_into(DSet target, DSet other){
+    /* Remove from target all the items that are in other */
+    Set_merge_P(target, other, SET_KEEP_FIRST, target);
+}
+
+
+void Set_intersection_into(DSet target, DSet other){
+    /* Remove from target all the items that aren't in other */
+    Set_merge_P(target, other, SET_KEEP_BOTH, target);
+}
+
+
+void Set_symmetric_difference_into(DSet target, DSet other){
+    /* Make target hold the items that were either in target or
+       in other, but not in both.
+    */
+    Set_merge_P(target, other, SET_KEEP_FIRST | SET_KEEP_SECOND, target);
 }
 
 
@@ -277,4 +541,4 @@ void Set_destroy(DSet *the_set){
     *the_set = NULL;
 }
 
-
+#endif
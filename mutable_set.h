@@ -21,6 +21,17 @@
  *  The BST offers logarithmic time complexity for insertion
  *  and lookup operations.
  *
+ *  Since the items are chars, though, there are only 256 values
+ *  a set can ever hold, and so a set can just as well be stored 
+ *  as a 256-bit bitmap: one bit per possible value. That makes
+ *  lookup, insertion and deletion O(1), and the set operations 
+ *  a handful of bitwise operations on 64-bit words.
+ *  The bitmap backend (mutable_set_bitmap.c) is selected at compile
+ *  time by defining DSET_BITMAP (e.g. -DDSET_BITMAP); otherwise the 
+ *  BST backend (mutable_set.c) is used. Both implement the interface
+ *  below, and each file compiles to nothing when the other one
+ *  is selected.
+ *
  *  The set is SORTED.
  * 
  * *************************************************************** */
@@ -38,9 +49,24 @@ bool Set_is_same(DSet set1, DSet set2);
 void Set_insert(DSet the_set, char the_value);
 void Set_del(DSet the_set, char the_value);
 bool Set_is_subset(DSet set1, DSet set2);
-char *Set_union(DSet set1,  DSet set2);
-char *Set_difference(DSet set1,  DSet set2);
-char *Set_intersection(DSet set1,  DSet set2);
+
+// bulk operations: items may be in any order and hold duplicates
+DSet Set_from_array(const char items[], uint32_t how_many);     // a new DSet holding the items, to be destroyed with Set_destroy()
+void Set_insert_many(DSet the_set, const char items[], uint32_t how_many);
+void Set_del_many(DSet the_set, const char items[], uint32_t how_many);
+
+// set algebra: these return a new DSet, to be destroyed by the caller with Set_destroy()
+DSet Set_union(DSet set1,  DSet set2);
+DSet Set_difference(DSet set1,  DSet set2);
+DSet Set_intersection(DSet set1,  DSet set2);
+DSet Set_symmetric_difference(DSet set1,  DSet set2);
+
+// the same operations, storing the result in target instead of in a new set
+void Set_union_into(DSet target, DSet other);
+void Set_difference_into(DSet target, DSet other);
+void Set_intersection_into(DSet target, DSet other);
+void Set_symmetric_difference_into(DSet target, DSet other);
+
 void Set_destroy(DSet *the_set);   // destroy a DSet and free all memory associated with it
 //void Set_destroy_items(DSetItems *set_items); // destroy a DSetItems and free all associated memory
 
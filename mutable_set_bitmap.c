@@ -0,0 +1,334 @@
+#ifdef DSET_BITMAP      // bitmap backend; see mutable_set.h
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "mutable_set.h"
+
+/* ********************************************************** */
+/*                  Implementation Notes
+
+    A char can only take 256 different values, so rather than
+    storing the items of the set, this backend stores one bit
+    for every value a char can take: the bit is set if the value
+    is in the set, and clear otherwise.
+    The 256 bits are kept in four 64-bit words.
+
+    A value is mapped to its bit by subtracting CHAR_MIN from it,
+    so that bit 0 is the smallest char and bit 255 the largest one,
+    whether char is signed or not. Walking the bits from 0 up thus
+    yields the items in sorted order, just like an in-order walk
+    of the BST backend does.
+
+    Membership, insertion and deletion are then a single bit test,
+    set or clear, the size of the set is the population count of
+    the four words, and union, intersection, difference and
+    symmetric difference are bitwise OR, AND, AND-NOT and XOR on them. These loops are short and
+    branch-free, and compilers turn them into a couple of SIMD
+    instructions.
+*/
+
+
+#define SET_WORDS 4   // 4 * 64 = 256 bits, one per char value
+
+
+struct dynamic_set{
+    uint64_t words[SET_WORDS];
+};
+
+
+
+/* ***************************** Private ****************************** */
+/* -------------------------------------------------------------------- */
+
+static inline uint8_t Set_bit_of_P(char the_value){
+    /* Map the_value to its bit number (0-255) */
+    return (uint8_t)((int)the_value - CHAR_MIN);
+}
+
+
+static inline char Set_value_of_P(uint8_t bit){
+    /* Inverse of Set_bit_of_P() */
+    return (char)((int)bit + CHAR_MIN);
+}
+
+
+static inline uint8_t Set_popcount_P(uint64_t word){
+    /* Return the number of bits set in word */
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    uint8_t count = 0;
+    while (word){
+        word &= word - 1;   // clear the lowest set bit
+        count++;
+    }
+    return count;
+#endif
+}
+
+
+static inline uint8_t Set_lowest_bit_P(uint64_t word){
+    /* Return the position of the lowest set bit in word.
+       word must not be 0.
+    */
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    uint8_t position = 0;
+    while (!(word & 1)){
+        word >>= 1;
+        position++;
+    }
+    return position;
+#endif
+}
+
+
+static char *Set_words_to_array_P(const uint64_t words[]){
+    /* Return a malloc-ed, Nul-terminated char array holding
+       the values whose bits are set in words, in sorted order.
+    */
+    uint16_t size = 0;
+    for (uint8_t i = 0; i < SET_WORDS; i++){
+        size += Set_popcount_P(words[i]);
+    }
+
+    char *items_array = malloc(sizeof(char) * (size+1));    // +1 for the terminating null char
+    if (!items_array){
+        exit(EXIT_FAILURE);
+    }
+
+    uint16_t index = 0;
+    for (uint8_t i = 0; i < SET_WORDS; i++){
+        uint64_t word = words[i];
+        while (word){
+            items_array[index++] = Set_value_of_P(i * 64 + Set_lowest_bit_P(word));
+            word &= word - 1;
+        }
+    }
+    items_array[size] = '\0';
+
+    return items_array;
+}
+
+/* ---------------------------------------------------------------- */
+/* ***************************** End Private ********************** */
+
+
+
+void Set_init(DSet *the_set){
+    /* Allocate memory for a DSet and initialize it to the empty set */
+    DSet newset = malloc(sizeof(struct dynamic_set));
+    if (!newset){
+        exit(EXIT_FAILURE);
+    }
+    for (uint8_t i = 0; i < SET_WORDS; i++){
+        newset->words[i] = 0;
+    }
+    *the_set = newset;
+}
+
+
+uint16_t Set_size(DSet the_set){
+    /* Return the number of items in the set */
+    uint16_t size = 0;
+    for (uint8_t i = 0; i < SET_WORDS; i++){
+        size += Set_popcount_P(the_set->words[i]);
+    }
+    return size;
+}
+
+
+bool Set_is_empty(DSet the_set){
+    /* Return true if the_set is empty, false otherwise */
+    return !(the_set->words[0] | the_set->words[1] | the_set->words[2] | the_set->words[3]);
+}
+
+
+bool Set_contains(DSet the_set, char the_value){
+    /* Return true if the_value is found in the_set, false otherwise */
+    uint8_t bit = Set_bit_of_P(the_value);
+    return (the_set->words[bit >> 6] >> (bit & 63)) & 1;
+}
+
+
+void Set_insert(DSet the_set, char the_value){
+    /* Insert the_value into the set, if not already there */
+    uint8_t bit = Set_bit_of_P(the_value);
+    the_set->words[bit >> 6] |= (uint64_t)1 << (bit & 63);
+}
+
+
+void Set_del(DSet the_set, char the_value){
+    /* Delete the_value from the_set, if found */
+    uint8_t bit = Set_bit_of_P(the_value);
+    the_set->words[bit >> 6] &= ~((uint64_t)1 << (bit & 63));
+}
+
+
+DSet Set_from_array(const char items[], uint32_t how_many){
+    /* Return a new DSet holding the items in the array, which may
+       be in any order and hold duplicates.
+    */
+    DSet newset;
+    Set_init(&newset);
+    Set_insert_many(newset, items, how_many);
+    return newset;
+}
+
+
+void Set_insert_many(DSet the_set, const char items[], uint32_t how_many){
+    /* Insert all the items in the array into the set.
+       There's nothing to sort here: each item is a single bit set.
+    */
+    for (uint32_t i = 0; i < how_many; i++){
+        uint8_t bit = Set_bit_of_P(items[i]);
+        the_set->words[bit >> 6] |= (uint64_t)1 << (bit & 63);
+    }
+}
+
+
+void Set_del_many(DSet the_set, const char items[], uint32_t how_many){
+    /* Delete all the items in the array from the set */
+    for (uint32_t i = 0; i < how_many; i++){
+        uint8_t bit = Set_bit_of_P(items[i]);
+        the_set->words[bit >> 6] &= ~((uint64_t)1 << (bit & 63));
+    }
+}
+
+
+char *Set_items(DSet the_set){
+    /* Returns a dynamically-allocated char array containing all the items
+       in the_set, in sorted order.
+       It's the responsibility of the caller to call free() on this returned
+       array when no longer needed.
+    */
+    return Set_words_to_array_P(the_set->words);
+}
+
+
+bool Set_is_same(DSet set1, DSet set2){
+    /* Return true if set1 and set2 hold exactly the same items */
+    uint64_t differ = 0;
+    for (uint8_t i = 0; i < SET_WORDS; i++){
+        differ |= set1->words[i] ^ set2->words[i];
+    }
+    return !differ;
+}
+
+
+bool Set_is_subset(DSet set1, DSet set2){
+    /* Return true if set1 is a subset of set2.
+       Otherwise, return false.
+
+       As with the BST backend, set1 has to be strictly smaller
+       than set2: a set isn't considered a subset of an equal set.
+    */
+    uint64_t outside = 0;   // items of set1 that aren't in set2
+    uint64_t differ = 0;
+    for (uint8_t i = 0; i < SET_WORDS; i++){
+        outside |= set1->words[i] & ~set2->words[i];
+        differ |= set1->words[i] ^ set2->words[i];
+    }
+    return !outside && differ;
+}
+
+
+DSet Set_union(DSet set1,  DSet set2){
+    /* Return a new DSet holding the union of set1 and set2.
+
+       It's the responsibility of the caller to destroy it with
+       Set_destroy() when no longer needed.
+    */
+    DSet newset;
+    Set_init(&newset);
+    for (uint8_t i = 0; i < SET_WORDS; i++){
+        newset->words[i] = set1->words[i] | set2->words[i];
+    }
+    return newset;
+}
+
+
+DSet Set_difference(DSet set1,  DSet set2){
+    /* Return a new DSet holding the items in set1 that aren't in set2 */
+    DSet newset;
+    Set_init(&newset);
+    for (uint8_t i = 0; i < SET_WORDS; i++){
+        newset->words[i] = set1->words[i] & ~set2->words[i];
+    }
+    return newset;
+}
+
+
+DSet Set_intersection(DSet set1,  DSet set2){
+    /* Return a new DSet holding the items that are both in set1 and set2 */
+    DSet newset;
+    Set_init(&newset);
+    for (uint8_t i = 0; i < SET_WORDS; i++){
+        newset->words[i] = set1->words[i] & set2->words[i];
+    }
+    return newset;
+}
+
+
+DSet Set_symmetric_difference(DSet set1,  DSet set2){
+    /* Return a new DSet holding the items that are in either
+       set1 or set2, but not in both.
+    */
+    DSet newset;
+    Set_init(&newset);
+    for (uint8_t i = 0; i < SET_WORDS; i++){
+        newset->words[i] = set1->words[i] ^ set2->words[i];
+    }
+    return newset;
+}
+
+
+void Set_union_into(DSet target, DSet other){
+    /* Add all the items in other to target */
+    for (uint8_t i = 0; i < SET_WORDS; i++){
+        target->words[i] |= other->words[i];
+    }
+}
+
+
+void Set_difference_into(DSet target, DSet other){
+    /* Remove from target all the items that are in other */
+    for (uint8_t i = 0; i < SET_WORDS; i++){
+        target->words[i] &= ~other->words[i];
+    }
+}
+
+
+void Set_intersection_into(DSet target, DSet other){
+    /* Remove from target all the items that aren't in other */
+    for (uint8_t i = 0; i < SET_WORDS; i++){
+        target->words[i] &= other->words[i];
+    }
+}
+
+
+void Set_symmetric_difference_into(DSet target, DSet other){
+    /* Make target hold the items that were either in target or
+       in other, but not in both.
+    */
+    for (uint8_t i = 0; i < SET_WORDS; i++){
+        target->words[i] ^= other->words[i];
+    }
+}
+
+
+void Set_destroy(DSet *the_set){
+    /* Deallocate all associated heap memory and set
+       *the_set to NULL
+    */
+    if (!(*the_set)){
+        return;
+    }
+    free(*the_set);
+    *the_set = NULL;
+}
+
+#endif
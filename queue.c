@@ -35,18 +35,47 @@
     Queue 'underflow', is, on the other hand, accounted for, as Queue_dequeue() 
     will return a NULL pointer when called on an empty queue.
 
+    --------------Blocks--------------------
+    Rather than a linked list of items, one malloc per item, the queue
+    is a linked list of blocks of QUEUE_BLOCK_ITEMS contents pointers
+    each. Items are enqueued at tail_index in the tail block and dequeued
+    from head_index in the head block; a new block is only linked in
+    when the tail block is full, and the head block is only unlinked
+    once it's been drained. That's one allocation per QUEUE_BLOCK_ITEMS
+    items rather than one per item, and dequeueing walks consecutive
+    pointers in memory rather than chasing one per item.
+
+    A drained block isn't freed, but kept as the queue's spare, and used
+    as the next tail block: a queue that items flow through at a steady
+    rate thus ends up allocating nothing at all.
+
+    QueueItems still exist for the sake of Queue_make_item() and
+    Queue_enqueue(): Queue_enqueue() copies the item's contents into
+    the tail block, and frees the item right away, rather than when it's
+    dequeued. Queue_enqueue_value() skips the QueueItem altogether.
+
 */
 
 
+#define QUEUE_BLOCK_ITEMS 128
+
+
+struct queueblock{
+    void *contents[QUEUE_BLOCK_ITEMS];
+    struct queueblock *next;
+};
+
 struct queue{
     unsigned int count;     // number of items in the queue
-    QueueItem head;
-    QueueItem tail;
+    struct queueblock *head;    // block the oldest item is in
+    struct queueblock *tail;    // block the next item goes in
+    unsigned int head_index;    // index of the oldest item in head
+    unsigned int tail_index;    // index the next item goes at in tail
+    struct queueblock *spare;   // a drained block, kept for reuse, or NULL
 };
     
 struct queueitem{
     void *contents;     // a void pointer is used so that any type can be pointed to and thus enqueued;
-    QueueItem next;
 };
 
 
@@ -61,7 +90,8 @@ void Queue_init(Queue *queue_ptr){
        Takes a Queue reference pointer and calls malloc to allocate
        heap space for a Queue struct. If successful, 
        the, the inner members are initialized to zero
-       or NULL, as appropriate.
+       or NULL, as appropriate. The first block is only
+       allocated with the first item.
     */
     Queue temp = malloc(sizeof(struct queue));
 
@@ -74,6 +104,9 @@ void Queue_init(Queue *queue_ptr){
     (*queue_ptr)->count = 0;
     (*queue_ptr)->head = NULL;
     (*queue_ptr)->tail= NULL;
+    (*queue_ptr)->head_index = 0;
+    (*queue_ptr)->tail_index = 0;
+    (*queue_ptr)->spare = NULL;
 };
 
 
@@ -88,33 +121,29 @@ unsigned int Queue_count(Queue the_queue){
 
 
 void Queue_destroy(Queue *queue_ptr){
-    /* Call free on *queue_ptr, and set it to NULL. 
+    /* Free all the blocks, then call free on *queue_ptr,
+       and set it to NULL. 
 
-       Note that the QueueItems in the queue aren't malloc'ed
-       but declared manually outside the queue, and so 
-       there's nothing else to free.
+       What the items point to isn't freed: it's up
+       to the caller.
     */
     // nothing to free, there's no queue (queue is NULL)
     if (!(*queue_ptr)){
         return;
     }
 
-    // there are still items on the queue -- free all of them
-    if ((*queue_ptr)->head){
-        QueueItem current = (*queue_ptr)->head;
-        QueueItem temp;
-        while (current){
-            temp = current;
-            current = temp->next;
-            free(temp);
-        };
-    }
-
-    // else there's a queue, but it's empty (Queue but no QueueItems). Deallocate that
-    if (*queue_ptr){
-        free(*queue_ptr);
-        *queue_ptr = NULL;
+    // free the blocks still in the queue, and the spare one
+    struct queueblock *current = (*queue_ptr)->head;
+    struct queueblock *temp;
+    while (current){
+        temp = current;
+        current = temp->next;
+        free(temp);
     };
+    free((*queue_ptr)->spare);
+
+    free(*queue_ptr);
+    *queue_ptr = NULL;
 };
 
 
@@ -125,27 +154,64 @@ QueueItem Queue_make_item(void *the_value){
 
     if (newitem){
         newitem->contents = the_value;
-        newitem->next = NULL;
     }
     return newitem;
 }
 
 
-void Queue_enqueue(Queue the_queue, QueueItem the_item){
+bool Queue_enqueue(Queue the_queue, QueueItem the_item){
     /* Add an item to the queue.
 
        the_item needs to have been created with a call
-       to Queue_make_item(). 
+       to Queue_make_item(). Its contents are copied into
+       the queue, and the item itself is freed.
+
+       Returns false if there was no memory for the copy:
+       the queue is then unchanged, and the item still
+       belongs to the caller, who must enqueue it again
+       or free it.
     */
-    if (!the_queue->count){
-        the_queue->head = the_item, the_queue->tail = the_item;
-    }else{
-        QueueItem *temp;
-        the_queue->tail->next = the_item;
-        the_queue->tail = the_item; 
-    };
+    if (!Queue_enqueue_value(the_queue, the_item->contents)){
+        return false;
+    }
+    free(the_item);
+    return true;
+};
 
+
+
+bool Queue_enqueue_value(Queue the_queue, void *the_value){
+    /* Add the_value to the queue, straight into the tail block.
+       A new block (the spare one, if there is one) is linked in
+       when the tail block is full.
+
+       Returns false, with the queue unchanged, if a new block
+       was needed and couldn't be allocated.
+    */
+    if (!the_queue->tail || the_queue->tail_index == QUEUE_BLOCK_ITEMS){
+        struct queueblock *block = the_queue->spare;
+        if (block){
+            the_queue->spare = NULL;
+        }
+        else if (!(block = malloc(sizeof(struct queueblock)))){
+            return false;
+        }
+        block->next = NULL;
+
+        if (the_queue->tail){
+            the_queue->tail->next = block;
+        }
+        else{   // the queue has no blocks at all: this one is the head too
+            the_queue->head = block;
+            the_queue->head_index = 0;
+        }
+        the_queue->tail = block;
+        the_queue->tail_index = 0;
+    }
+
+    the_queue->tail->contents[the_queue->tail_index++] = the_value;
     the_queue->count++;
+    return true;
 };
 
 
@@ -158,27 +224,37 @@ void *Queue_dequeue(Queue the_queue){
        If called on an empty queue, NULL is returned.
 
         NOTE
-        what's returned is not a QueueItem, but its 'contents'
-        field, which is a void pointer. This is the value that
-        was passed to Queue_make_item(), the result of which
-        was then appended to the queue with Queue_enqueue().
-
-        In other words, Queue_dequeue() returns
-        the_queue->head->contents, not the_queue->head.
-        the_queue->head gets deallocated.
+        what's returned is the value that was passed to 
+        Queue_make_item() (or to Queue_enqueue_value()),
+        not a QueueItem.
+
+        Once the head block has been drained, it's unlinked, 
+        and kept as the spare block (or freed, if there already
+        is one).
     */
     if (!the_queue->count){
-        return the_queue->head;
+        return NULL;
     }
-    void *item = the_queue->head->contents;
-    QueueItem temp = the_queue->head;
-    the_queue->head = the_queue->head->next;    // if this was the only item in the queue, its 'next' will have been
-                                                // set to NULL, so this takes care of setting head to NULL as well
-    free(temp);
+    void *item = the_queue->head->contents[the_queue->head_index++];
     the_queue->count--;
     
-    if (!the_queue->count){    // if the queue is empty, then the tail needs to be NULL, just as the head
-        the_queue->tail = NULL;
+    if (the_queue->head_index == QUEUE_BLOCK_ITEMS || !the_queue->count){
+        struct queueblock *drained = the_queue->head;
+        if (the_queue->count){
+            the_queue->head = drained->next;
+            the_queue->head_index = 0;
+        }
+        else{   // the queue is empty: the tail block is the head block, and it's gone as well
+            the_queue->head = the_queue->tail = NULL;
+            the_queue->head_index = the_queue->tail_index = 0;
+        }
+
+        if (the_queue->spare){
+            free(drained);
+        }
+        else{
+            the_queue->spare = drained;
+        }
     };
     return item; 
 };
@@ -193,21 +269,8 @@ void *Queue_peek(Queue the_queue){
 
        Returns NULL if called on an empty queue.
     */
-    if (!the_queue){
+    if (!the_queue || !the_queue->count){
         return NULL;
     }
-    return the_queue->head->contents;
+    return the_queue->head->contents[the_queue->head_index];
 };
-
-
-
-
-
-
-
-
-
-
-
-
-
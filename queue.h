@@ -1,12 +1,20 @@
 #ifndef Q_H
 #define Q_H
 
+#include <stdbool.h>
+
 /* Implementation of a queue ADT (Abstract Data Type). 
  * A queue organizes its data in a FIFO -- First-in-first-out - manner, 
  * always removing ('dequeing', in queue terminology) 
  * the oldest item (the item that was 'enqued' first). 
 */
 
+/* The items are stored in fixed-size blocks of pointers, linked
+ * together, rather than one by one: Queue_enqueue_value() is the fast way
+ * in, which allocates nothing but a block now and then. Queue_make_item()
+ * and Queue_enqueue() still work as they used to.
+*/
+
 struct queue;
 struct queueitem;
 typedef struct queue *Queue; 
@@ -16,7 +24,8 @@ void Queue_init(Queue *queue_ptr);  // initialize a queue object
 
 void Queue_destroy(Queue *queue_ptr);  // tear down the queue object by freeing all the malloc-ated memory
 QueueItem Queue_make_item(void *the_value);
-void Queue_enqueue(Queue the_queue, QueueItem the_item);  // add a new item to the queue
+bool Queue_enqueue(Queue the_queue, QueueItem the_item);  // add a new item to the queue; false if out of memory, the item then still the caller's
+bool Queue_enqueue_value(Queue the_queue, void *the_value);  // add the_value to the queue, without a QueueItem; false if out of memory
 void *Queue_dequeue(Queue the_queue);  // remove and return the oldest (i.e. next)item in the queue
 void *Queue_peek(Queue the_queue);  // return the oldest item in the list, but without removing it
 unsigned int Queue_count(Queue the_queue); // return the number of items in the queue
@@ -0,0 +1,247 @@
+#include "radix_heap.h"
+#include <stdlib.h>
+
+/* ************************* Implementation notes ************************** */
+/*
+   The heap remembers the last key popped, 'last' (0 to begin with).
+   An item with key k goes into bucket 0 if k == last, and otherwise
+   into bucket b, where b-1 is the position of the highest bit in which
+   k differs from last (so b is 1 to 64). All the keys in bucket b are
+   thus in [last, ...) and share their top 64-b bits with last, and
+   every key in bucket b is smaller than every key in bucket b+1.
+
+   Popping takes from bucket 0 if it has anything. Otherwise, the first
+   non-empty bucket b holds the smallest keys: its smallest key becomes
+   the new last, and all its items are put back into buckets according
+   to the new last. Since they all share their top 64-b bits with it
+   and differ from it in a lower bit than before (if at all), they all
+   land in buckets below b, and the smallest one(s) in bucket 0. Keys in
+   the other buckets keep their bucket: the bits that decide it don't
+   change. Each item can only move down, so at most 64 times.
+
+   Finding the first non-empty bucket is a count-trailing-zeros on a
+   bitmask of non-empty buckets (bucket 0 is checked first, on its own).
+
+   Peeking must not move last, or keys between last and the one peeked
+   at would be refused by later inserts although nothing was popped. So
+   when bucket 0 is empty, peeking only scans the first non-empty bucket
+   for its smallest key, and keeps it in 'smallest' until the next pop
+   (an insert of a smaller key updates it), so that peeking over and
+   over doesn't rescan the bucket.
+
+   Each bucket is a growable array of (key, payload) entries, used as
+   a stack: the order within a bucket doesn't matter.
+*/
+
+#define RHEAP_BUCKETS 65
+#define RHEAP_INITIAL_BUCKET_SIZE 8
+
+
+struct rheap_entry{
+    uint64_t key;
+    void *payload;
+};
+
+struct rheap_bucket{
+    struct rheap_entry *entries;
+    uint64_t count;
+    uint64_t capacity;
+};
+
+struct radix_heap{
+    struct rheap_bucket buckets[RHEAP_BUCKETS];
+    uint64_t non_empty;     // bit b-1 set if bucket b (1 to 64) has entries
+    uint64_t last;          // last key popped
+    uint64_t smallest;      // smallest key in the heap, if has_smallest
+    bool has_smallest;      // smallest is known (it's reset by pops)
+    uint64_t count;         // number of entries in all the buckets
+};
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static inline uint32_t RHeap_highest_bit(uint64_t word){
+    /* Position of the highest set bit in word, which must not be 0 */
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(word);
+#else
+    uint32_t position = 0;
+    while (word >>= 1){
+        position++;
+    }
+    return position;
+#endif
+}
+
+
+static inline uint32_t RHeap_lowest_bit(uint64_t word){
+    /* Position of the lowest set bit in word, which must not be 0 */
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    uint32_t position = 0;
+    while (!(word & 1)){
+        word >>= 1;
+        position++;
+    }
+    return position;
+#endif
+}
+
+
+static inline uint32_t RHeap_bucket_of(RHeap the_heap, uint64_t key){
+    /* The bucket key goes in, relative to the last key popped */
+    uint64_t differ = key ^ the_heap->last;
+    return differ ? RHeap_highest_bit(differ) + 1 : 0;
+}
+
+
+static void RHeap_push(RHeap the_heap, uint32_t bucket_index, struct rheap_entry entry){
+    /* Add entry to a bucket, growing it if need be */
+    struct rheap_bucket *bucket = &the_heap->buckets[bucket_index];
+    if (bucket->count == bucket->capacity){
+        uint64_t capacity = bucket->capacity ? bucket->capacity * 2 : RHEAP_INITIAL_BUCKET_SIZE;
+        struct rheap_entry *temp = realloc(bucket->entries, sizeof(struct rheap_entry) * capacity);
+        if (!temp){
+            exit(EXIT_FAILURE);
+        }
+        bucket->entries = temp;
+        bucket->capacity = capacity;
+    }
+    bucket->entries[bucket->count++] = entry;
+    if (bucket_index){
+        the_heap->non_empty |= (uint64_t)1 << (bucket_index - 1);
+    }
+}
+
+
+static uint64_t RHeap_bucket_min(RHeap the_heap){
+    /* Bucket 0 is empty: return the smallest key in the first non-empty
+       bucket, which is the smallest in the heap. The heap must not be empty.
+    */
+    struct rheap_bucket *bucket = &the_heap->buckets[RHeap_lowest_bit(the_heap->non_empty) + 1];
+    uint64_t smallest = bucket->entries[0].key;
+    for (uint64_t i = 1; i < bucket->count; i++){
+        smallest = (bucket->entries[i].key < smallest) ? bucket->entries[i].key : smallest;
+    }
+    return smallest;
+}
+
+
+static void RHeap_refill(RHeap the_heap){
+    /* Bucket 0 is empty: make the smallest key in the first non-empty
+       bucket the new last, and redistribute that bucket (see the notes
+       at the top). The heap must not be empty.
+    */
+    uint32_t bucket_index = RHeap_lowest_bit(the_heap->non_empty) + 1;
+    struct rheap_bucket *bucket = &the_heap->buckets[bucket_index];
+
+    the_heap->last = the_heap->has_smallest ? the_heap->smallest : RHeap_bucket_min(the_heap);
+
+    // the bucket is emptied first: its entries all go to lower buckets, never back into it
+    uint64_t count = bucket->count;
+    bucket->count = 0;
+    the_heap->non_empty &= ~((uint64_t)1 << (bucket_index - 1));
+    for (uint64_t i = 0; i < count; i++){
+        struct rheap_entry entry = bucket->entries[i];
+        RHeap_push(the_heap, RHeap_bucket_of(the_heap, entry.key), entry);
+    }
+}
+ 
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+void RHeap_init(RHeap *heap_ref){
+    /* Allocate an empty radix heap */
+    RHeap new_heap = malloc(sizeof(struct radix_heap));
+    if (!new_heap){
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t i = 0; i < RHEAP_BUCKETS; i++){
+        new_heap->buckets[i].entries = NULL;
+        new_heap->buckets[i].count = new_heap->buckets[i].capacity = 0;
+    }
+    new_heap->non_empty = 0;
+    new_heap->last = 0;
+    new_heap->smallest = 0;
+    new_heap->has_smallest = false;
+    new_heap->count = 0;
+    *heap_ref = new_heap;
+}
+
+
+uint64_t RHeap_count(RHeap the_heap){
+    return the_heap->count;
+}
+
+
+bool RHeap_insert(RHeap the_heap, uint64_t key, void *payload){
+    /* Insert key, with payload, in O(1).
+       Return false, inserting nothing, if key is smaller than the last
+       key popped: the heap only works for keys that never decrease.
+    */
+    if (key < the_heap->last){
+        return false;
+    }
+    struct rheap_entry entry = {key, payload};
+    RHeap_push(the_heap, RHeap_bucket_of(the_heap, key), entry);
+    the_heap->count++;
+    if (the_heap->has_smallest && key < the_heap->smallest){
+        the_heap->smallest = key;
+    }
+    return true;
+}
+
+
+uint64_t RHeap_peek(RHeap the_heap){
+    /* Return the smallest key, without popping it, and without changing
+       which keys can still be inserted (see the notes at the top).
+       It's up to the caller to make sure the heap isn't empty.
+    */
+    if (the_heap->buckets[0].count){
+        return the_heap->last;
+    }
+    if (!the_heap->has_smallest){
+        the_heap->smallest = RHeap_bucket_min(the_heap);
+        the_heap->has_smallest = true;
+    }
+    return the_heap->smallest;
+}
+
+
+uint64_t RHeap_pop(RHeap the_heap, void **payload){
+    /* Remove and return the smallest key, storing its payload in
+       *payload (unless payload is NULL). O(log C) amortized.
+       It's up to the caller to make sure the heap isn't empty.
+    */
+    if (!the_heap->buckets[0].count){
+        RHeap_refill(the_heap);
+    }
+    struct rheap_bucket *bucket = &the_heap->buckets[0];
+    struct rheap_entry entry = bucket->entries[--bucket->count];
+    the_heap->count--;
+    the_heap->has_smallest = false;
+
+    if (payload){
+        *payload = entry.payload;
+    }
+    return entry.key;
+}
+
+
+void RHeap_destroy(RHeap *heap_ref){
+    /* Free all memory associated with the heap
+       and set *heap_ref to NULL.
+    */
+    if (!(*heap_ref)){
+        return;
+    }
+    for (uint32_t i = 0; i < RHEAP_BUCKETS; i++){
+        free((*heap_ref)->buckets[i].entries);
+    }
+    free(*heap_ref);
+    *heap_ref = NULL;
+}
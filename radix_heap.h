@@ -0,0 +1,49 @@
+#ifndef RADIX_HEAP_H
+#define RADIX_HEAP_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+
+
+/* *********************************************************************** */
+/* ------------------ Monotone radix heap -------------------------------- */
+/* *********************************************************************** */
+/*
+ * A min-heap for unsigned integer keys (timestamps, distances ...) that
+ * only works if the keys popped never decrease: every key inserted must
+ * be at least as large as the last key popped. Event simulations and
+ * Dijkstra's algorithm with integer weights work that way.
+ *
+ * Under that restriction it beats a comparison heap: instead of being
+ * kept in order, items are dropped into one of 65 buckets according to
+ * the highest bit in which their key differs from the last key popped,
+ * so an insert is O(1), and each item is moved between buckets at most
+ * 64 times over its whole life in the heap (in practice, a few times),
+ * which makes a pop O(log C) amortized, C being the range of the keys.
+ *
+ * Each key can carry a payload pointer (e.g. the event it's the
+ * timestamp of), which is handed back when it's popped.
+ *
+ * bench_radix_heap.c times it against the binary heap of minheap_im.h
+ * on monotone workloads.
+ */
+
+typedef struct radix_heap *RHeap;
+
+
+void RHeap_init(RHeap *heap_ref);
+uint64_t RHeap_count(RHeap the_heap);
+bool RHeap_insert(RHeap the_heap, uint64_t key, void *payload);    // false if key is smaller than the last key popped
+uint64_t RHeap_pop(RHeap the_heap, void **payload);    // the heap must not be empty; payload may be NULL
+uint64_t RHeap_peek(RHeap the_heap);   // the smallest key, without popping it; the heap must not be empty
+void RHeap_destroy(RHeap *heap_ref);
+
+
+
+
+
+
+#endif
@@ -0,0 +1,1230 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "roaring_set.h"
+
+/* ********************************************************** */
+/*                  Implementation Notes
+
+    The set is a sorted array of containers, one for each chunk
+    of 65536 values that holds at least one item (see roaring_set.h
+    for the three kinds of container). Finding the container for a
+    value is a binary search on the upper 16 bits of the value, and
+    the lower 16 bits are then looked up in the container.
+
+    Which kind of container a chunk is stored in follows from how
+    many values it holds: up to RSET_ARRAY_MAX values are stored in
+    a sorted array, and more than that in a bitmap, which at that
+    point takes up less space. Inserting and deleting switch between
+    the two as the count crosses that threshold.
+    Run containers are only ever made by RSet_optimize(); inserting
+    into or deleting from one turns it back into an array or bitmap
+    first, since runs are meant for data that's mostly read.
+
+    The set operations walk the containers of both sets in order of
+    key, as in the merge step of merge sort. Chunks that are only in
+    one of the sets are copied over (or skipped) as they are; chunks
+    in both are combined container by container:
+    - two arrays are merged,
+    - an array and anything else are combined by looking each value
+      of the array up in the other container,
+    - otherwise both are expanded into 1024-word bitmaps, combined
+      word by word, and the result is stored as an array or a bitmap
+      depending on the resulting popcount.
+    The bitmap loops are straight-line code over 64-bit words, which
+    compilers turn into SIMD instructions.
+
+    Each container keeps its own cardinality, and the set keeps the
+    total, so RSet_size() is O(1).
+
+    Containers with different keys never interact in a set operation,
+    so the *_parallel() variants cut the key space into ranges holding
+    about the same number of containers, combine each range on its own
+    thread, and concatenate the partial results, which are already in
+    order of key. The range boundaries are found with rank queries
+    (binary searches on the container keys of both sets), so no
+    sampling or extra pass over the sets is needed.
+*/
+
+
+#define RSET_ARRAY_MAX 4096         // array containers hold at most this many values
+#define RSET_BITMAP_WORDS 1024      // 65536 bits
+#define RSET_CHUNK_VALUES 65536
+
+#define RSET_MAX_THREADS 64
+#define RSET_MIN_CONTAINERS_PER_THREAD 8    // below this, a thread costs more than it saves
+
+#define RSET_MAGIC "RST1"
+#define RSET_HEADER_SIZE 8          // magic + number of containers
+#define RSET_CONTAINER_HEADER_SIZE 11   // key + type + cardinality + number of entries
+
+
+enum rset_container_type{
+    RSET_ARRAY = 0,
+    RSET_BITMAP = 1,
+    RSET_RUN = 2
+};
+
+// the values start, start+1, ..., start+length
+struct rset_run{
+    uint16_t start;
+    uint16_t length;
+};
+
+struct rset_container{
+    uint16_t key;           // upper 16 bits shared by all the values in the container
+    uint8_t type;           // enum rset_container_type
+    uint32_t cardinality;   // number of values in the container
+    uint32_t length;        // number of entries used: values (array) or runs (run)
+    uint32_t capacity;      // number of entries allocated (array, run)
+    union{
+        uint16_t *array;
+        uint64_t *bitmap;
+        struct rset_run *runs;
+    }data;
+};
+
+struct roaring_set{
+    struct rset_container *containers;  // sorted by key
+    uint32_t count;         // number of containers
+    uint32_t capacity;      // number of containers allocated
+    uint64_t cardinality;   // number of items in the set
+};
+
+
+enum rset_operation{
+    RSET_UNION,
+    RSET_INTERSECTION,
+    RSET_DIFFERENCE
+};
+
+
+
+
+/* ***************************** Private ****************************** */
+/* -------------------------------------------------------------------- */
+
+static void *RSet_alloc_P(size_t bytes){
+    /* malloc() that exits on failure */
+    void *memory = malloc(bytes ? bytes : 1);
+    if (!memory){
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+
+static void *RSet_realloc_P(void *memory, size_t bytes){
+    /* realloc() that exits on failure */
+    memory = realloc(memory, bytes ? bytes : 1);
+    if (!memory){
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+
+static inline uint32_t RSet_popcount_P(uint64_t word){
+    /* Return the number of bits set in word */
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    uint32_t count = 0;
+    while (word){
+        word &= word - 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+
+static inline uint32_t RSet_lowest_bit_P(uint64_t word){
+    /* Position of the lowest set bit in word, which must not be 0 */
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    uint32_t position = 0;
+    while (!(word & 1)){
+        word >>= 1;
+        position++;
+    }
+    return position;
+#endif
+}
+
+
+static uint32_t RSet_bitmap_cardinality_P(const uint64_t words[]){
+    /* Return the number of bits set in a 1024-word bitmap */
+    uint32_t cardinality = 0;
+    for (uint32_t i = 0; i < RSET_BITMAP_WORDS; i++){
+        cardinality += RSet_popcount_P(words[i]);
+    }
+    return cardinality;
+}
+
+
+static void RSet_set_range_P(uint64_t words[], uint32_t first, uint32_t last){
+    /* Set bits first to last (inclusive) in a 1024-word bitmap */
+    uint32_t first_word = first >> 6;
+    uint32_t last_word = last >> 6;
+    uint64_t first_mask = ~(uint64_t)0 << (first & 63);
+    uint64_t last_mask = ~(uint64_t)0 >> (63 - (last & 63));
+
+    if (first_word == last_word){
+        words[first_word] |= first_mask & last_mask;
+        return;
+    }
+    words[first_word] |= first_mask;
+    for (uint32_t i = first_word + 1; i < last_word; i++){
+        words[i] = ~(uint64_t)0;
+    }
+    words[last_word] |= last_mask;
+}
+
+
+static uint32_t RSet_bitmap_runs_P(const uint64_t words[], struct rset_run runs[]){
+    /* Find the runs of consecutive set bits in a 1024-word bitmap.
+       If runs isn't NULL, store them in it. Return how many there are.
+    */
+    uint32_t count = 0;
+    uint32_t position = 0;
+
+    while (position < RSET_CHUNK_VALUES){
+        // next set bit at or after position
+        uint32_t w = position >> 6;
+        uint64_t word = words[w] & (~(uint64_t)0 << (position & 63));
+        while (!word && ++w < RSET_BITMAP_WORDS){
+            word = words[w];
+        }
+        if (w == RSET_BITMAP_WORDS){
+            break;
+        }
+        uint32_t start = (w << 6) + RSet_lowest_bit_P(word);
+
+        // next clear bit after start
+        w = start >> 6;
+        word = ~words[w] & (~(uint64_t)0 << (start & 63));
+        while (!word && ++w < RSET_BITMAP_WORDS){
+            word = ~words[w];
+        }
+        uint32_t end = (w == RSET_BITMAP_WORDS) ? RSET_CHUNK_VALUES : (w << 6) + RSet_lowest_bit_P(word);
+
+        if (runs){
+            runs[count].start = start;
+            runs[count].length = end - start - 1;
+        }
+        count++;
+        position = end;
+    }
+    return count;
+}
+
+
+static uint32_t RSet_array_lower_bound_P(const uint16_t array[], uint32_t length, uint16_t value){
+    /* Return the index of the first value in the sorted array that's >= value */
+    uint32_t low = 0;
+    uint32_t high = length;
+    while (low < high){
+        uint32_t middle = low + (high - low) / 2;
+        if (array[middle] < value){
+            low = middle + 1;
+        }else{
+            high = middle;
+        }
+    }
+    return low;
+}
+
+
+
+/* --------------------------- Containers --------------------------- */
+
+static void RSet_container_free_P(struct rset_container *container){
+    switch (container->type){
+        case RSET_ARRAY: free(container->data.array); break;
+        case RSET_BITMAP: free(container->data.bitmap); break;
+        case RSET_RUN: free(container->data.runs); break;
+    }
+}
+
+
+static bool RSet_container_contains_P(const struct rset_container *container, uint16_t low){
+    /* Return true if the lower 16 bits low are in container */
+    switch (container->type){
+        case RSET_ARRAY:{
+            uint32_t i = RSet_array_lower_bound_P(container->data.array, container->length, low);
+            return i < container->length && container->data.array[i] == low;
+        }
+        case RSET_BITMAP:
+            return (container->data.bitmap[low >> 6] >> (low & 63)) & 1;
+
+        case RSET_RUN:{
+            // last run starting at or before low
+            uint32_t lo = 0;
+            uint32_t hi = container->length;
+            while (lo < hi){
+                uint32_t middle = lo + (hi - lo) / 2;
+                if (container->data.runs[middle].start <= low){
+                    lo = middle + 1;
+                }else{
+                    hi = middle;
+                }
+            }
+            if (!lo){
+                return false;
+            }
+            const struct rset_run *run = &container->data.runs[lo - 1];
+            return low - run->start <= run->length;
+        }
+    }
+    return false;
+}
+
+
+static void RSet_container_to_bitmap_P(const struct rset_container *container, uint64_t words[]){
+    /* Write the values in container into a 1024-word bitmap */
+    if (container->type == RSET_BITMAP){
+        memcpy(words, container->data.bitmap, RSET_BITMAP_WORDS * sizeof(uint64_t));
+        return;
+    }
+    memset(words, 0, RSET_BITMAP_WORDS * sizeof(uint64_t));
+
+    if (container->type == RSET_ARRAY){
+        for (uint32_t i = 0; i < container->length; i++){
+            uint16_t low = container->data.array[i];
+            words[low >> 6] |= (uint64_t)1 << (low & 63);
+        }
+    }else{
+        for (uint32_t i = 0; i < container->length; i++){
+            const struct rset_run *run = &container->data.runs[i];
+            RSet_set_range_P(words, run->start, run->start + run->length);
+        }
+    }
+}
+
+
+static void RSet_container_from_values_P(struct rset_container *container, uint16_t key,
+                                         const uint16_t values[], uint32_t count){
+    /* Make container an array container holding a copy of the count sorted values */
+    container->key = key;
+    container->type = RSET_ARRAY;
+    container->cardinality = container->length = container->capacity = count;
+    container->data.array = RSet_alloc_P(count * sizeof(uint16_t));
+    memcpy(container->data.array, values, count * sizeof(uint16_t));
+}
+
+
+static void RSet_container_from_bitmap_P(struct rset_container *container, uint16_t key,
+                                         const uint64_t words[], uint32_t cardinality){
+    /* Make container hold the cardinality values set in words: as an array
+       if there are few enough of them, as a copy of the bitmap otherwise.
+    */
+    container->key = key;
+    container->cardinality = cardinality;
+
+    if (cardinality <= RSET_ARRAY_MAX){
+        container->type = RSET_ARRAY;
+        container->length = container->capacity = cardinality;
+        container->data.array = RSet_alloc_P(cardinality * sizeof(uint16_t));
+
+        uint32_t index = 0;
+        for (uint32_t i = 0; i < RSET_BITMAP_WORDS; i++){
+            uint64_t word = words[i];
+            while (word){
+                container->data.array[index++] = (i << 6) + RSet_lowest_bit_P(word);
+                word &= word - 1;
+            }
+        }
+    }else{
+        container->type = RSET_BITMAP;
+        container->length = container->capacity = RSET_BITMAP_WORDS;
+        container->data.bitmap = RSet_alloc_P(RSET_BITMAP_WORDS * sizeof(uint64_t));
+        memcpy(container->data.bitmap, words, RSET_BITMAP_WORDS * sizeof(uint64_t));
+    }
+}
+
+
+static void RSet_container_clone_P(struct rset_container *copy, const struct rset_container *original){
+    /* Make copy a deep copy of original */
+    size_t bytes = 0;
+    switch (original->type){
+        case RSET_ARRAY: bytes = original->length * sizeof(uint16_t); break;
+        case RSET_BITMAP: bytes = RSET_BITMAP_WORDS * sizeof(uint64_t); break;
+        case RSET_RUN: bytes = original->length * sizeof(struct rset_run); break;
+    }
+    *copy = *original;
+    copy->capacity = original->length;
+    copy->data.array = RSet_alloc_P(bytes);     // all the members of data are pointers: any one will do
+    memcpy(copy->data.array, original->data.array, bytes);
+}
+
+
+static void RSet_container_convert_P(struct rset_container *container){
+    /* Re-store container as an array or a bitmap, according to its cardinality */
+    uint64_t words[RSET_BITMAP_WORDS];
+    RSet_container_to_bitmap_P(container, words);
+    RSet_container_free_P(container);
+    RSet_container_from_bitmap_P(container, container->key, words, container->cardinality);
+}
+
+
+static bool RSet_container_insert_P(struct rset_container *container, uint16_t low){
+    /* Add low to container. Return false if it was already there */
+    if (container->type == RSET_RUN){
+        if (RSet_container_contains_P(container, low)){
+            return false;
+        }
+        RSet_container_convert_P(container);
+    }
+
+    if (container->type == RSET_ARRAY){
+        uint32_t i = RSet_array_lower_bound_P(container->data.array, container->length, low);
+        if (i < container->length && container->data.array[i] == low){
+            return false;
+        }
+
+        if (container->cardinality < RSET_ARRAY_MAX){
+            if (container->length == container->capacity){
+                uint32_t capacity = container->capacity ? container->capacity * 2 : 4;
+                container->capacity = (capacity > RSET_ARRAY_MAX) ? RSET_ARRAY_MAX : capacity;
+                container->data.array = RSet_realloc_P(container->data.array, container->capacity * sizeof(uint16_t));
+            }
+            memmove(&container->data.array[i+1], &container->data.array[i], (container->length - i) * sizeof(uint16_t));
+            container->data.array[i] = low;
+            container->length++;
+            container->cardinality++;
+            return true;
+        }
+
+        // the array is full: from here on a bitmap takes less room
+        uint64_t *bitmap = RSet_alloc_P(RSET_BITMAP_WORDS * sizeof(uint64_t));
+        RSet_container_to_bitmap_P(container, bitmap);
+        RSet_container_free_P(container);
+        container->type = RSET_BITMAP;
+        container->length = container->capacity = RSET_BITMAP_WORDS;
+        container->data.bitmap = bitmap;
+    }
+
+    uint64_t bit = (uint64_t)1 << (low & 63);
+    if (container->data.bitmap[low >> 6] & bit){
+        return false;
+    }
+    container->data.bitmap[low >> 6] |= bit;
+    container->cardinality++;
+    return true;
+}
+
+
+static bool RSet_container_remove_P(struct rset_container *container, uint16_t low){
+    /* Remove low from container. Return false if it wasn't there */
+    if (!RSet_container_contains_P(container, low)){
+        return false;
+    }
+    if (container->type == RSET_RUN){
+        RSet_container_convert_P(container);
+    }
+
+    if (container->type == RSET_ARRAY){
+        uint32_t i = RSet_array_lower_bound_P(container->data.array, container->length, low);
+        memmove(&container->data.array[i], &container->data.array[i+1], (container->length - i - 1) * sizeof(uint16_t));
+        container->length--;
+        container->cardinality--;
+        return true;
+    }
+
+    container->data.bitmap[low >> 6] &= ~((uint64_t)1 << (low & 63));
+    container->cardinality--;
+    if (container->cardinality <= RSET_ARRAY_MAX){     // small enough for an array again
+        RSet_container_convert_P(container);
+    }
+    return true;
+}
+
+
+static bool RSet_container_combine_P(const struct rset_container *container1, const struct rset_container *container2,
+                                     enum rset_operation operation, struct rset_container *result){
+    /* Store in result the union, intersection or difference (as per operation)
+       of two containers with the same key.
+       Return false, leaving result untouched, if the result is empty.
+    */
+    uint16_t key = container1->key;
+
+    // two arrays: merge them
+    if (container1->type == RSET_ARRAY && container2->type == RSET_ARRAY
+            && (operation != RSET_UNION || container1->cardinality + container2->cardinality <= RSET_ARRAY_MAX)){
+        uint16_t merged[2 * RSET_ARRAY_MAX];
+        uint32_t count = 0;
+        const uint16_t *values1 = container1->data.array;
+        const uint16_t *values2 = container2->data.array;
+        uint32_t i = 0;
+        uint32_t j = 0;
+
+        while (i < container1->length && j < container2->length){
+            if (values1[i] < values2[j]){
+                if (operation != RSET_INTERSECTION){
+                    merged[count++] = values1[i];
+                }
+                i++;
+            }else if (values2[j] < values1[i]){
+                if (operation == RSET_UNION){
+                    merged[count++] = values2[j];
+                }
+                j++;
+            }else{
+                if (operation != RSET_DIFFERENCE){
+                    merged[count++] = values1[i];
+                }
+                i++, j++;
+            }
+        }
+        if (operation != RSET_INTERSECTION){
+            while (i < container1->length){
+                merged[count++] = values1[i++];
+            }
+        }
+        if (operation == RSET_UNION){
+            while (j < container2->length){
+                merged[count++] = values2[j++];
+            }
+        }
+        if (!count){
+            return false;
+        }
+        RSet_container_from_values_P(result, key, merged, count);
+        return true;
+    }
+
+    // an array and something else: look each value of the array up in the other container
+    if (operation != RSET_UNION && (container1->type == RSET_ARRAY || container2->type == RSET_ARRAY)){
+        const struct rset_container *array = (container1->type == RSET_ARRAY) ? container1 : container2;
+        const struct rset_container *other = (array == container1) ? container2 : container1;
+        bool keep_if_found = (operation == RSET_INTERSECTION);
+
+        if (operation == RSET_INTERSECTION || array == container1){
+            uint16_t kept[RSET_ARRAY_MAX];
+            uint32_t count = 0;
+            for (uint32_t i = 0; i < array->length; i++){
+                if (RSet_container_contains_P(other, array->data.array[i]) == keep_if_found){
+                    kept[count++] = array->data.array[i];
+                }
+            }
+            if (!count){
+                return false;
+            }
+            RSet_container_from_values_P(result, key, kept, count);
+            return true;
+        }
+    }
+
+    // otherwise: expand to bitmaps and combine them word by word
+    uint64_t words1[RSET_BITMAP_WORDS];
+    uint64_t words2[RSET_BITMAP_WORDS];
+    RSet_container_to_bitmap_P(container1, words1);
+    RSet_container_to_bitmap_P(container2, words2);
+
+    switch (operation){
+        case RSET_UNION:
+            for (uint32_t i = 0; i < RSET_BITMAP_WORDS; i++){
+                words1[i] |= words2[i];
+            }
+            break;
+        case RSET_INTERSECTION:
+            for (uint32_t i = 0; i < RSET_BITMAP_WORDS; i++){
+                words1[i] &= words2[i];
+            }
+            break;
+        case RSET_DIFFERENCE:
+            for (uint32_t i = 0; i < RSET_BITMAP_WORDS; i++){
+                words1[i] &= ~words2[i];
+            }
+            break;
+    }
+
+    uint32_t cardinality = RSet_bitmap_cardinality_P(words1);
+    if (!cardinality){
+        return false;
+    }
+    RSet_container_from_bitmap_P(result, key, words1, cardinality);
+    return true;
+}
+
+
+static uint32_t RSet_container_intersection_size_P(const struct rset_container *container1,
+                                                   const struct rset_container *container2){
+    /* Return the number of values in both containers, without building the intersection */
+    uint32_t count = 0;
+
+    if (container1->type == RSET_ARRAY && container2->type == RSET_ARRAY){
+        uint32_t i = 0;
+        uint32_t j = 0;
+        while (i < container1->length && j < container2->length){
+            if (container1->data.array[i] < container2->data.array[j]){
+                i++;
+            }else if (container2->data.array[j] < container1->data.array[i]){
+                j++;
+            }else{
+                count++;
+                i++, j++;
+            }
+        }
+        return count;
+    }
+
+    if (container1->type == RSET_ARRAY || container2->type == RSET_ARRAY){
+        const struct rset_container *array = (container1->type == RSET_ARRAY) ? container1 : container2;
+        const struct rset_container *other = (array == container1) ? container2 : container1;
+        for (uint32_t i = 0; i < array->length; i++){
+            count += RSet_container_contains_P(other, array->data.array[i]);
+        }
+        return count;
+    }
+
+    uint64_t words1[RSET_BITMAP_WORDS];
+    uint64_t words2[RSET_BITMAP_WORDS];
+    RSet_container_to_bitmap_P(container1, words1);
+    RSet_container_to_bitmap_P(container2, words2);
+    for (uint32_t i = 0; i < RSET_BITMAP_WORDS; i++){
+        count += RSet_popcount_P(words1[i] & words2[i]);
+    }
+    return count;
+}
+
+
+
+/* --------------------------- The set ---------------------------- */
+
+static uint32_t RSet_find_container_P(RSet the_set, uint16_t key){
+    /* Return the index of the container for key, or, if there isn't one,
+       the index where it would have to be inserted.
+    */
+    uint32_t low = 0;
+    uint32_t high = the_set->count;
+    while (low < high){
+        uint32_t middle = low + (high - low) / 2;
+        if (the_set->containers[middle].key < key){
+            low = middle + 1;
+        }else{
+            high = middle;
+        }
+    }
+    return low;
+}
+
+
+static struct rset_container *RSet_make_room_P(RSet the_set, uint32_t index){
+    /* Open up a slot for a new container at index, and return it */
+    if (the_set->count == the_set->capacity){
+        the_set->capacity = the_set->capacity ? the_set->capacity * 2 : 4;
+        the_set->containers = RSet_realloc_P(the_set->containers, the_set->capacity * sizeof(struct rset_container));
+    }
+    memmove(&the_set->containers[index+1], &the_set->containers[index],
+            (the_set->count - index) * sizeof(struct rset_container));
+    the_set->count++;
+    return &the_set->containers[index];
+}
+
+
+static void RSet_remove_container_P(RSet the_set, uint32_t index){
+    /* Free the container at index and close up the gap */
+    RSet_container_free_P(&the_set->containers[index]);
+    memmove(&the_set->containers[index], &the_set->containers[index+1],
+            (the_set->count - index - 1) * sizeof(struct rset_container));
+    the_set->count--;
+}
+
+
+static void RSet_append_P(RSet the_set, const struct rset_container *container){
+    /* Add container after the last one. Its key must be larger than theirs */
+    *RSet_make_room_P(the_set, the_set->count) = *container;
+    the_set->cardinality += container->cardinality;
+}
+
+
+static void RSet_combine_range_P(RSet set1, uint32_t i, uint32_t end1, RSet set2, uint32_t j, uint32_t end2,
+                                 enum rset_operation operation, RSet result){
+    /* Append to result the union, intersection or difference of
+       containers i to end1 (exclusive) of set1 and containers j to
+       end2 of set2, walking both in order of key.
+       result must be empty, or only hold keys smaller than these.
+    */
+    struct rset_container container;
+
+    while (i < end1 || j < end2){
+        if (j == end2 || (i < end1 && set1->containers[i].key < set2->containers[j].key)){
+            // chunk only in set1
+            if (operation != RSET_INTERSECTION){
+                RSet_container_clone_P(&container, &set1->containers[i]);
+                RSet_append_P(result, &container);
+            }
+            i++;
+        }
+        else if (i == end1 || set2->containers[j].key < set1->containers[i].key){
+            // chunk only in set2
+            if (operation == RSET_UNION){
+                RSet_container_clone_P(&container, &set2->containers[j]);
+                RSet_append_P(result, &container);
+            }
+            j++;
+        }
+        else{
+            if (RSet_container_combine_P(&set1->containers[i], &set2->containers[j], operation, &container)){
+                RSet_append_P(result, &container);
+            }
+            i++, j++;
+        }
+    }
+}
+
+
+static RSet RSet_combine_P(RSet set1, RSet set2, enum rset_operation operation){
+    /* Return a new set holding the union, intersection or difference of set1 and set2 */
+    RSet result;
+    RSet_init(&result);
+    RSet_combine_range_P(set1, 0, set1->count, set2, 0, set2->count, operation, result);
+    return result;
+}
+
+
+static uint32_t RSet_rank_P(RSet set1, RSet set2, uint32_t key){
+    /* Return the number of containers, in set1 and set2 together,
+       whose key is smaller than key (which may be 65536)
+    */
+    uint32_t rank = (key > UINT16_MAX) ? set1->count : RSet_find_container_P(set1, key);
+    return rank + ((key > UINT16_MAX) ? set2->count : RSet_find_container_P(set2, key));
+}
+
+
+static uint32_t RSet_splitter_P(RSet set1, RSet set2, uint32_t rank){
+    /* Return the smallest key that has at least rank containers of
+       set1 and set2 below it: a binary search over the 65537
+       possible split points, each step a rank query on both sets.
+    */
+    uint32_t low = 0;
+    uint32_t high = RSET_CHUNK_VALUES;
+    while (low < high){
+        uint32_t middle = low + (high - low) / 2;
+        if (RSet_rank_P(set1, set2, middle) < rank){
+            low = middle + 1;
+        }else{
+            high = middle;
+        }
+    }
+    return low;
+}
+
+
+// a range of keys handed to one worker thread by RSet_combine_parallel_P()
+struct rset_part{
+    RSet set1;
+    RSet set2;
+    uint32_t first1, end1;      // containers of set1 in the range
+    uint32_t first2, end2;      // containers of set2 in the range
+    enum rset_operation operation;
+    RSet result;
+};
+
+
+static void *RSet_combine_part_P(void *arg){
+    /* Thread body: combine the containers of one part into part->result */
+    struct rset_part *part = arg;
+    RSet_combine_range_P(part->set1, part->first1, part->end1, part->set2, part->first2, part->end2,
+                         part->operation, part->result);
+    return NULL;
+}
+
+
+static RSet RSet_combine_parallel_P(RSet set1, RSet set2, enum rset_operation operation, uint32_t threads){
+    /* Same as RSet_combine_P(), with the work split across threads.
+
+       The key space is cut into one range per thread, such that each
+       range holds about the same number of containers of the two sets
+       together (see RSet_splitter_P()). Containers with different keys
+       never interact, so each range is combined on its own thread into
+       a partial result, and the partial results, which come out in
+       order of key, are then concatenated.
+    */
+    uint32_t total = set1->count + set2->count;
+    if (threads > total / RSET_MIN_CONTAINERS_PER_THREAD){
+        threads = total / RSET_MIN_CONTAINERS_PER_THREAD;
+    }
+    if (threads > RSET_MAX_THREADS){
+        threads = RSET_MAX_THREADS;
+    }
+    if (threads <= 1){
+        return RSet_combine_P(set1, set2, operation);
+    }
+
+    struct rset_part parts[RSET_MAX_THREADS];
+    pthread_t workers[RSET_MAX_THREADS];
+    bool started[RSET_MAX_THREADS];
+
+    for (uint32_t t = 0; t < threads; t++){
+        uint32_t end_key = (t == threads - 1) ? RSET_CHUNK_VALUES
+                         : RSet_splitter_P(set1, set2, (uint32_t)((uint64_t)total * (t + 1) / threads));
+        struct rset_part *part = &parts[t];
+        part->set1 = set1;
+        part->set2 = set2;
+        part->first1 = (t == 0) ? 0 : parts[t-1].end1;
+        part->first2 = (t == 0) ? 0 : parts[t-1].end2;
+        part->end1 = (end_key > UINT16_MAX) ? set1->count : RSet_find_container_P(set1, end_key);
+        part->end2 = (end_key > UINT16_MAX) ? set2->count : RSet_find_container_P(set2, end_key);
+        part->operation = operation;
+        RSet_init(&part->result);
+
+        // if a thread can't be started, its part is done on this one
+        started[t] = !pthread_create(&workers[t], NULL, RSet_combine_part_P, part);
+        if (!started[t]){
+            RSet_combine_part_P(part);
+        }
+    }
+
+    RSet result;
+    RSet_init(&result);
+    for (uint32_t t = 0; t < threads; t++){
+        if (started[t]){
+            pthread_join(workers[t], NULL);
+        }
+        RSet part_result = parts[t].result;
+        for (uint32_t c = 0; c < part_result->count; c++){
+            RSet_append_P(result, &part_result->containers[c]);     // the containers move over as they are
+        }
+        part_result->count = 0;
+        RSet_destroy(&parts[t].result);
+    }
+    return result;
+}
+
+
+static void RSet_put_P(uint8_t **cursor, uint64_t value, uint8_t bytes){
+    /* Write the lowest bytes of value at *cursor, little-endian, and advance it */
+    for (uint8_t i = 0; i < bytes; i++){
+        *(*cursor)++ = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+
+static uint64_t RSet_get_P(const uint8_t **cursor, uint8_t bytes){
+    /* Read a little-endian integer of the given size at *cursor, and advance it */
+    uint64_t value = 0;
+    for (uint8_t i = 0; i < bytes; i++){
+        value |= (uint64_t)*(*cursor)++ << (8 * i);
+    }
+    return value;
+}
+
+
+static size_t RSet_payload_size_P(const struct rset_container *container){
+    /* Number of bytes the entries of container take up when serialized */
+    switch (container->type){
+        case RSET_ARRAY: return container->length * 2;
+        case RSET_BITMAP: return RSET_BITMAP_WORDS * 8;
+        case RSET_RUN: return container->length * 4;
+    }
+    return 0;
+}
+
+
+static bool RSet_read_container_P(const uint8_t **cursor, const uint8_t *end, struct rset_container *container){
+    /* Read one serialized container at *cursor into container,
+       checking that it's well-formed and doesn't run past end.
+       Return false (with nothing allocated) if it isn't.
+    */
+    if (end - *cursor < RSET_CONTAINER_HEADER_SIZE){
+        return false;
+    }
+    container->key = RSet_get_P(cursor, 2);
+    container->type = RSet_get_P(cursor, 1);
+    container->cardinality = RSet_get_P(cursor, 4);
+    container->length = RSet_get_P(cursor, 4);
+
+    if (container->type > RSET_RUN || container->length > RSET_CHUNK_VALUES || !container->cardinality){
+        return false;
+    }
+    if ((size_t)(end - *cursor) < RSet_payload_size_P(container)){
+        return false;
+    }
+
+    switch (container->type){
+        case RSET_ARRAY:{
+            if (container->length != container->cardinality || container->length > RSET_ARRAY_MAX){
+                return false;
+            }
+            container->capacity = container->length;
+            container->data.array = RSet_alloc_P(container->length * sizeof(uint16_t));
+            for (uint32_t i = 0; i < container->length; i++){
+                container->data.array[i] = RSet_get_P(cursor, 2);
+                if (i && container->data.array[i] <= container->data.array[i-1]){   // must be strictly ascending
+                    free(container->data.array);
+                    return false;
+                }
+            }
+            return true;
+        }
+        case RSET_BITMAP:{
+            uint64_t words[RSET_BITMAP_WORDS];
+            if (container->length != RSET_BITMAP_WORDS){
+                return false;
+            }
+            for (uint32_t i = 0; i < RSET_BITMAP_WORDS; i++){
+                words[i] = RSet_get_P(cursor, 8);
+            }
+            if (RSet_bitmap_cardinality_P(words) != container->cardinality){
+                return false;
+            }
+            RSet_container_from_bitmap_P(container, container->key, words, container->cardinality);
+            return true;
+        }
+        case RSET_RUN:{
+            uint32_t cardinality = 0;
+            uint32_t next_free = 0;     // runs must be ascending and not touch each other
+            container->capacity = container->length;
+            container->data.runs = RSet_alloc_P(container->length * sizeof(struct rset_run));
+            for (uint32_t i = 0; i < container->length; i++){
+                struct rset_run *run = &container->data.runs[i];
+                run->start = RSet_get_P(cursor, 2);
+                run->length = RSet_get_P(cursor, 2);
+                if (run->start < next_free || (uint32_t)run->start + run->length >= RSET_CHUNK_VALUES){
+                    free(container->data.runs);
+                    return false;
+                }
+                next_free = run->start + run->length + 2;
+                cardinality += run->length + 1;
+            }
+            if (cardinality != container->cardinality){
+                free(container->data.runs);
+                return false;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ---------------------------------------------------------------- */
+/* ***************************** End Private ********************** */
+
+
+
+void RSet_init(RSet *the_set){
+    /* Allocate memory for an RSet and initialize it to the empty set */
+    RSet newset = RSet_alloc_P(sizeof(struct roaring_set));
+    newset->containers = NULL;
+    newset->count = newset->capacity = 0;
+    newset->cardinality = 0;
+    *the_set = newset;
+}
+
+
+uint64_t RSet_size(RSet the_set){
+    /* Return the number of items in the set */
+    return the_set->cardinality;
+}
+
+
+bool RSet_is_empty(RSet the_set){
+    /* Return true if the_set is empty, false otherwise */
+    return the_set->cardinality == 0;
+}
+
+
+bool RSet_contains(RSet the_set, uint32_t the_value){
+    /* Return true if the_value is found in the_set, false otherwise */
+    uint16_t key = the_value >> 16;
+    uint32_t index = RSet_find_container_P(the_set, key);
+    if (index == the_set->count || the_set->containers[index].key != key){
+        return false;
+    }
+    return RSet_container_contains_P(&the_set->containers[index], the_value & 0xFFFF);
+}
+
+
+void RSet_insert(RSet the_set, uint32_t the_value){
+    /* Insert the_value into the set, if not already there */
+    uint16_t key = the_value >> 16;
+    uint32_t index = RSet_find_container_P(the_set, key);
+
+    if (index == the_set->count || the_set->containers[index].key != key){
+        // first value in this chunk: start an empty array container for it
+        struct rset_container *container = RSet_make_room_P(the_set, index);
+        container->key = key;
+        container->type = RSET_ARRAY;
+        container->cardinality = container->length = container->capacity = 0;
+        container->data.array = NULL;
+    }
+    if (RSet_container_insert_P(&the_set->containers[index], the_value & 0xFFFF)){
+        the_set->cardinality++;
+    }
+}
+
+
+void RSet_del(RSet the_set, uint32_t the_value){
+    /* Delete the_value from the_set, if found */
+    uint16_t key = the_value >> 16;
+    uint32_t index = RSet_find_container_P(the_set, key);
+    if (index == the_set->count || the_set->containers[index].key != key){
+        return;
+    }
+
+    struct rset_container *container = &the_set->containers[index];
+    if (RSet_container_remove_P(container, the_value & 0xFFFF)){
+        the_set->cardinality--;
+        if (!container->cardinality){
+            RSet_remove_container_P(the_set, index);
+        }
+    }
+}
+
+
+uint32_t *RSet_items(RSet the_set){
+    /* Returns a dynamically-allocated array containing all the items
+       in the_set (RSet_size() of them), in sorted order.
+       It's the responsibility of the caller to call free() on this
+       returned array when no longer needed.
+    */
+    uint32_t *items_array = RSet_alloc_P(the_set->cardinality * sizeof(uint32_t));
+    uint64_t index = 0;
+
+    for (uint32_t c = 0; c < the_set->count; c++){
+        const struct rset_container *container = &the_set->containers[c];
+        uint32_t high = (uint32_t)container->key << 16;
+
+        switch (container->type){
+            case RSET_ARRAY:
+                for (uint32_t i = 0; i < container->length; i++){
+                    items_array[index++] = high | container->data.array[i];
+                }
+                break;
+            case RSET_BITMAP:
+                for (uint32_t i = 0; i < RSET_BITMAP_WORDS; i++){
+                    uint64_t word = container->data.bitmap[i];
+                    while (word){
+                        items_array[index++] = high | ((i << 6) + RSet_lowest_bit_P(word));
+                        word &= word - 1;
+                    }
+                }
+                break;
+            case RSET_RUN:
+                for (uint32_t i = 0; i < container->length; i++){
+                    const struct rset_run *run = &container->data.runs[i];
+                    for (uint32_t low = run->start; low <= (uint32_t)run->start + run->length; low++){
+                        items_array[index++] = high | low;
+                    }
+                }
+                break;
+        }
+    }
+    return items_array;
+}
+
+
+uint64_t RSet_intersection_size(RSet set1, RSet set2){
+    /* Return the number of items in both set1 and set2 */
+    uint64_t count = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    while (i < set1->count && j < set2->count){
+        if (set1->containers[i].key < set2->containers[j].key){
+            i++;
+        }else if (set2->containers[j].key < set1->containers[i].key){
+            j++;
+        }else{
+            count += RSet_container_intersection_size_P(&set1->containers[i], &set2->containers[j]);
+            i++, j++;
+        }
+    }
+    return count;
+}
+
+
+bool RSet_is_same(RSet set1, RSet set2){
+    /* Return true if set1 and set2 hold exactly the same items */
+    return set1->cardinality == set2->cardinality
+        && RSet_intersection_size(set1, set2) == set1->cardinality;
+}
+
+
+bool RSet_is_subset(RSet set1, RSet set2){
+    /* Return true if set1 is a subset of set2.
+       As with DSet, set1 has to be strictly smaller than set2.
+    */
+    return set1->cardinality < set2->cardinality
+        && RSet_intersection_size(set1, set2) == set1->cardinality;
+}
+
+
+RSet RSet_union(RSet set1, RSet set2){
+    /* Return a new RSet holding the union of set1 and set2 */
+    return RSet_combine_P(set1, set2, RSET_UNION);
+}
+
+
+RSet RSet_intersection(RSet set1, RSet set2){
+    /* Return a new RSet holding the items that are both in set1 and set2 */
+    return RSet_combine_P(set1, set2, RSET_INTERSECTION);
+}
+
+
+RSet RSet_difference(RSet set1, RSet set2){
+    /* Return a new RSet holding the items in set1 that aren't in set2 */
+    return RSet_combine_P(set1, set2, RSET_DIFFERENCE);
+}
+
+
+RSet RSet_union_parallel(RSet set1, RSet set2, uint32_t threads){
+    /* Same as RSet_union(), spread over up to threads threads.
+       Sets too small to be worth splitting are combined on the
+       calling thread.
+    */
+    return RSet_combine_parallel_P(set1, set2, RSET_UNION, threads);
+}
+
+
+RSet RSet_intersection_parallel(RSet set1, RSet set2, uint32_t threads){
+    /* Same as RSet_intersection(), spread over up to threads threads */
+    return RSet_combine_parallel_P(set1, set2, RSET_INTERSECTION, threads);
+}
+
+
+RSet RSet_difference_parallel(RSet set1, RSet set2, uint32_t threads){
+    /* Same as RSet_difference(), spread over up to threads threads */
+    return RSet_combine_parallel_P(set1, set2, RSET_DIFFERENCE, threads);
+}
+
+
+void RSet_optimize(RSet the_set){
+    /* Store each container as a run container if that takes less room
+       than the array or bitmap it's stored in now (or, for a run
+       container that wouldn't be the smallest anymore, the other
+       way around).
+    */
+    uint64_t words[RSET_BITMAP_WORDS];
+
+    for (uint32_t c = 0; c < the_set->count; c++){
+        struct rset_container *container = &the_set->containers[c];
+        RSet_container_to_bitmap_P(container, words);
+
+        uint32_t runs = RSet_bitmap_runs_P(words, NULL);
+        size_t run_bytes = runs * sizeof(struct rset_run);
+        size_t other_bytes = (container->cardinality <= RSET_ARRAY_MAX)
+                           ? container->cardinality * sizeof(uint16_t)
+                           : RSET_BITMAP_WORDS * sizeof(uint64_t);
+
+        if (run_bytes < other_bytes && container->type != RSET_RUN){
+            RSet_container_free_P(container);
+            container->type = RSET_RUN;
+            container->length = container->capacity = runs;
+            container->data.runs = RSet_alloc_P(run_bytes);
+            RSet_bitmap_runs_P(words, container->data.runs);
+        }
+        else if (run_bytes >= other_bytes && container->type == RSET_RUN){
+            RSet_container_free_P(container);
+            RSet_container_from_bitmap_P(container, container->key, words, container->cardinality);
+        }
+    }
+}
+
+
+size_t RSet_serialized_size(RSet the_set){
+    /* Return the number of bytes RSet_serialize() writes */
+    size_t size = RSET_HEADER_SIZE;
+    for (uint32_t c = 0; c < the_set->count; c++){
+        size += RSET_CONTAINER_HEADER_SIZE + RSet_payload_size_P(&the_set->containers[c]);
+    }
+    return size;
+}
+
+
+size_t RSet_serialize(RSet the_set, uint8_t buffer[]){
+    /* Write the_set into buffer in the portable format described in
+       roaring_set.h, and return the number of bytes written.
+       buffer must be at least RSet_serialized_size() bytes long.
+    */
+    uint8_t *cursor = buffer;
+    memcpy(cursor, RSET_MAGIC, 4);
+    cursor += 4;
+    RSet_put_P(&cursor, the_set->count, 4);
+
+    for (uint32_t c = 0; c < the_set->count; c++){
+        const struct rset_container *container = &the_set->containers[c];
+        RSet_put_P(&cursor, container->key, 2);
+        RSet_put_P(&cursor, container->type, 1);
+        RSet_put_P(&cursor, container->cardinality, 4);
+        RSet_put_P(&cursor, container->length, 4);
+
+        switch (container->type){
+            case RSET_ARRAY:
+                for (uint32_t i = 0; i < container->length; i++){
+                    RSet_put_P(&cursor, container->data.array[i], 2);
+                }
+                break;
+            case RSET_BITMAP:
+                for (uint32_t i = 0; i < RSET_BITMAP_WORDS; i++){
+                    RSet_put_P(&cursor, container->data.bitmap[i], 8);
+                }
+                break;
+            case RSET_RUN:
+                for (uint32_t i = 0; i < container->length; i++){
+                    RSet_put_P(&cursor, container->data.runs[i].start, 2);
+                    RSet_put_P(&cursor, container->data.runs[i].length, 2);
+                }
+                break;
+        }
+    }
+    return cursor - buffer;
+}
+
+
+bool RSet_deserialize(RSet *the_set, const uint8_t buffer[], size_t length){
+    /* Build a new RSet out of the length bytes in buffer, written by
+       RSet_serialize(), and store it in *the_set.
+       The data is checked as it's read: if it's malformed or truncated,
+       *the_set is set to NULL and false is returned.
+    */
+    *the_set = NULL;
+    const uint8_t *cursor = buffer;
+    const uint8_t *end = buffer + length;
+
+    if (length < RSET_HEADER_SIZE || memcmp(cursor, RSET_MAGIC, 4)){
+        return false;
+    }
+    cursor += 4;
+    uint32_t count = RSet_get_P(&cursor, 4);
+
+    RSet newset;
+    RSet_init(&newset);
+    struct rset_container container;
+
+    for (uint32_t c = 0; c < count; c++){
+        if (!RSet_read_container_P(&cursor, end, &container)){
+            RSet_destroy(&newset);
+            return false;
+        }
+        RSet_append_P(newset, &container);
+        if (c && container.key <= newset->containers[c-1].key){    // keys must be strictly ascending
+            RSet_destroy(&newset);
+            return false;
+        }
+    }
+
+    *the_set = newset;
+    return true;
+}
+
+
+void RSet_destroy(RSet *the_set){
+    /* Deallocate all associated heap memory and set
+       *the_set to NULL
+    */
+    if (!(*the_set)){
+        return;
+    }
+    for (uint32_t c = 0; c < (*the_set)->count; c++){
+        RSet_container_free_P(&(*the_set)->containers[c]);
+    }
+    free((*the_set)->containers);
+    free(*the_set);
+    *the_set = NULL;
+}
@@ -0,0 +1,90 @@
+#ifndef ROARINGSET_H
+#define ROARINGSET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* ***************************************************************** */
+/*                          * * *                                    */
+/*                 Roaring (compressed) Integer Set
+ *
+ *  This is an implementation of a mutable, sorted Set ADT for
+ *  uint32_t values, stored as a 'roaring bitmap'.
+ *
+ *  The 32-bit range is split into 65536 chunks of 65536 values
+ *  each, keyed by the upper 16 bits of the values they hold. Only
+ *  the chunks that hold at least one value are stored, each in a
+ *  'container' holding the lower 16 bits of its values in one of
+ *  three forms:
+ *   - an array container: a sorted array of uint16_t, used when
+ *     the chunk holds at most 4096 values (2 bytes per value).
+ *   - a bitmap container: 65536 bits, one per possible value,
+ *     used when the chunk holds more than 4096 values (a fixed
+ *     8KB, i.e. less than 2 bytes per value).
+ *   - a run container: a sorted list of [start, start+length]
+ *     runs of consecutive values (4 bytes per run), for chunks
+ *     where the values come clustered together.
+ *     These are only created by RSet_optimize() (and by
+ *     RSet_deserialize(), for containers that were saved as runs).
+ *
+ *  Dense and clustered sets of ids thus take up a couple of bytes
+ *  per value or less, as opposed to the tens of bytes per value a
+ *  tree or a hash table need.
+ *
+ *  Set operations work chunk by chunk. Operations on bitmaps are
+ *  word-wise AND/OR/AND-NOT over 1024 64-bit words, which compilers
+ *  vectorize, and the cardinality is a popcount of those words.
+ *  Since chunks are independent of each other, the set operations
+ *  also come in a parallel version, which hands ranges of chunks to
+ *  worker threads (link with -pthread).
+ *
+ *  Serialization format (all integers little-endian):
+ *      "RST1"                            4 bytes
+ *      number of containers              uint32_t
+ *      then, for each container, in ascending order of key:
+ *          key (upper 16 bits)           uint16_t
+ *          type (0 array, 1 bitmap, 2 run)   uint8_t
+ *          cardinality                   uint32_t
+ *          number of entries             uint32_t
+ *          entries: array -> uint16_t values
+ *                   bitmap -> 1024 uint64_t words
+ *                   run -> uint16_t start, uint16_t length pairs
+ *
+ * *************************************************************** */
+
+typedef struct roaring_set *RSet;
+
+
+void RSet_init(RSet *the_set);
+bool RSet_contains(RSet the_set, uint32_t the_value);
+void RSet_insert(RSet the_set, uint32_t the_value);
+void RSet_del(RSet the_set, uint32_t the_value);
+uint64_t RSet_size(RSet the_set);
+bool RSet_is_empty(RSet the_set);
+uint32_t *RSet_items(RSet the_set);  // returns a dynamically-allocated, sorted array of all the items in the set
+bool RSet_is_same(RSet set1, RSet set2);
+bool RSet_is_subset(RSet set1, RSet set2);
+void RSet_optimize(RSet the_set);   // store each chunk as runs wherever that's smaller
+void RSet_destroy(RSet *the_set);   // destroy an RSet and free all memory associated with it
+
+// set algebra: these return a new RSet, to be destroyed by the caller with RSet_destroy()
+RSet RSet_union(RSet set1, RSet set2);
+RSet RSet_intersection(RSet set1, RSet set2);
+RSet RSet_difference(RSet set1, RSet set2);
+uint64_t RSet_intersection_size(RSet set1, RSet set2);    // same as RSet_size(RSet_intersection()), without building it
+
+// the same set algebra, with the work split by ranges of keys across up to threads threads (pthreads)
+RSet RSet_union_parallel(RSet set1, RSet set2, uint32_t threads);
+RSet RSet_intersection_parallel(RSet set1, RSet set2, uint32_t threads);
+RSet RSet_difference_parallel(RSet set1, RSet set2, uint32_t threads);
+
+// serialization, in the format described above
+size_t RSet_serialized_size(RSet the_set);
+size_t RSet_serialize(RSet the_set, uint8_t buffer[]);    // buffer must hold RSet_serialized_size() bytes
+bool RSet_deserialize(RSet *the_set, const uint8_t buffer[], size_t length);
+
+
+
+#endif
@@ -0,0 +1,270 @@
+#include "timing_wheel.h"
+#include <stdlib.h>
+
+/* ************************* Implementation notes ************************** */
+/*
+   The wheel has WHEEL_LEVELS levels of WHEEL_SLOTS (64) slots each. A
+   slot on level 0 stands for one tick, a slot on level 1 for 64 ticks,
+   on level 2 for 64^2 ticks, and on level 3 for 64^3: together they
+   cover the next 64^4 = 2^24 ticks. Timers further away than that go
+   on an overflow list.
+
+   A timer is put on the lowest level whose range reaches its deadline,
+   in the slot given by the bits of the deadline for that level: bits
+   0-5 on level 0, bits 6-11 on level 1, and so on. That's O(1).
+
+   Each tick, the clock moves on by one, and the level-0 slot for the
+   new time fires all its timers. Every 64 ticks, when the level-0 bits
+   of the time wrap around to 0, the level-1 slot for the new time is
+   emptied, and its timers put back in, which now sends them to level
+   0, since they're due within the next 64 ticks ('cascading'). Likewise
+   level 2 every 64^2 ticks, level 3 every 64^3, and the overflow list
+   every 64^4. Higher levels are cascaded first, so that their timers
+   can cascade on down in the same tick. A timer is cascaded at most
+   once per level, so that's O(1) per timer too.
+
+   Each slot is a circular doubly-linked list of timers, with the slot
+   itself as a sentinel node. A timer can thus unlink itself, when it's
+   cancelled, without knowing which slot it's in.
+
+   A slot that fires is first moved onto a local list, so that expiry
+   callbacks can re-arm the timer that fired (even into the same slot),
+   or cancel other timers, including ones that are about to fire.
+*/
+
+#define WHEEL_LEVELS 4
+#define WHEEL_SLOT_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_SLOT_BITS)     // 64
+#define WHEEL_SLOT_MASK (WHEEL_SLOTS - 1)
+
+
+struct timing_wheel{
+    WheelTimer slots[WHEEL_LEVELS][WHEEL_SLOTS];    // sentinels of the slot lists
+    WheelTimer overflow;    // sentinel of the list of timers beyond the last level
+    uint64_t now;
+    uint64_t count;         // number of timers armed
+};
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static void Wheel_list_init(WheelTimer *sentinel){
+    /* Make sentinel an empty circular list */
+    sentinel->next = sentinel->prev = sentinel;
+}
+
+
+static void Wheel_link(WheelTimer *sentinel, WheelTimer *timer){
+    /* Add timer at the end of the list sentinel heads */
+    timer->prev = sentinel->prev;
+    timer->next = sentinel;
+    sentinel->prev->next = timer;
+    sentinel->prev = timer;
+}
+
+
+static void Wheel_unlink(WheelTimer *timer){
+    /* Remove timer from whatever list it's in, and mark it as not armed */
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->next = timer->prev = NULL;
+}
+
+
+static void Wheel_move_list(WheelTimer *from, WheelTimer *to){
+    /* Move all the timers in the list from heads onto the empty list to heads */
+    if (from->next == from){
+        Wheel_list_init(to);
+        return;
+    }
+    to->next = from->next;
+    to->prev = from->prev;
+    to->next->prev = to;
+    to->prev->next = to;
+    Wheel_list_init(from);
+}
+
+
+static void Wheel_disarm_all(WheelTimer *sentinel){
+    /* Unlink all the timers in a list, marking them as not armed */
+    while (sentinel->next != sentinel){
+        Wheel_unlink(sentinel->next);
+    }
+}
+
+
+static void Wheel_place(TimingWheel the_wheel, WheelTimer *timer){
+    /* Put an armed timer in the slot its deadline falls in, as seen from now
+       (see the notes at the top). A deadline of now goes into the level-0
+       slot for now, which is the one being fired when timers cascade.
+    */
+    uint64_t deadline = (timer->deadline < the_wheel->now) ? the_wheel->now : timer->deadline;
+    uint64_t delta = deadline - the_wheel->now;
+
+    for (uint32_t level = 0; level < WHEEL_LEVELS; level++){
+        if (delta < (uint64_t)1 << (WHEEL_SLOT_BITS * (level + 1))){
+            uint32_t slot = (deadline >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK;
+            Wheel_link(&the_wheel->slots[level][slot], timer);
+            return;
+        }
+    }
+    Wheel_link(&the_wheel->overflow, timer);
+}
+
+
+static void Wheel_cascade(TimingWheel the_wheel, WheelTimer *sentinel){
+    /* Empty a list and place each of its timers again, from the current time */
+    WheelTimer pending;
+    Wheel_move_list(sentinel, &pending);
+    while (pending.next != &pending){
+        WheelTimer *timer = pending.next;
+        Wheel_unlink(timer);
+        Wheel_place(the_wheel, timer);
+    }
+}
+
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+void Wheel_init(TimingWheel *wheel_ref, uint64_t now){
+    /* Allocate a wheel with no timers, its clock set to now */
+    TimingWheel new_wheel = malloc(sizeof(struct timing_wheel));
+    if (!new_wheel){
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t level = 0; level < WHEEL_LEVELS; level++){
+        for (uint32_t slot = 0; slot < WHEEL_SLOTS; slot++){
+            Wheel_list_init(&new_wheel->slots[level][slot]);
+        }
+    }
+    Wheel_list_init(&new_wheel->overflow);
+    new_wheel->now = now;
+    new_wheel->count = 0;
+    *wheel_ref = new_wheel;
+}
+
+
+void Wheel_timer_init(WheelTimer *timer){
+    /* Initialize a timer as not armed */
+    timer->deadline = 0;
+    timer->next = timer->prev = NULL;
+}
+
+
+bool Wheel_is_armed(const WheelTimer *timer){
+    return timer->next != NULL;
+}
+
+
+uint64_t Wheel_now(TimingWheel the_wheel){
+    return the_wheel->now;
+}
+
+
+uint64_t Wheel_count(TimingWheel the_wheel){
+    return the_wheel->count;
+}
+
+
+void Wheel_arm(TimingWheel the_wheel, WheelTimer *timer, uint64_t deadline){
+    /* Arm timer to fire at tick deadline, in O(1). If it's already
+       armed, it's moved to the new deadline. A deadline that isn't
+       after the current time fires on the next tick.
+    */
+    if (Wheel_is_armed(timer)){
+        Wheel_unlink(timer);
+        the_wheel->count--;
+    }
+    timer->deadline = deadline;
+    if (timer->deadline <= the_wheel->now){
+        timer->deadline = the_wheel->now + 1;
+    }
+    Wheel_place(the_wheel, timer);
+    the_wheel->count++;
+}
+
+
+bool Wheel_cancel(TimingWheel the_wheel, WheelTimer *timer){
+    /* Disarm timer, in O(1). Return false if it wasn't armed */
+    if (!Wheel_is_armed(timer)){
+        return false;
+    }
+    Wheel_unlink(timer);
+    the_wheel->count--;
+    return true;
+}
+
+
+uint64_t Wheel_tick(TimingWheel the_wheel, WheelExpire expire, void *context){
+    /* Move the clock one tick forward, cascade the levels that wrap
+       around, and fire the timers due, calling expire on each one
+       (after disarming it). Return the number of timers fired.
+    */
+    uint64_t now = ++the_wheel->now;
+
+    // the levels whose slot index moved on: level l does when the bits below it are all 0
+    uint32_t wrapped = 0;
+    while (wrapped < WHEEL_LEVELS && !((now >> (WHEEL_SLOT_BITS * wrapped)) & WHEEL_SLOT_MASK)){
+        wrapped++;
+    }
+    // cascade from the top down, so timers can fall through several levels in one go
+    if (wrapped == WHEEL_LEVELS){
+        Wheel_cascade(the_wheel, &the_wheel->overflow);
+    }
+    for (uint32_t level = (wrapped < WHEEL_LEVELS - 1) ? wrapped : WHEEL_LEVELS - 1; level >= 1; level--){
+        Wheel_cascade(the_wheel, &the_wheel->slots[level][(now >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK]);
+    }
+
+    WheelTimer due;
+    Wheel_move_list(&the_wheel->slots[0][now & WHEEL_SLOT_MASK], &due);
+    uint64_t fired = 0;
+    while (due.next != &due){
+        WheelTimer *timer = due.next;
+        Wheel_unlink(timer);
+        the_wheel->count--;
+        fired++;
+        if (expire){
+            expire(timer, context);
+        }
+    }
+    return fired;
+}
+
+
+uint64_t Wheel_advance(TimingWheel the_wheel, uint64_t now, WheelExpire expire, void *context){
+    /* Move the clock forward to now, tick by tick, firing the timers
+       due along the way, and return how many fired. If there are no
+       timers armed, the clock jumps straight to now.
+    */
+    uint64_t fired = 0;
+    while (the_wheel->now < now){
+        if (!the_wheel->count){
+            the_wheel->now = now;
+            break;
+        }
+        fired += Wheel_tick(the_wheel, expire, context);
+    }
+    return fired;
+}
+
+
+void Wheel_destroy(TimingWheel *wheel_ref){
+    /* Disarm the timers still armed (they belong to the caller, and
+       aren't freed), free the wheel and set *wheel_ref to NULL.
+    */
+    if (!(*wheel_ref)){
+        return;
+    }
+    TimingWheel the_wheel = *wheel_ref;
+    for (uint32_t level = 0; level < WHEEL_LEVELS; level++){
+        for (uint32_t slot = 0; slot < WHEEL_SLOTS; slot++){
+            Wheel_disarm_all(&the_wheel->slots[level][slot]);
+        }
+    }
+    Wheel_disarm_all(&the_wheel->overflow);
+    free(the_wheel);
+    *wheel_ref = NULL;
+}
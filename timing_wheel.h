@@ -0,0 +1,72 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+
+
+/* *********************************************************************** */
+/* ------------------ Hierarchical timing wheel -------------------------- */
+/* *********************************************************************** */
+/*
+ * Schedules timers by deadline, measured in ticks of a clock the caller
+ * drives: the wheel has no notion of real time, it only moves forward
+ * when Wheel_tick() or Wheel_advance() is called. That can be a real
+ * clock (call Wheel_advance() with the current time in milliseconds,
+ * say) or a simulated one, in tests.
+ *
+ * Arming, cancelling and re-arming a timer are O(1), whatever the number
+ * of timers, and so is each tick (aside from the timers that fire). That
+ * suits timeouts that are mostly cancelled before they fire, which a heap
+ * would charge O(log n) for, both ways.
+ *
+ * Timers are INTRUSIVE: the wheel doesn't allocate them, the caller does,
+ * typically by embedding a WheelTimer in the struct the timer belongs to
+ * (a connection, a request ...), like the nodes of a linked list. When a
+ * timer fires, the expiry callback gets a pointer to it, from which the
+ * enclosing struct can be found. A timer must stay in place while it's
+ * armed, and must be initialized with Wheel_timer_init() before first use.
+ *
+ * Example
+ *      struct connection{ int fd; WheelTimer timeout; };
+ *      ...
+ *      Wheel_timer_init(&conn->timeout);
+ *      Wheel_arm(wheel, &conn->timeout, Wheel_now(wheel) + 30000);
+ *      ...
+ *      Wheel_cancel(wheel, &conn->timeout);    // the reply came in time
+ */
+
+typedef struct timing_wheel *TimingWheel;
+typedef struct wheel_timer WheelTimer;
+
+// a timer: the fields are the wheel's to manage, except for reading deadline
+struct wheel_timer{
+    uint64_t deadline;      // tick at which the timer fires
+    WheelTimer *next;       // neighbours in the timer's slot; NULL when not armed
+    WheelTimer *prev;
+};
+
+// called for each timer that fires, with the context passed to Wheel_tick() / Wheel_advance()
+typedef void (*WheelExpire)(WheelTimer *timer, void *context);
+
+
+void Wheel_init(TimingWheel *wheel_ref, uint64_t now);     // now: the tick the clock starts at
+void Wheel_timer_init(WheelTimer *timer);
+void Wheel_arm(TimingWheel the_wheel, WheelTimer *timer, uint64_t deadline);   // (re)arm; a deadline not after now fires on the next tick
+bool Wheel_cancel(TimingWheel the_wheel, WheelTimer *timer);   // false if the timer wasn't armed
+bool Wheel_is_armed(const WheelTimer *timer);
+uint64_t Wheel_now(TimingWheel the_wheel);
+uint64_t Wheel_count(TimingWheel the_wheel);    // number of timers armed
+uint64_t Wheel_tick(TimingWheel the_wheel, WheelExpire expire, void *context);    // move the clock 1 tick forward; returns the number of timers fired
+uint64_t Wheel_advance(TimingWheel the_wheel, uint64_t now, WheelExpire expire, void *context);   // move the clock forward to now
+void Wheel_destroy(TimingWheel *wheel_ref);     // the timers still armed are disarmed, not freed
+
+
+
+
+
+
+#endif
@@ -0,0 +1,241 @@
+#include "topk.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+
+#define TOPK_FILTER_BLOCK 64    // scores filtered against the threshold in one go by TopK_offer_batch()
+
+
+struct topk_entry{
+    double score;
+    uint64_t item;
+};
+
+struct topk{
+    struct topk_entry *entries;     // min-heap by score: entries[0] has the lowest kept score
+    uint32_t count;                 // number of entries kept
+    uint32_t k;                     // the most entries kept
+};
+
+
+
+/* ********************************************************************************* */
+/* ---------------------------- PRIVATE FUNCTIONS ---------------------------------- */
+
+static void TopK_sift_up(struct topk_entry entries[], uint32_t current_index){
+    /* Sift the entry at current_index up towards the root */
+    struct topk_entry entry = entries[current_index];
+    while (current_index > 0){
+        uint32_t parent = (current_index - 1) >> 1;
+        if (entries[parent].score <= entry.score){
+            break;
+        }
+        entries[current_index] = entries[parent];
+        current_index = parent;
+    }
+    entries[current_index] = entry;
+}
+
+
+static void TopK_sift_down(struct topk_entry entries[], uint32_t current, uint32_t count){
+    /* Sift the entry at current down, in a heap of count entries */
+    struct topk_entry entry = entries[current];
+    while (1){
+        uint32_t child = 2 * current + 1;
+        if (child >= count){
+            break;
+        }
+        if (child + 1 < count && entries[child+1].score < entries[child].score){
+            child++;
+        }
+        if (entry.score <= entries[child].score){
+            break;
+        }
+        entries[current] = entries[child];
+        current = child;
+    }
+    entries[current] = entry;
+}
+
+
+static inline uint32_t TopK_lowest_bit(uint64_t word){
+    /* Position of the lowest set bit in word, which must not be 0 */
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    uint32_t position = 0;
+    while (!(word & 1)){
+        word >>= 1;
+        position++;
+    }
+    return position;
+#endif
+}
+
+
+static uint64_t TopK_filter_block(const double scores[], uint32_t count, double threshold){
+    /* Return a mask with bit i set if scores[i] > threshold, for
+       the count (at most 64) scores starting at scores.
+       With SSE2, two scores are compared per instruction; otherwise
+       the loop is branch-free, which compilers can vectorize too.
+    */
+    uint64_t mask = 0;
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    __m128d limit = _mm_set1_pd(threshold);
+    for (; i + 2 <= count; i += 2){
+        __m128d pair = _mm_loadu_pd(&scores[i]);
+        mask |= (uint64_t)_mm_movemask_pd(_mm_cmpgt_pd(pair, limit)) << i;
+    }
+#endif
+    for (; i < count; i++){
+        mask |= (uint64_t)(scores[i] > threshold) << i;
+    }
+    return mask;
+}
+ 
+/* ------------------------------- END PRIVATE ------------------------------------- */
+/* ********************************************************************************* */
+
+
+void TopK_init(TopK *topk_ref, uint32_t k){
+    /* Allocate a selector keeping the top k items (k of at least 1) */
+    if (!k){
+        k = 1;
+    }
+    TopK new_topk = malloc(sizeof(struct topk));
+    if (!new_topk){
+        exit(EXIT_FAILURE);
+    }
+    new_topk->entries = malloc(sizeof(struct topk_entry) * k);
+    if (!new_topk->entries){
+        exit(EXIT_FAILURE);
+    }
+    new_topk->count = 0;
+    new_topk->k = k;
+    *topk_ref = new_topk;
+}
+
+
+bool TopK_offer(TopK the_topk, double score, uint64_t item){
+    /* Offer an item with the given score. Return true if it made it
+       into the top K (possibly pushing out the lowest-scoring one).
+    */
+    struct topk_entry entry = {score, item};
+
+    if (the_topk->count < the_topk->k){    // still filling up
+        if (isnan(score)){
+            return false;
+        }
+        the_topk->entries[the_topk->count++] = entry;
+        TopK_sift_up(the_topk->entries, the_topk->count - 1);
+        return true;
+    }
+    if (!(score > the_topk->entries[0].score)){     // the one compare most items stop at
+        return false;
+    }
+    the_topk->entries[0] = entry;
+    TopK_sift_down(the_topk->entries, 0, the_topk->count);
+    return true;
+}
+
+
+uint32_t TopK_offer_batch(TopK the_topk, const double scores[], const uint64_t items[], uint32_t count){
+    /* Offer count items at once (scores[i] goes with items[i]), in a
+       single pass over the batch, and return how many made it in.
+
+       Once K items are kept, the batch is filtered TOPK_FILTER_BLOCK
+       scores at a time against the threshold, with SIMD compares, and
+       only the scores that pass are offered to the heap, one by one
+       (the threshold may have gone up by then, in which case they're
+       still turned away).
+    */
+    uint32_t kept = 0;
+    uint32_t i = 0;
+
+    while (i < count && the_topk->count < the_topk->k){
+        kept += TopK_offer(the_topk, scores[i], items[i]);
+        i++;
+    }
+
+    while (i < count){
+        uint32_t block = (count - i < TOPK_FILTER_BLOCK) ? count - i : TOPK_FILTER_BLOCK;
+        uint64_t passed = TopK_filter_block(&scores[i], block, the_topk->entries[0].score);
+
+        while (passed){
+            uint32_t j = i + TopK_lowest_bit(passed);
+            kept += TopK_offer(the_topk, scores[j], items[j]);
+            passed &= passed - 1;
+        }
+        i += block;
+    }
+    return kept;
+}
+
+
+double TopK_threshold(TopK the_topk){
+    /* Return the score a new item has to beat to get in */
+    return (the_topk->count < the_topk->k) ? -INFINITY : the_topk->entries[0].score;
+}
+
+
+uint32_t TopK_count(TopK the_topk){
+    return the_topk->count;
+}
+
+
+uint32_t TopK_sorted(TopK the_topk, double scores[], uint64_t items[]){
+    /* Write the items kept, and their scores, into items and scores
+       (each with room for TopK_count() of them), highest score first,
+       and return how many there are. The selector is left as it is.
+
+       A copy of the heap is heapsorted: moving the root (the lowest
+       score) to the end of the shrinking heap, over and over, leaves
+       the copy in descending order.
+    */
+    uint32_t count = the_topk->count;
+    struct topk_entry *sorted = malloc(sizeof(struct topk_entry) * (count ? count : 1));
+    if (!sorted){
+        exit(EXIT_FAILURE);
+    }
+    memcpy(sorted, the_topk->entries, sizeof(struct topk_entry) * count);
+
+    for (uint32_t last = count; last > 1; last--){
+        struct topk_entry temp = sorted[0];
+        sorted[0] = sorted[last-1];
+        sorted[last-1] = temp;
+        TopK_sift_down(sorted, 0, last - 1);
+    }
+
+    for (uint32_t i = 0; i < count; i++){
+        scores[i] = sorted[i].score;
+        items[i] = sorted[i].item;
+    }
+    free(sorted);
+    return count;
+}
+
+
+void TopK_clear(TopK the_topk){
+    /* Forget all the items kept, e.g. to start a new window of the stream */
+    the_topk->count = 0;
+}
+
+
+void TopK_destroy(TopK *topk_ref){
+    /* Free all memory associated with the selector
+       and set *topk_ref to NULL.
+    */
+    if (!(*topk_ref)){
+        return;
+    }
+    free((*topk_ref)->entries);
+    free(*topk_ref);
+    *topk_ref = NULL;
+}
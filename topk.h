@@ -0,0 +1,50 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+
+
+/* *********************************************************************** */
+/* ------------------ Streaming top-K selector --------------------------- */
+/* *********************************************************************** */
+/*
+ * Keeps the K highest-scoring items seen so far in a stream of (score,
+ * item) pairs, in O(K) memory, however long the stream.
+ *
+ * The K items kept are stored in a min-heap laid out like the implicit
+ * heap in minheap_im.h, so the root is the LOWEST of the top K scores:
+ * the threshold a new item has to beat to get in. Once K items are kept,
+ * most of a long stream doesn't beat it, and is turned away with a single
+ * comparison; an item that does beat it replaces the root and is sifted
+ * down, in O(log K).
+ *
+ * TopK_offer_batch() takes a whole batch of pairs in one pass: the
+ * scores are compared against the threshold several at a time with SIMD
+ * instructions, and only the few that pass go into the heap.
+ *
+ * An item whose score ties the threshold is turned away, so among equal
+ * scores the earliest items are kept. NaN scores are never kept.
+ */
+
+typedef struct topk *TopK;
+
+
+void TopK_init(TopK *topk_ref, uint32_t k);
+bool TopK_offer(TopK the_topk, double score, uint64_t item);   // true if the item made it into the top K
+uint32_t TopK_offer_batch(TopK the_topk, const double scores[], const uint64_t items[], uint32_t count);  // returns how many made it in
+double TopK_threshold(TopK the_topk);   // the score to beat: the lowest kept score, or -INFINITY while fewer than K are kept
+uint32_t TopK_count(TopK the_topk);     // number of items kept: K, or fewer at the start of the stream
+uint32_t TopK_sorted(TopK the_topk, double scores[], uint64_t items[]);    // write the kept items out, highest score first
+void TopK_clear(TopK the_topk);
+void TopK_destroy(TopK *topk_ref);
+
+
+
+
+
+
+#endif